@@ -40,7 +40,11 @@ show_info() {
 
 show_info "Building dk_ivi Docker image..."
 
-docker build -t dk_ivi:latest --file Dockerfile .
+# The VSS catalog lives outside this directory; pass another directory
+# with a default_vss.json as DK_VSS_DIR to build for another VSS version.
+DK_VSS_DIR=${DK_VSS_DIR:-"$(dirname "$0")/../../installation-scripts/jetson-orin/manifests"}
+
+docker build -t dk_ivi:latest --build-context vss="${DK_VSS_DIR}" --file Dockerfile .
 
 show_info "Docker image dk_ivi:latest built successfully."
 show_info "To run the dk_ivi container, use the following command:"
@@ -0,0 +1,172 @@
+// Copyright (c) 2025 Eclipse Foundation.
+//
+// This program and the accompanying materials are made available under the
+// terms of the MIT License which is available at
+// https://opensource.org/licenses/MIT.
+//
+// SPDX-License-Identifier: MIT
+#include "mockdatabroker.hpp"
+#include <thread>
+
+namespace {
+std::mutex registryMtx;
+std::unordered_map<std::string, std::shared_ptr<MockDatabroker>> registry;
+}
+
+bool MockDatabroker::Stream::pop(std::string &value) {
+  std::unique_lock lock(mtx);
+  cv.wait(lock, [this]() { return closed || !queue.empty(); });
+  if (closed) return false;
+  value = std::move(queue.front());
+  queue.pop_front();
+  return true;
+}
+
+void MockDatabroker::Stream::cancel() {
+  {
+    std::lock_guard lock(mtx);
+    closed = true;
+  }
+  cv.notify_all();
+}
+
+std::shared_ptr<MockDatabroker> MockDatabroker::start(const std::string &serverURI) {
+  auto broker = std::make_shared<MockDatabroker>();
+  std::lock_guard lock(registryMtx);
+  registry[serverURI] = broker;
+  return broker;
+}
+
+std::shared_ptr<MockDatabroker> MockDatabroker::find(const std::string &serverURI) {
+  std::lock_guard lock(registryMtx);
+  auto it = registry.find(serverURI);
+  return (it == registry.end()) ? nullptr : it->second;
+}
+
+void MockDatabroker::stop(const std::string &serverURI) {
+  std::shared_ptr<MockDatabroker> broker;
+  {
+    std::lock_guard lock(registryMtx);
+    auto it = registry.find(serverURI);
+    if (it == registry.end()) return;
+    broker = it->second;
+    registry.erase(it);
+  }
+  broker->goOffline();
+}
+
+bool MockDatabroker::online() const {
+  std::lock_guard lock(mMtx_);
+  return mOnline_;
+}
+
+void MockDatabroker::goOffline() {
+  std::vector<std::shared_ptr<Stream>> streams;
+  {
+    std::lock_guard lock(mMtx_);
+    mOnline_ = false;
+    for (auto &kv : mEntries_) {
+      for (auto &list : kv.second.streams) {
+        for (auto &w : list) {
+          if (auto s = w.lock()) streams.push_back(std::move(s));
+        }
+        list.clear();
+      }
+    }
+  }
+  for (auto &s : streams) s->cancel();
+}
+
+void MockDatabroker::goOnline() {
+  std::lock_guard lock(mMtx_);
+  mOnline_ = true;
+}
+
+void MockDatabroker::setLatency(std::chrono::microseconds latency) {
+  std::lock_guard lock(mMtx_);
+  mLatency_ = latency;
+}
+
+std::chrono::microseconds MockDatabroker::latency() const {
+  std::lock_guard lock(mMtx_);
+  return mLatency_;
+}
+
+void MockDatabroker::delay() const {
+  auto d = latency();
+  if (d.count() > 0) std::this_thread::sleep_for(d);
+}
+
+bool MockDatabroker::get(const std::string &path, int field, std::string &value) const {
+  delay();
+  std::lock_guard lock(mMtx_);
+  if (!mOnline_) return false;
+  auto it = mEntries_.find(path);
+  value = (it == mEntries_.end()) ? std::string()
+        : (slot(field) ? it->second.target : it->second.current);
+  return true;
+}
+
+bool MockDatabroker::set(const std::string &path, int field, const std::string &value) {
+  delay();
+  std::vector<std::shared_ptr<Stream>> streams;
+  {
+    std::lock_guard lock(mMtx_);
+    if (!mOnline_) return false;
+    auto &e = mEntries_[path];
+    (slot(field) ? e.target : e.current) = value;
+    mSetCount_++;
+    auto &list = e.streams[slot(field)];
+    for (auto it = list.begin(); it != list.end(); ) {
+      if (auto s = it->lock()) {
+        streams.push_back(std::move(s));
+        ++it;
+      } else {
+        it = list.erase(it);
+      }
+    }
+  }
+  // the broker keeps no order between streams, only within one
+  for (auto &s : streams) {
+    {
+      std::lock_guard lock(s->mtx);
+      if (s->closed) continue;
+      s->queue.push_back(value);
+    }
+    s->cv.notify_one();
+  }
+  return true;
+}
+
+std::shared_ptr<MockDatabroker::Stream> MockDatabroker::subscribe(const std::string &path, int field) {
+  delay();
+  std::lock_guard lock(mMtx_);
+  if (!mOnline_) return nullptr;
+  auto stream = std::make_shared<Stream>();
+  stream->path  = path;
+  stream->field = field;
+
+  auto &e = mEntries_[path];
+  const std::string &initial = slot(field) ? e.target : e.current;
+  if (!initial.empty()) stream->queue.push_back(initial);
+  e.streams[slot(field)].push_back(stream);
+  return stream;
+}
+
+size_t MockDatabroker::openStreams() const {
+  std::lock_guard lock(mMtx_);
+  size_t n = 0;
+  for (const auto &kv : mEntries_) {
+    for (const auto &list : kv.second.streams) {
+      for (const auto &w : list) {
+        if (!w.expired()) n++;
+      }
+    }
+  }
+  return n;
+}
+
+uint64_t MockDatabroker::setCount() const {
+  std::lock_guard lock(mMtx_);
+  return mSetCount_;
+}
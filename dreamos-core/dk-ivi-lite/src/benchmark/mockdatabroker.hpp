@@ -0,0 +1,93 @@
+// Copyright (c) 2025 Eclipse Foundation.
+//
+// This program and the accompanying materials are made available under the
+// terms of the MIT License which is available at
+// https://opensource.org/licenses/MIT.
+//
+// SPDX-License-Identifier: MIT
+#ifndef MOCK_DATABROKER_HPP
+#define MOCK_DATABROKER_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//----------------------------------------------------------------------
+// MockDatabroker: an in-process stand-in for a kuksa.val v1 databroker.
+//
+// Holds a current and a target value per path and serves Get, Set and
+// Subscribe the way the broker does: a new stream first gets the value
+// the path has, then every value set on it. Values are kept in the
+// text form KuksaClient hands out.
+//
+// A KuksaClient built from mockkuksaclient.cpp instead of the real
+// library connects to the broker registered under its serverURI, so
+// VAPIClient runs unchanged on top of it. goOffline()/goOnline()
+// simulate a broker restart; setLatency() adds a network delay to every
+// call and every delivered update.
+//----------------------------------------------------------------------
+class MockDatabroker {
+public:
+  // one subscription: the broker pushes values, the client thread pops them
+  struct Stream {
+    std::string             path;
+    int                     field;
+    std::mutex              mtx;
+    std::condition_variable cv;
+    std::deque<std::string> queue;
+    bool                    closed = false;
+
+    // blocks for the next value; false once the stream is closed
+    bool pop(std::string &value);
+    // ends the stream on both sides, like ClientContext::TryCancel()
+    void cancel();
+  };
+
+  // registers a broker for serverURI, replacing an earlier one
+  static std::shared_ptr<MockDatabroker> start(const std::string &serverURI);
+  static std::shared_ptr<MockDatabroker> find(const std::string &serverURI);
+  static void stop(const std::string &serverURI);
+
+  bool online() const;
+  // drop every stream, refuse calls until goOnline(); values are kept
+  void goOffline();
+  void goOnline();
+
+  void setLatency(std::chrono::microseconds latency);
+  std::chrono::microseconds latency() const;
+
+  // field: KuksaClient::FT_VALUE or FT_ACTUATOR_TARGET
+  // Get/Set return false while offline
+  bool get(const std::string &path, int field, std::string &value) const;
+  bool set(const std::string &path, int field, const std::string &value);
+
+  // nullptr while offline
+  std::shared_ptr<Stream> subscribe(const std::string &path, int field);
+
+  size_t openStreams() const;
+  uint64_t setCount() const;
+
+private:
+  struct Entry {
+    std::string current;
+    std::string target;
+    std::vector<std::weak_ptr<Stream>> streams[2];
+  };
+
+  static int slot(int field) { return (field == 2) ? 1 : 0; }
+  void delay() const;
+
+  mutable std::mutex                       mMtx_;
+  bool                                     mOnline_ = true;
+  std::chrono::microseconds                mLatency_{0};
+  std::unordered_map<std::string, Entry>   mEntries_;
+  uint64_t                                 mSetCount_ = 0;
+};
+
+#endif // MOCK_DATABROKER_HPP
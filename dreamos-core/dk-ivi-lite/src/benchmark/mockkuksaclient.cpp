@@ -0,0 +1,377 @@
+// Copyright (c) 2025 Eclipse Foundation.
+//
+// This program and the accompanying materials are made available under the
+// terms of the MIT License which is available at
+// https://opensource.org/licenses/MIT.
+//
+// SPDX-License-Identifier: MIT
+
+//------------------------------------------------------------------------------
+// KuksaClient on top of MockDatabroker
+//
+// Implements the KuksaClient.hpp API without gRPC, so code written against
+// the library (VAPIClient) can be linked with this file instead of
+// libKuksaClient.so and run against an in-process broker. Like the library,
+// every subscription is served by its own thread, and a reconnect thread
+// restores the subscriptions made with subscribeWithReconnect() once the
+// broker is back.
+//------------------------------------------------------------------------------
+#include "../platform/integrations/vehicle-api/KuksaClient.hpp"
+#include "mockdatabroker.hpp"
+#include <charconv>
+#include <iomanip>
+
+namespace KuksaClient {
+
+// how often a lost connection is retried
+static constexpr auto kRetryInterval = std::chrono::milliseconds(50);
+
+namespace {
+Config loadConfig(const std::string &configFile) {
+  Config cfg;
+  if (!KuksaClient::parseConfig(configFile, cfg)) {
+    throw std::runtime_error("Cannot read config " + configFile);
+  }
+  return cfg;
+}
+
+template <typename T>
+std::string toText(const T &v) {
+  if constexpr (std::is_same_v<T, bool>) {
+    return v ? "true" : "false";
+  } else if constexpr (std::is_same_v<T, std::string>) {
+    return v;
+  } else if constexpr (std::is_floating_point_v<T>) {
+    std::ostringstream oss;
+    oss << std::setprecision(std::numeric_limits<T>::max_digits10) << v;
+    return oss.str();
+  } else {
+    return std::to_string(v);
+  }
+}
+}
+
+struct KuksaClient::Impl {
+  struct Running {
+    std::shared_ptr<MockDatabroker::Stream> stream;
+    std::thread                             thread;
+    std::atomic<bool>                       cancelled{false};
+  };
+
+  std::shared_ptr<MockDatabroker>       broker;
+  std::vector<std::unique_ptr<Running>> running;
+  std::mutex                            runningMtx;
+
+  // the broker may be replaced by a reconnect
+  static std::shared_ptr<MockDatabroker> current(const KuksaClient &c) {
+    std::lock_guard lock(c.connectionMutex_);
+    return c.pImpl->broker;
+  }
+
+  static void open(KuksaClient &c, const std::string &path,
+                   std::function<void(const std::string &, const std::string &, const int &)> cb,
+                   int field) {
+    auto broker = current(c);
+    auto stream = broker ? broker->subscribe(path, field) : nullptr;
+    if (!stream) {
+      c.handleConnectionFailure();
+      throw std::runtime_error("Subscribe failed for " + path + ": not connected");
+    }
+
+    auto run = std::make_unique<Running>();
+    Running *r = run.get();
+    r->stream = stream;
+    r->thread = std::thread([&c, r, broker, cb = std::move(cb), path, field]() {
+      std::string value;
+      while (r->stream->pop(value)) {
+        auto latency = broker->latency();
+        if (latency.count() > 0) std::this_thread::sleep_for(latency);
+        cb(path, value, field);
+      }
+      // closed by the broker, not by us: the connection is gone
+      if (!r->cancelled) c.handleConnectionFailure();
+    });
+
+    std::lock_guard lock(c.pImpl->runningMtx);
+    c.pImpl->running.push_back(std::move(run));
+  }
+
+  // joins the threads whose stream has ended
+  static void reap(KuksaClient &c) {
+    std::vector<std::unique_ptr<Running>> done;
+    {
+      std::lock_guard lock(c.pImpl->runningMtx);
+      auto &list = c.pImpl->running;
+      for (auto it = list.begin(); it != list.end(); ) {
+        bool closed;
+        {
+          std::lock_guard streamLock((*it)->stream->mtx);
+          closed = (*it)->stream->closed;
+        }
+        if (closed) {
+          done.push_back(std::move(*it));
+          it = list.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+    for (auto &r : done) {
+      if (r->thread.joinable()) r->thread.join();
+    }
+  }
+
+  static void cancelAll(KuksaClient &c, bool join) {
+    std::vector<std::unique_ptr<Running>> all;
+    {
+      std::lock_guard lock(c.pImpl->runningMtx);
+      all.swap(c.pImpl->running);
+    }
+    for (auto &r : all) {
+      r->cancelled = true;
+      r->stream->cancel();
+    }
+    for (auto &r : all) {
+      if (!r->thread.joinable()) continue;
+      if (join) {
+        r->thread.join();
+      } else {
+        r->thread.detach();
+      }
+    }
+  }
+};
+
+KuksaClient::KuksaClient(const Config &config)
+  : pImpl(std::make_unique<Impl>()),
+    serverURI_(config.serverURI),
+    debug_(config.debug),
+    config_(config),
+    signalPaths_(config.signalPaths) {
+}
+
+KuksaClient::KuksaClient(const std::string &configFile)
+  : KuksaClient(loadConfig(configFile)) {
+}
+
+KuksaClient::~KuksaClient() {
+  shouldStop_ = true;
+  reconnectCV_.notify_all();
+  if (reconnectThread_.joinable()) reconnectThread_.join();
+  Impl::cancelAll(*this, true);
+}
+
+void KuksaClient::connect() {
+  {
+    std::lock_guard lock(connectionMutex_);
+    pImpl->broker = MockDatabroker::find(serverURI_);
+    if (!pImpl->broker || !pImpl->broker->online()) {
+      connected_ = false;
+      throw std::runtime_error("Failed to connect to " + serverURI_);
+    }
+    connected_ = true;
+  }
+  if (debug_) std::cout << "[MockKuksaClient] Connected to " << serverURI_ << std::endl;
+
+  if (!reconnectThread_.joinable()) {
+    reconnectThread_ = std::thread([this]() {
+      std::unique_lock lock(reconnectMutex_);
+      while (!shouldStop_) {
+        reconnectCV_.wait_for(lock, kRetryInterval);
+        if (shouldStop_) break;
+        if (connected_ || !autoReconnect_) continue;
+        lock.unlock();
+        attemptReconnection();
+        lock.lock();
+      }
+    });
+  }
+}
+
+bool KuksaClient::isConnected() const {
+  std::lock_guard lock(connectionMutex_);
+  return connected_ && pImpl->broker && pImpl->broker->online();
+}
+
+void KuksaClient::setAutoReconnect(bool enabled) {
+  autoReconnect_ = enabled;
+  reconnectCV_.notify_all();
+}
+
+bool KuksaClient::reconnect() {
+  return attemptReconnection();
+}
+
+bool KuksaClient::attemptReconnection() {
+  {
+    std::lock_guard lock(connectionMutex_);
+    if (connected_ && pImpl->broker && pImpl->broker->online()) return true;
+    auto broker = MockDatabroker::find(serverURI_);
+    if (!broker || !broker->online()) return false;
+    pImpl->broker = broker;
+    connected_ = true;
+  }
+  restartSubscriptions();
+  return true;
+}
+
+void KuksaClient::handleConnectionFailure() {
+  connected_ = false;
+  reconnectCV_.notify_all();
+}
+
+void KuksaClient::restartSubscriptions() {
+  Impl::reap(*this);
+  std::vector<SubscriptionInfo> subs;
+  {
+    std::lock_guard lock(subscriptionsMutex_);
+    subs = activeSubscriptions_;
+  }
+  for (const auto &s : subs) {
+    try {
+      Impl::open(*this, s.entryPath, s.callback, s.field);
+    } catch (const std::exception &e) {
+      if (debug_) std::cerr << "[MockKuksaClient] " << e.what() << std::endl;
+      return;
+    }
+  }
+}
+
+std::string KuksaClient::getCurrentValue(const std::string &entryPath) {
+  return getValue(entryPath, GV_CURRENT, false);
+}
+
+std::string KuksaClient::getTargetValue(const std::string &entryPath) {
+  return getValue(entryPath, GV_TARGET, true);
+}
+
+std::string KuksaClient::getValue(const std::string &entryPath, GetView, bool target) {
+  std::string value;
+  auto broker = Impl::current(*this);
+  if (!broker || !broker->get(entryPath, target ? FT_ACTUATOR_TARGET : FT_VALUE, value)) {
+    handleConnectionFailure();
+    return std::string();
+  }
+  return value;
+}
+
+void KuksaClient::streamUpdate(const std::string &entryPath, float newValue) {
+  setCurrentValue(entryPath, newValue);
+}
+
+template <typename T>
+void KuksaClient::setValueInternalImpl(const std::string &entryPath, const T &newValue, int field) {
+  auto broker = Impl::current(*this);
+  if (!broker || !broker->set(entryPath, field, toText(newValue))) {
+    handleConnectionFailure();
+    throw std::runtime_error("Set failed for " + entryPath + ": not connected");
+  }
+}
+
+template void KuksaClient::setValueInternalImpl<bool>(const std::string &, const bool &, int);
+template void KuksaClient::setValueInternalImpl<int8_t>(const std::string &, const int8_t &, int);
+template void KuksaClient::setValueInternalImpl<int16_t>(const std::string &, const int16_t &, int);
+template void KuksaClient::setValueInternalImpl<int32_t>(const std::string &, const int32_t &, int);
+template void KuksaClient::setValueInternalImpl<int64_t>(const std::string &, const int64_t &, int);
+template void KuksaClient::setValueInternalImpl<uint8_t>(const std::string &, const uint8_t &, int);
+template void KuksaClient::setValueInternalImpl<uint16_t>(const std::string &, const uint16_t &, int);
+template void KuksaClient::setValueInternalImpl<uint32_t>(const std::string &, const uint32_t &, int);
+template void KuksaClient::setValueInternalImpl<uint64_t>(const std::string &, const uint64_t &, int);
+template void KuksaClient::setValueInternalImpl<float>(const std::string &, const float &, int);
+template void KuksaClient::setValueInternalImpl<double>(const std::string &, const double &, int);
+template void KuksaClient::setValueInternalImpl<std::string>(const std::string &, const std::string &, int);
+
+void KuksaClient::subscribeTargetValue(const std::string &entryPath,
+                                       std::function<void(const std::string &, const std::string &, const int &)> userCallback) {
+  subscribe(entryPath, std::move(userCallback), FT_ACTUATOR_TARGET);
+}
+
+void KuksaClient::subscribeCurrentValue(const std::string &entryPath,
+                                        std::function<void(const std::string &, const std::string &, const int &)> userCallback) {
+  subscribe(entryPath, std::move(userCallback), FT_VALUE);
+}
+
+void KuksaClient::subscribe(const std::string &entryPath,
+                            std::function<void(const std::string &, const std::string &, const int &)> userCallback,
+                            int field) {
+  Impl::open(*this, entryPath, std::move(userCallback), field);
+}
+
+void KuksaClient::subscribeWithReconnect(const std::string &entryPath,
+                                         std::function<void(const std::string &, const std::string &, const int &)> userCallback,
+                                         int field) {
+  {
+    std::lock_guard lock(subscriptionPathsMutex_);
+    std::string key = entryPath + '#' + std::to_string(field);
+    if (!activeSubscriptionPaths_.insert(key).second) return;
+  }
+  {
+    std::lock_guard lock(subscriptionsMutex_);
+    activeSubscriptions_.push_back(SubscriptionInfo{entryPath, userCallback, field});
+  }
+  // offline: the reconnect thread opens it once the broker is back
+  if (isConnected()) {
+    Impl::open(*this, entryPath, std::move(userCallback), field);
+  }
+}
+
+void KuksaClient::subscribeAll(std::function<void(const std::string &, const std::string &, const int &)> userCallback) {
+  for (const auto &p : signalPaths_) {
+    subscribeWithReconnect(p, userCallback, FT_VALUE);
+  }
+}
+
+void KuksaClient::joinAllSubscriptions() {
+  std::vector<std::unique_ptr<Impl::Running>> all;
+  {
+    std::lock_guard lock(pImpl->runningMtx);
+    all.swap(pImpl->running);
+  }
+  for (auto &r : all) {
+    if (r->thread.joinable()) r->thread.join();
+  }
+}
+
+void KuksaClient::joinAllSubscriptionsWithTimeout() {
+  Impl::cancelAll(*this, true);
+}
+
+void KuksaClient::detachAllSubscriptions() {
+  Impl::cancelAll(*this, false);
+}
+
+void KuksaClient::getServerInfo() {
+  if (!isConnected()) {
+    throw std::runtime_error("GetServerInfo failed: not connected to " + serverURI_);
+  }
+  if (debug_) std::cout << "[MockKuksaClient] Server: mock databroker at " << serverURI_ << std::endl;
+}
+
+bool KuksaClient::parseConfig(const std::string &filename, Config &) {
+  std::cerr << "[MockKuksaClient] Config files are not supported: " << filename << std::endl;
+  return false;
+}
+
+bool KuksaClient::convertString(const std::string &str, bool &out) {
+  if (str == "true" || str == "1") { out = true; return true; }
+  if (str == "false" || str == "0") { out = false; return true; }
+  return false;
+}
+
+template <typename T>
+static bool convertUnsigned(const std::string &str, T &out) {
+  uint64_t v = 0;
+  auto res = std::from_chars(str.data(), str.data() + str.size(), v);
+  if (res.ec != std::errc() || res.ptr != str.data() + str.size() ||
+      v > std::numeric_limits<T>::max()) {
+    return false;
+  }
+  out = static_cast<T>(v);
+  return true;
+}
+
+bool KuksaClient::convertString(const std::string &str, uint8_t &out)  { return convertUnsigned(str, out); }
+bool KuksaClient::convertString(const std::string &str, uint16_t &out) { return convertUnsigned(str, out); }
+bool KuksaClient::convertString(const std::string &str, uint32_t &out) { return convertUnsigned(str, out); }
+
+} // namespace KuksaClient
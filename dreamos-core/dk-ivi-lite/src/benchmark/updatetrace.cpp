@@ -0,0 +1,109 @@
+// Copyright (c) 2025 Eclipse Foundation.
+//
+// This program and the accompanying materials are made available under the
+// terms of the MIT License which is available at
+// https://opensource.org/licenses/MIT.
+//
+// SPDX-License-Identifier: MIT
+#include "updatetrace.hpp"
+#include <algorithm>
+#include <fstream>
+#include <set>
+
+static std::string escape(const std::string &text) {
+  std::string out;
+  out.reserve(text.size());
+  for (char ch : text) {
+    switch (ch) {
+      case '\\': out += "\\\\"; break;
+      case '\t': out += "\\t";  break;
+      case '\n': out += "\\n";  break;
+      default:   out += ch;
+    }
+  }
+  return out;
+}
+
+static std::string unescape(const std::string &text) {
+  std::string out;
+  out.reserve(text.size());
+  for (size_t i = 0; i < text.size(); i++) {
+    if (text[i] != '\\' || i + 1 == text.size()) {
+      out += text[i];
+      continue;
+    }
+    char ch = text[++i];
+    out += (ch == 't') ? '\t' : (ch == 'n') ? '\n' : ch;
+  }
+  return out;
+}
+
+void UpdateTrace::start() {
+  std::lock_guard lock(mMtx_);
+  mStart_ = std::chrono::steady_clock::now();
+  mEntries_.clear();
+}
+
+void UpdateTrace::add(int field, const std::string &path, const std::string &value) {
+  auto offset = std::chrono::duration_cast<std::chrono::microseconds>(
+                  std::chrono::steady_clock::now() - mStart_);
+  std::lock_guard lock(mMtx_);
+  mEntries_.push_back(TraceEntry{offset, field, path, value});
+}
+
+std::vector<std::string> UpdateTrace::paths() const {
+  std::lock_guard lock(mMtx_);
+  std::set<std::string> unique;
+  for (const auto &e : mEntries_) unique.insert(e.path);
+  return std::vector<std::string>(unique.begin(), unique.end());
+}
+
+bool UpdateTrace::save(const std::string &file) const {
+  std::ofstream out(file);
+  if (!out) return false;
+  std::lock_guard lock(mMtx_);
+  for (const auto &e : mEntries_) {
+    out << e.offset.count() << '\t' << e.field << '\t'
+        << escape(e.path) << '\t' << escape(e.value) << '\n';
+  }
+  return static_cast<bool>(out);
+}
+
+bool UpdateTrace::load(const std::string &file, std::string &error) {
+  std::ifstream in(file);
+  if (!in) {
+    error = "cannot open " + file;
+    return false;
+  }
+
+  std::vector<TraceEntry> entries;
+  std::string line;
+  for (size_t lineNo = 1; std::getline(in, line); lineNo++) {
+    if (line.empty()) continue;
+    size_t t1 = line.find('\t');
+    size_t t2 = (t1 == std::string::npos) ? t1 : line.find('\t', t1 + 1);
+    size_t t3 = (t2 == std::string::npos) ? t2 : line.find('\t', t2 + 1);
+    if (t3 == std::string::npos) {
+      error = file + ":" + std::to_string(lineNo) + ": expected 4 columns";
+      return false;
+    }
+    try {
+      TraceEntry e;
+      e.offset = std::chrono::microseconds(std::stoll(line.substr(0, t1)));
+      e.field  = std::stoi(line.substr(t1 + 1, t2 - t1 - 1));
+      e.path   = unescape(line.substr(t2 + 1, t3 - t2 - 1));
+      e.value  = unescape(line.substr(t3 + 1));
+      entries.push_back(std::move(e));
+    } catch (const std::exception &) {
+      error = file + ":" + std::to_string(lineNo) + ": bad offset or field";
+      return false;
+    }
+  }
+
+  // replay in time order even if the recording threads interleaved
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const TraceEntry &a, const TraceEntry &b) { return a.offset < b.offset; });
+  std::lock_guard lock(mMtx_);
+  mEntries_ = std::move(entries);
+  return true;
+}
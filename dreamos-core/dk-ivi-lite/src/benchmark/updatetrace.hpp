@@ -0,0 +1,50 @@
+// Copyright (c) 2025 Eclipse Foundation.
+//
+// This program and the accompanying materials are made available under the
+// terms of the MIT License which is available at
+// https://opensource.org/licenses/MIT.
+//
+// SPDX-License-Identifier: MIT
+#ifndef UPDATE_TRACE_HPP
+#define UPDATE_TRACE_HPP
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//----------------------------------------------------------------------
+// UpdateTrace: a recorded stream of subscription updates.
+//
+// One update per line, tab separated: microseconds since the start of
+// the recording, field (1 current, 2 target), path, value in the text
+// form of the broker. Tabs, newlines and backslashes in values are
+// escaped, so any value fits on its line.
+//----------------------------------------------------------------------
+struct TraceEntry {
+  std::chrono::microseconds offset{0};
+  int                       field = 1;
+  std::string               path;
+  std::string               value;
+};
+
+class UpdateTrace {
+public:
+  // the offsets of add() count from here
+  void start();
+  // any thread
+  void add(int field, const std::string &path, const std::string &value);
+
+  const std::vector<TraceEntry> &entries() const { return mEntries_; }
+  std::vector<std::string> paths() const;
+
+  bool save(const std::string &file) const;
+  bool load(const std::string &file, std::string &error);
+
+private:
+  std::chrono::steady_clock::time_point mStart_ = std::chrono::steady_clock::now();
+  std::vector<TraceEntry>               mEntries_;
+  mutable std::mutex                    mMtx_;
+};
+
+#endif // UPDATE_TRACE_HPP
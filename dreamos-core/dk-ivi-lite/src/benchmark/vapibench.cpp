@@ -0,0 +1,475 @@
+// Copyright (c) 2025 Eclipse Foundation.
+//
+// This program and the accompanying materials are made available under the
+// terms of the MIT License which is available at
+// https://opensource.org/licenses/MIT.
+//
+// SPDX-License-Identifier: MIT
+
+//------------------------------------------------------------------------------
+// vapibench: VAPIClient against the in-process MockDatabroker
+//
+// Runs the real VAPIClient, linked with the mock KuksaClient, through:
+//   latency     set() -> subscription callback round trip, one at a time
+//   throughput  P paths updated by a provider HZ times a second
+//   subscribe   time until P new subscriptions delivered their first value
+//   reconnect   broker restart until all P subscriptions deliver again
+//   shutdown    VAPIClient::shutdown() with P more subscriptions streaming;
+//               must close every stream within its deadline
+//   replay      a recorded trace (vapirecord, --record) fed into the broker;
+//               every update must arrive with its value, in order
+// Exits with 1 if an update was lost or arrived with a different value.
+//------------------------------------------------------------------------------
+#include "../platform/integrations/vehicle-api/vapiclient.hpp"
+#include "mockdatabroker.hpp"
+#include "updatetrace.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Options {
+  int         latencyRuns     = 1000;
+  int         throughputPaths = 100;
+  int         throughputHz    = 100;
+  int         throughputSecs  = 3;
+  int         reconnectPaths  = 100;
+  int         subscribePaths  = 100;
+  int         shutdownPaths   = 100;
+  int         brokerLatencyUs = 0;
+  std::string recordFile;
+  std::string replayFile;
+  bool        realtime        = false;
+};
+
+class Stats {
+public:
+  void add(Clock::duration d) {
+    std::lock_guard lock(mMtx_);
+    mUs_.push_back(std::chrono::duration<double, std::micro>(d).count());
+  }
+
+  void print(const char *name) {
+    std::lock_guard lock(mMtx_);
+    if (mUs_.empty()) {
+      std::printf("%-12s no samples\n", name);
+      return;
+    }
+    std::sort(mUs_.begin(), mUs_.end());
+    auto pct = [this](double p) { return mUs_[std::min(mUs_.size() - 1, size_t(p * mUs_.size()))]; };
+    std::printf("%-12s n=%-7zu p50=%9.1fus p90=%9.1fus p99=%9.1fus max=%9.1fus\n",
+                name, mUs_.size(), pct(0.50), pct(0.90), pct(0.99), mUs_.back());
+  }
+
+private:
+  std::mutex          mMtx_;
+  std::vector<double> mUs_;
+};
+
+template <typename Pred>
+bool waitFor(Pred pred, std::chrono::milliseconds timeout = std::chrono::milliseconds(5000)) {
+  auto deadline = Clock::now() + timeout;
+  while (!pred()) {
+    if (Clock::now() > deadline) return false;
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+  return true;
+}
+
+double ms(Clock::duration d) {
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+
+std::vector<std::string> benchPaths(int n) {
+  std::vector<std::string> paths;
+  for (int i = 0; i < n; i++) {
+    paths.push_back("Vehicle.Bench.Signal" + std::to_string(i));
+  }
+  return paths;
+}
+
+std::shared_ptr<MockDatabroker> startBroker(const std::string &server, const Options &opt) {
+  auto broker = MockDatabroker::start(server);
+  broker->setLatency(std::chrono::microseconds(opt.brokerLatencyUs));
+  if (!VAPI_CLIENT.connectToServer(server, {})) {
+    std::fprintf(stderr, "cannot connect to %s\n", server.c_str());
+    return nullptr;
+  }
+  return broker;
+}
+
+// The callbacks of a run only touch state owned by a shared_ptr they hold:
+// the dispatcher may still be delivering an update when a run returns (it
+// calls from a snapshot of the subscribers, and a connection that shutdown()
+// gives up on keeps running), so nothing they use may live on the stack.
+
+//------------------------------------------------------------------------------
+int runLatency(const Options &opt) {
+  const std::string server = "mock:latency";
+  const std::string path   = "Vehicle.Bench.Latency";
+  auto broker = startBroker(server, opt);
+  if (!broker) return 1;
+
+  struct State {
+    std::mutex              mtx;
+    std::condition_variable cv;
+    int64_t                 seen = -1;
+  };
+  auto state = std::make_shared<State>();
+  auto sub = VAPI_CLIENT.subscribe(server, {path}, SF_CURRENT,
+    [state](const std::string &, const Datapoint &value, const int &) {
+      int64_t v;
+      if (!value.get(v)) return;
+      {
+        std::lock_guard lock(state->mtx);
+        state->seen = v;
+      }
+      state->cv.notify_one();
+    });
+  waitFor([&]() { return broker->openStreams() == 1; });
+
+  Stats stats;
+  int lost = 0;
+  for (int64_t i = 0; i < opt.latencyRuns; i++) {
+    auto t0 = Clock::now();
+    VAPI_CLIENT.set(server, path, Datapoint(i), SF_CURRENT);
+    std::unique_lock lock(state->mtx);
+    if (state->cv.wait_for(lock, std::chrono::seconds(2), [&]() { return state->seen == i; })) {
+      stats.add(Clock::now() - t0);
+    } else {
+      lost++;
+    }
+  }
+  VAPI_CLIENT.unsubscribe(sub);
+  stats.print("latency");
+  if (lost) std::printf("latency      %d of %d updates lost\n", lost, opt.latencyRuns);
+  return lost ? 1 : 0;
+}
+
+//------------------------------------------------------------------------------
+int runThroughput(const Options &opt) {
+  const std::string server = "mock:throughput";
+  auto paths  = benchPaths(opt.throughputPaths);
+  auto broker = startBroker(server, opt);
+  if (!broker) return 1;
+
+  const int ticks = opt.throughputHz * opt.throughputSecs;
+  struct State {
+    explicit State(int ticks) : sentAt(ticks) {}
+    std::vector<Clock::time_point> sentAt;
+    std::atomic<uint64_t>          received{0};
+    std::atomic<int64_t>           lastReceived{0};
+    Stats                          stats;
+    UpdateTrace                    trace;
+  };
+  auto state = std::make_shared<State>(ticks);
+  auto &sentAt = state->sentAt;
+  auto &received = state->received;
+  auto &stats = state->stats;
+  auto &trace = state->trace;
+  const bool record = !opt.recordFile.empty();
+
+  auto sub = VAPI_CLIENT.subscribe(server, paths, SF_CURRENT,
+    [state, ticks, record](const std::string &path, const Datapoint &value, const int &field) {
+      int64_t tick;
+      if (!value.get(tick) || tick < 0 || tick >= ticks) return;
+      auto now = Clock::now();
+      state->stats.add(now - state->sentAt[tick]);
+      state->lastReceived = now.time_since_epoch().count();
+      state->received++;
+      if (record) state->trace.add(field, path, value.toString());
+    });
+  waitFor([&]() { return broker->openStreams() == paths.size(); });
+
+  // the provider side: every path once per period
+  auto period = std::chrono::nanoseconds(1000000000LL / opt.throughputHz);
+  auto start  = Clock::now();
+  trace.start();
+  for (int tick = 0; tick < ticks; tick++) {
+    sentAt[tick] = Clock::now();
+    std::string value = std::to_string(tick);
+    for (const auto &p : paths) {
+      broker->set(p, KuksaClient::FT_VALUE, value);
+    }
+    std::this_thread::sleep_until(start + period * (tick + 1));
+  }
+
+  uint64_t expected = uint64_t(ticks) * paths.size();
+  waitFor([&]() { return received == expected; }, std::chrono::milliseconds(2000));
+  VAPI_CLIENT.unsubscribe(sub);
+  auto elapsed = Clock::time_point(Clock::duration(state->lastReceived.load())) - start;
+
+  std::printf("throughput   %d paths at %d Hz: %llu of %llu updates, %.0f updates/s\n",
+              opt.throughputPaths, opt.throughputHz,
+              (unsigned long long)received.load(), (unsigned long long)expected,
+              received / std::max(1e-9, std::chrono::duration<double>(elapsed).count()));
+  stats.print("  delivery");
+
+  if (!opt.recordFile.empty()) {
+    if (trace.save(opt.recordFile)) {
+      std::printf("throughput   recorded %zu updates to %s\n", trace.entries().size(), opt.recordFile.c_str());
+    } else {
+      std::fprintf(stderr, "cannot write %s\n", opt.recordFile.c_str());
+    }
+  }
+  return (received == expected) ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
+// counts the first callback per path after reset()
+class PathArrivals {
+public:
+  explicit PathArrivals(size_t paths) : mPaths_(paths) {}
+
+  void reset() {
+    std::lock_guard lock(mMtx_);
+    mSeen_.clear();
+  }
+  void arrived(const std::string &path) {
+    std::lock_guard lock(mMtx_);
+    if (mSeen_.insert(path).second && mSeen_.size() == mPaths_) mAllAt_ = Clock::now();
+  }
+  bool all() const {
+    std::lock_guard lock(mMtx_);
+    return mSeen_.size() == mPaths_;
+  }
+  Clock::time_point allAt() const {
+    std::lock_guard lock(mMtx_);
+    return mAllAt_;
+  }
+
+private:
+  size_t                mPaths_;
+  mutable std::mutex    mMtx_;
+  std::set<std::string> mSeen_;
+  Clock::time_point     mAllAt_;
+};
+
+int runSubscribe(const Options &opt) {
+  const std::string server = "mock:subscribe";
+  auto paths  = benchPaths(opt.subscribePaths);
+  auto broker = startBroker(server, opt);
+  if (!broker) return 1;
+  for (const auto &p : paths) broker->set(p, KuksaClient::FT_VALUE, "1");
+
+  auto arrivals = std::make_shared<PathArrivals>(paths.size());
+  auto t0 = Clock::now();
+  auto sub = VAPI_CLIENT.subscribe(server, paths, SF_CURRENT,
+    [arrivals](const std::string &path, const Datapoint &, const int &) { arrivals->arrived(path); });
+  bool all = waitFor([&]() { return arrivals->all(); });
+  VAPI_CLIENT.unsubscribe(sub);
+  if (!all) {
+    std::printf("subscribe    %zu paths: timed out\n", paths.size());
+    return 1;
+  }
+  std::printf("subscribe    %zu paths: first values after %.2f ms\n", paths.size(), ms(arrivals->allAt() - t0));
+  return 0;
+}
+
+int runReconnect(const Options &opt) {
+  const std::string server = "mock:reconnect";
+  auto paths  = benchPaths(opt.reconnectPaths);
+  auto broker = startBroker(server, opt);
+  if (!broker) return 1;
+  VAPI_CLIENT.setAutoReconnect(server, true);
+  for (const auto &p : paths) broker->set(p, KuksaClient::FT_VALUE, "1");
+
+  auto arrivals = std::make_shared<PathArrivals>(paths.size());
+  auto sub = VAPI_CLIENT.subscribe(server, paths, SF_CURRENT,
+    [arrivals](const std::string &path, const Datapoint &, const int &) { arrivals->arrived(path); });
+  waitFor([&]() { return arrivals->all(); });
+
+  broker->goOffline();
+  waitFor([&]() { return broker->openStreams() == 0; });
+  arrivals->reset();
+
+  auto t0 = Clock::now();
+  broker->goOnline();
+  bool connected = waitFor([&]() { return VAPI_CLIENT.isConnected(server); });
+  auto connectedAt = Clock::now();
+  bool all = connected && waitFor([&]() { return arrivals->all(); });
+  VAPI_CLIENT.unsubscribe(sub);
+  if (!all) {
+    std::printf("reconnect    %zu paths: timed out\n", paths.size());
+    return 1;
+  }
+  std::printf("reconnect    %zu paths: connected after %.2f ms, all streams delivering after %.2f ms\n",
+              paths.size(), ms(connectedAt - t0), ms(arrivals->allAt() - t0));
+  return 0;
+}
+
+// last: leaves no connection behind
+int runShutdown(const Options &opt) {
+  const std::string server = "mock:shutdown";
+  auto paths  = benchPaths(opt.shutdownPaths);
+  auto broker = startBroker(server, opt);
+  if (!broker) return 1;
+
+  // shutdown() may leave a stuck connection running, with this callback
+  auto arrivals = std::make_shared<PathArrivals>(paths.size());
+  VAPI_CLIENT.subscribe(server, paths, SF_BOTH,
+    [arrivals](const std::string &path, const Datapoint &, const int &) { arrivals->arrived(path); });
+  for (const auto &p : paths) broker->set(p, KuksaClient::FT_VALUE, "1");
+  waitFor([&]() { return arrivals->all(); });
+
+  // keep updates in flight while it shuts down
+  std::atomic<bool> stop{false};
+  std::thread provider([&]() {
+    for (int v = 0; !stop; v++) {
+      for (const auto &p : paths) broker->set(p, KuksaClient::FT_VALUE, std::to_string(v));
+    }
+  });
+
+  auto t0 = Clock::now();
+  VAPI_CLIENT.shutdown();
+  auto elapsed = Clock::now() - t0;
+  stop = true;
+  provider.join();
+
+  size_t open = broker->openStreams();
+  std::printf("shutdown     %zu paths, %zu streams: done after %.2f ms, %zu streams left open\n",
+              paths.size(), 2 * paths.size(), ms(elapsed), open);
+  return (open == 0 && elapsed < std::chrono::milliseconds(200)) ? 0 : 1;
+}
+
+//------------------------------------------------------------------------------
+int runReplay(const Options &opt) {
+  auto trace = std::make_shared<UpdateTrace>();
+  std::string error;
+  if (!trace->load(opt.replayFile, error)) {
+    std::fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+  const auto &entries = trace->entries();
+  auto paths = trace->paths();
+
+  const std::string server = "mock:replay";
+  auto broker = startBroker(server, opt);
+  if (!broker) return 1;
+
+  // updates of one (path, field) arrive in the order they were set
+  struct State {
+    explicit State(size_t n) : sentAt(n) {}
+    std::mutex                                                 mtx;
+    std::map<std::pair<std::string, int>, std::deque<size_t>> inFlight;
+    std::vector<Clock::time_point>                             sentAt;
+    std::atomic<size_t>                                        received{0};
+    std::atomic<size_t>                                        mismatched{0};
+    Stats                                                      stats;
+  };
+  auto state = std::make_shared<State>(entries.size());
+  auto &sentAt = state->sentAt;
+  auto &received = state->received;
+  auto &mismatched = state->mismatched;
+
+  auto sub = VAPI_CLIENT.subscribe(server, paths, SF_BOTH,
+    [state, trace](const std::string &path, const Datapoint &value, const int &field) {
+      size_t i;
+      {
+        std::lock_guard lock(state->mtx);
+        auto &q = state->inFlight[{path, field}];
+        if (q.empty()) return;
+        i = q.front();
+        q.pop_front();
+      }
+      state->stats.add(Clock::now() - state->sentAt[i]);
+      Datapoint expected;
+      Datapoint::parse(trace->entries()[i].value, expected);
+      if (!(expected == value)) state->mismatched++;
+      state->received++;
+    });
+  waitFor([&]() { return broker->openStreams() == 2 * paths.size(); });
+
+  auto start = Clock::now();
+  for (size_t i = 0; i < entries.size(); i++) {
+    const auto &e = entries[i];
+    if (opt.realtime) std::this_thread::sleep_until(start + e.offset);
+    {
+      std::lock_guard lock(state->mtx);
+      state->inFlight[{e.path, e.field}].push_back(i);
+    }
+    sentAt[i] = Clock::now();
+    broker->set(e.path, e.field, e.value);
+  }
+  waitFor([&]() { return received == entries.size(); }, std::chrono::milliseconds(2000));
+  VAPI_CLIENT.unsubscribe(sub);
+
+  std::printf("replay       %zu updates on %zu paths: %zu delivered, %zu with another value, %.2f ms\n",
+              entries.size(), paths.size(), received.load(), mismatched.load(), ms(Clock::now() - start));
+  state->stats.print("  delivery");
+  return (received == entries.size() && mismatched == 0) ? 0 : 1;
+}
+
+void usage(const char *argv0) {
+  std::printf("usage: %s [options]\n"
+              "  --latency N            set -> subscription round trips (1000)\n"
+              "  --throughput P HZ S    P paths updated HZ times a second for S seconds (100 100 3)\n"
+              "  --subscribe P          open P subscriptions at once (100)\n"
+              "  --reconnect P          restart the broker under P subscriptions (100)\n"
+              "  --shutdown P           shut down with P more subscriptions streaming (100)\n"
+              "  --broker-latency US    network delay the mock adds to every call and update (0)\n"
+              "  --record FILE          save the updates of the throughput run as a trace\n"
+              "  --replay FILE          only replay a trace, checking every update arrives\n"
+              "  --realtime             replay with the recorded timing, not at full speed\n"
+              "A count of 0 skips that run.\n", argv0);
+}
+
+bool parseArgs(int argc, char **argv, Options &opt) {
+  auto next = [&](int &i) -> const char * { return (i + 1 < argc) ? argv[++i] : nullptr; };
+  for (int i = 1; i < argc; i++) {
+    const char *a = argv[i];
+    const char *v = nullptr;
+    if (!std::strcmp(a, "--latency") && (v = next(i))) {
+      opt.latencyRuns = std::atoi(v);
+    } else if (!std::strcmp(a, "--throughput") && i + 3 < argc) {
+      opt.throughputPaths = std::atoi(argv[++i]);
+      opt.throughputHz    = std::max(1, std::atoi(argv[++i]));
+      opt.throughputSecs  = std::atoi(argv[++i]);
+    } else if (!std::strcmp(a, "--subscribe") && (v = next(i))) {
+      opt.subscribePaths = std::atoi(v);
+    } else if (!std::strcmp(a, "--reconnect") && (v = next(i))) {
+      opt.reconnectPaths = std::atoi(v);
+    } else if (!std::strcmp(a, "--shutdown") && (v = next(i))) {
+      opt.shutdownPaths = std::atoi(v);
+    } else if (!std::strcmp(a, "--broker-latency") && (v = next(i))) {
+      opt.brokerLatencyUs = std::atoi(v);
+    } else if (!std::strcmp(a, "--record") && (v = next(i))) {
+      opt.recordFile = v;
+    } else if (!std::strcmp(a, "--replay") && (v = next(i))) {
+      opt.replayFile = v;
+    } else if (!std::strcmp(a, "--realtime")) {
+      opt.realtime = true;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options opt;
+  if (!parseArgs(argc, argv, opt)) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  int failed = 0;
+  if (!opt.replayFile.empty()) {
+    failed |= runReplay(opt);
+  } else {
+    if (opt.latencyRuns > 0)                            failed |= runLatency(opt);
+    if (opt.throughputPaths > 0 && opt.throughputSecs > 0) failed |= runThroughput(opt);
+    if (opt.subscribePaths > 0)                         failed |= runSubscribe(opt);
+    if (opt.reconnectPaths > 0)                         failed |= runReconnect(opt);
+    if (opt.shutdownPaths > 0)                          failed |= runShutdown(opt);
+  }
+
+  VAPI_CLIENT.shutdown();
+  return failed;
+}
@@ -0,0 +1,51 @@
+// Copyright (c) 2025 Eclipse Foundation.
+//
+// This program and the accompanying materials are made available under the
+// terms of the MIT License which is available at
+// https://opensource.org/licenses/MIT.
+//
+// SPDX-License-Identifier: MIT
+
+//------------------------------------------------------------------------------
+// vapirecord: record the updates of a live databroker as a trace
+//
+// Linked with the real KuksaClient library. The trace replays into the mock
+// broker with 'vapibench --replay FILE'.
+//------------------------------------------------------------------------------
+#include "../platform/integrations/vehicle-api/vapiclient.hpp"
+#include "updatetrace.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+int main(int argc, char **argv) {
+  if (argc < 5) {
+    std::printf("usage: %s SERVER SECONDS FILE PATH...\n"
+                "  e.g. %s %s 60 drive.tsv Vehicle.Speed Vehicle.Cabin.HVAC.Station.Row1.Driver.FanSpeed\n",
+                argv[0], argv[0], DK_VAPI_DATABROKER);
+    return 2;
+  }
+  const std::string server = argv[1];
+  const int seconds        = std::atoi(argv[2]);
+  const std::string file   = argv[3];
+  const std::vector<std::string> paths(argv + 4, argv + argc);
+
+  if (!VAPI_CLIENT.connectToServer(server, paths)) {
+    return 1;
+  }
+
+  UpdateTrace trace;
+  trace.start();
+  VAPI_CLIENT.subscribe(server, paths, SF_BOTH,
+    [&trace](const std::string &path, const Datapoint &value, const int &field) {
+      trace.add(field, path, value.toString());
+    });
+  std::this_thread::sleep_for(std::chrono::seconds(seconds));
+  VAPI_CLIENT.shutdown();
+
+  if (!trace.save(file)) {
+    std::fprintf(stderr, "cannot write %s\n", file.c_str());
+    return 1;
+  }
+  std::printf("recorded %zu updates on %zu paths to %s\n", trace.entries().size(), paths.size(), file.c_str());
+  return 0;
+}
@@ -12,23 +12,55 @@
 #include <QString>
 #include <QTimer>
 
+#include "../platform/integrations/vehicle-api/actuatorqueue.hpp"
+#include "../platform/integrations/vehicle-api/framecoalescer.hpp"
 #include "../platform/integrations/vehicle-api/vapiclient.hpp"
 #include "../platform/notifications/notificationmanager.hpp"
+#include "vss_signals.hpp"
 
 //------------------------------------------------------------------------------
 // Vehicle API keys
 //
-// These inline constants define the available keys for the vehicle Software Update API.
-// Using these constants throughout your code enables code completion and minimizes errors.
+// The signals this page uses, from the constants generated out of the vss.json
+// the build was configured with (DK_VSS_JSON). The VSS version is fixed at build
+// time, and values written to them are checked against their datatype.
 //------------------------------------------------------------------------------
-QString DK_VSS_VER = "VSS_4.0";
 namespace VehicleAPI {
-  std::string V_Bo_Lights_Beam_Low_IsOn               = "Vehicle.Body.Lights.Beam.Low.IsOn";
-  std::string V_Bo_Lights_Beam_High_IsOn              = "Vehicle.Body.Lights.Beam.High.IsOn";
-  std::string V_Bo_Lights_Hazard_IsSignaling          = "Vehicle.Body.Lights.Hazard.IsSignaling";
-  std::string V_Ca_HVAC_Station_R1_Driver_FanSpeed    = "Vehicle.Cabin.HVAC.Station.Row1.Passenger.FanSpeed";
-  std::string V_Ca_HVAC_Station_R1_Passenger_FanSpeed = "Vehicle.Cabin.HVAC.Station.Row1.Driver.FanSpeed";
-  std::string V_Ca_Seat_R1_DriverSide_Position        = "Vehicle.Cabin.Seat.Row1.DriverSide.Position";
+#if DK_VSS_VERSION_MAJOR >= 4
+  constexpr auto &V_Bo_Lights_Beam_Low_IsOn               = vss::Vehicle::Body::Lights::Beam::Low::IsOn;
+  constexpr auto &V_Bo_Lights_Beam_High_IsOn              = vss::Vehicle::Body::Lights::Beam::High::IsOn;
+  constexpr auto &V_Bo_Lights_Hazard_IsSignaling          = vss::Vehicle::Body::Lights::Hazard::IsSignaling;
+  constexpr auto &V_Ca_HVAC_Station_R1_Driver_FanSpeed    = vss::Vehicle::Cabin::HVAC::Station::Row1::Driver::FanSpeed;
+  constexpr auto &V_Ca_HVAC_Station_R1_Passenger_FanSpeed = vss::Vehicle::Cabin::HVAC::Station::Row1::Passenger::FanSpeed;
+  constexpr auto &V_Ca_Seat_R1_DriverSide_Position        = vss::Vehicle::Cabin::Seat::Row1::DriverSide::Position;
+#else
+  constexpr auto &V_Bo_Lights_Beam_Low_IsOn               = vss::Vehicle::Body::Lights::IsLowBeamOn;
+  constexpr auto &V_Bo_Lights_Beam_High_IsOn              = vss::Vehicle::Body::Lights::IsHighBeamOn;
+  constexpr auto &V_Bo_Lights_Hazard_IsSignaling          = vss::Vehicle::Body::Lights::IsHazardOn;
+  constexpr auto &V_Ca_HVAC_Station_R1_Driver_FanSpeed    = vss::Vehicle::Cabin::HVAC::Station::Row1::Left::FanSpeed;
+  constexpr auto &V_Ca_HVAC_Station_R1_Passenger_FanSpeed = vss::Vehicle::Cabin::HVAC::Station::Row1::Right::FanSpeed;
+  constexpr auto &V_Ca_Seat_R1_DriverSide_Position        = vss::Vehicle::Cabin::Seat::Row1::Pos1::Position;
+#endif
+}
+
+// The keys above, resolved once by the VAPI client; 0 until then
+namespace VehicleSignals {
+  SignalHandle LowBeam;
+  SignalHandle HighBeam;
+  SignalHandle Hazard;
+  SignalHandle DriverFanSpeed;
+  SignalHandle PassengerFanSpeed;
+  SignalHandle SeatPosition;
+}
+
+static void resolveVehicleSignals()
+{
+  VehicleSignals::LowBeam           = VAPI_CLIENT.resolve(DK_VAPI_DATABROKER, VehicleAPI::V_Bo_Lights_Beam_Low_IsOn);
+  VehicleSignals::HighBeam          = VAPI_CLIENT.resolve(DK_VAPI_DATABROKER, VehicleAPI::V_Bo_Lights_Beam_High_IsOn);
+  VehicleSignals::Hazard            = VAPI_CLIENT.resolve(DK_VAPI_DATABROKER, VehicleAPI::V_Bo_Lights_Hazard_IsSignaling);
+  VehicleSignals::DriverFanSpeed    = VAPI_CLIENT.resolve(DK_VAPI_DATABROKER, VehicleAPI::V_Ca_HVAC_Station_R1_Driver_FanSpeed);
+  VehicleSignals::PassengerFanSpeed = VAPI_CLIENT.resolve(DK_VAPI_DATABROKER, VehicleAPI::V_Ca_HVAC_Station_R1_Passenger_FanSpeed);
+  VehicleSignals::SeatPosition      = VAPI_CLIENT.resolve(DK_VAPI_DATABROKER, VehicleAPI::V_Ca_Seat_R1_DriverSide_Position);
 }
 
 //------------------------------------------------------------------------------
@@ -38,6 +70,9 @@ ControlsAsync::ControlsAsync()
     , reconnectionAttempts(0)
     , subscriptionsActive(false)
     , reconnectionTimer(nullptr)
+    , actuatorQueue(nullptr)
+    , frameUpdates(nullptr)
+    , vssSubscriptionId(0)
 {
     qDebug() << __func__ << __LINE__ << "  constructing ControlsAsync";
 
@@ -50,31 +85,63 @@ ControlsAsync::ControlsAsync()
     reconnectionTimer->setSingleShot(true);
     connect(reconnectionTimer, &QTimer::timeout, this, &ControlsAsync::enableAutoReconnection);
 
-    // Initialize the VAPI client instance.
-    DK_VSS_VER = qgetenv("DK_VSS_VER");
-
-    if(DK_VSS_VER == "VSS_3.0") {
-      VehicleAPI::V_Bo_Lights_Beam_Low_IsOn               = "Vehicle.Body.Lights.IsLowBeamOn";
-      VehicleAPI::V_Bo_Lights_Beam_High_IsOn              = "Vehicle.Body.Lights.IsHighBeamOn";
-      VehicleAPI::V_Bo_Lights_Hazard_IsSignaling          = "Vehicle.Body.Lights.IsHazardOn";
-      VehicleAPI::V_Ca_HVAC_Station_R1_Driver_FanSpeed    = "Vehicle.Cabin.HVAC.Station.Row1.Left.FanSpeed";
-      VehicleAPI::V_Ca_HVAC_Station_R1_Passenger_FanSpeed = "Vehicle.Cabin.HVAC.Station.Row1.Right.FanSpeed";
-      VehicleAPI::V_Ca_Seat_R1_DriverSide_Position        = "Vehicle.Cabin.Seat.Row1.Pos1.Position";
-    }
-
     // 1) Build the list of signal paths we want to subscribe to:
     std::vector<std::string> signalPaths = {
-        VehicleAPI::V_Bo_Lights_Beam_Low_IsOn,
-        VehicleAPI::V_Bo_Lights_Beam_High_IsOn,
-        VehicleAPI::V_Bo_Lights_Hazard_IsSignaling,
-        VehicleAPI::V_Ca_Seat_R1_DriverSide_Position,
-        VehicleAPI::V_Ca_HVAC_Station_R1_Driver_FanSpeed,
-        VehicleAPI::V_Ca_HVAC_Station_R1_Passenger_FanSpeed
+        VehicleAPI::V_Bo_Lights_Beam_Low_IsOn.path,
+        VehicleAPI::V_Bo_Lights_Beam_High_IsOn.path,
+        VehicleAPI::V_Bo_Lights_Hazard_IsSignaling.path,
+        VehicleAPI::V_Ca_Seat_R1_DriverSide_Position.path,
+        VehicleAPI::V_Ca_HVAC_Station_R1_Driver_FanSpeed.path,
+        VehicleAPI::V_Ca_HVAC_Station_R1_Passenger_FanSpeed.path
     };
 
     // 2) Connect once (with those paths so the client can internally
     //    store them if it needs them for subscribeAll).
-    if (!VAPI_CLIENT.connectToServer(DK_VAPI_DATABROKER, signalPaths)) {
+    //    The client keeps a failed server for reconnecting, so the
+    //    signals resolve either way.
+    bool connected = VAPI_CLIENT.connectToServer(DK_VAPI_DATABROKER, signalPaths);
+    resolveVehicleSignals();
+
+    // Writes leave the GUI thread; a dragged control is sent at most
+    // every 100 ms and only with its latest value.
+    actuatorQueue = new ActuatorQueue(DK_VAPI_DATABROKER, this);
+    actuatorQueue->setRateLimit(VehicleSignals::SeatPosition, std::chrono::milliseconds(100));
+    actuatorQueue->setRateLimit(VehicleSignals::DriverFanSpeed, std::chrono::milliseconds(100));
+    actuatorQueue->setRateLimit(VehicleSignals::PassengerFanSpeed, std::chrono::milliseconds(100));
+    connect(actuatorQueue, &ActuatorQueue::commandFailed, this, [this](const QString &path, const QString &error) {
+        emit connectionError(QString("Cannot set %1: %2").arg(path, error));
+    });
+
+    // Subscription updates reach the widgets once per frame, with the
+    // latest value of each signal. The fan speeds are scaled by 10 on
+    // the broker, smaller steps do not change the widget.
+    frameUpdates = new FrameCoalescer(this);
+    frameUpdates->addSignal(VehicleSignals::LowBeam, [this](const Datapoint &v) {
+        bool b = false;
+        if (v.get(b)) updateWidget_lightCtr_lowBeam(b);
+    });
+    frameUpdates->addSignal(VehicleSignals::HighBeam, [this](const Datapoint &v) {
+        bool b = false;
+        if (v.get(b)) updateWidget_lightCtr_highBeam(b);
+    });
+    frameUpdates->addSignal(VehicleSignals::Hazard, [this](const Datapoint &v) {
+        bool b = false;
+        if (v.get(b)) updateWidget_lightCtr_Hazard(b);
+    });
+    frameUpdates->addSignal(VehicleSignals::SeatPosition, [this](const Datapoint &v) {
+        int p = 0;
+        if (v.get(p)) updateWidget_seat_driverSide_position(p);
+    });
+    frameUpdates->addSignal(VehicleSignals::DriverFanSpeed, [this](const Datapoint &v) {
+        int speed = 0;
+        if (v.get(speed)) updateWidget_hvac_driverSide_FanSpeed(speed/10);
+    }, std::chrono::milliseconds(0), 10);
+    frameUpdates->addSignal(VehicleSignals::PassengerFanSpeed, [this](const Datapoint &v) {
+        int speed = 0;
+        if (v.get(speed)) updateWidget_hvac_passengerSide_FanSpeed(speed/10);
+    }, std::chrono::milliseconds(0), 10);
+
+    if (!connected) {
         qCritical() << "Could not connect to VAPI server:" << DK_VAPI_DATABROKER;
         lastKnownConnectionState = false;
         emit connectionError(QString("Failed to connect to VAPI server: %1").arg(DK_VAPI_DATABROKER));
@@ -89,49 +156,8 @@ ControlsAsync::ControlsAsync()
     lastKnownConnectionState = true;
     emit connectionStateChanged(true);
 
-    // 3) Now subscribe to *target*‐value updates.
-    //    Our SubscribeCallback signature is:
-    //      (const std::string &path,
-    //       const std::string &value,
-    //       const int         &field)
-    //
-    //    We ignore the ‘field’ here (always target).  Because
-    //    subscribeTarget() will spawn its own thread, we must
-    //    marshal back to the Qt main thread:
-    VAPI_CLIENT.subscribeTarget(
-      DK_VAPI_DATABROKER,
-      signalPaths,
-      [this](const std::string &path,
-             const std::string &value,
-             const int         &field) {
-        Q_UNUSED(field);
-        // invoke our member function in the GUI thread:
-        QMetaObject::invokeMethod(
-          this,
-          [this, path, value]() {
-            this->vssSubsribeCallback(path, value);
-          },
-          Qt::QueuedConnection
-        );
-      }
-    );
-    VAPI_CLIENT.subscribeCurrent(
-      DK_VAPI_DATABROKER,
-      signalPaths,
-      [this](const std::string &path,
-             const std::string &value,
-             const int         &field) {
-        Q_UNUSED(field);
-        // invoke our member function in the GUI thread:
-        QMetaObject::invokeMethod(
-          this,
-          [this, path, value]() {
-            this->vssSubsribeCallback(path, value);
-          },
-          Qt::QueuedConnection
-        );
-      }
-    );
+    // 3) Now subscribe to current and target value updates
+    subscribeSignals();
     subscriptionsActive = true;
 
     // Start connection monitoring after subscriptions are set up
@@ -140,107 +166,59 @@ ControlsAsync::ControlsAsync()
 
 void ControlsAsync::init()
 {
-    // Give the subscription threads a moment to spin up.
-    QThread::msleep(300);
-
-    // Use the templated getTargetValueAs<T>() so we don't
-    // have to do manual stoi/string compares:
-    bool b     = false;
-    int  i_val = 0;
-
-    if (VAPI_CLIENT.getTargetValueAs<bool>(
-          DK_VAPI_DATABROKER,
-          VehicleAPI::V_Bo_Lights_Beam_Low_IsOn,
-          b)) {
-      updateWidget_lightCtr_lowBeam(b);
-    }
-    
-    if (VAPI_CLIENT.getTargetValueAs<bool>(
-          DK_VAPI_DATABROKER,
-          VehicleAPI::V_Bo_Lights_Beam_High_IsOn,
-          b)) {
-      updateWidget_lightCtr_highBeam(b);
-    }
-
-    if (VAPI_CLIENT.getTargetValueAs<bool>(
-          DK_VAPI_DATABROKER,
-          VehicleAPI::V_Bo_Lights_Hazard_IsSignaling,
-          b)) {
-      updateWidget_lightCtr_Hazard(b);
-    }
-
-    if (VAPI_CLIENT.getTargetValueAs<int>(
-          DK_VAPI_DATABROKER,
-          VehicleAPI::V_Ca_Seat_R1_DriverSide_Position,
-          i_val)) {
-      updateWidget_seat_driverSide_position(i_val);
-    }
-
-    if (VAPI_CLIENT.getTargetValueAs<int>(
-          DK_VAPI_DATABROKER,
-          VehicleAPI::V_Ca_HVAC_Station_R1_Driver_FanSpeed,
-          i_val)) {
-      int speed = (i_val)/10;
-      updateWidget_hvac_driverSide_FanSpeed(speed);
-    }
-
-    if (VAPI_CLIENT.getTargetValueAs<int>(
-          DK_VAPI_DATABROKER,
-          VehicleAPI::V_Ca_HVAC_Station_R1_Passenger_FanSpeed,
-          i_val)) {
-      int speed = (i_val)/10;
-      updateWidget_hvac_passengerSide_FanSpeed(speed);
+    // Served from the subscription cache once the first updates are in,
+    // otherwise read from the broker; one call for all widgets.
+    auto results = VAPI_CLIENT.getMany(
+      DK_VAPI_DATABROKER,
+      {
+        VehicleAPI::V_Bo_Lights_Beam_Low_IsOn.path,
+        VehicleAPI::V_Bo_Lights_Beam_High_IsOn.path,
+        VehicleAPI::V_Bo_Lights_Hazard_IsSignaling.path,
+        VehicleAPI::V_Ca_Seat_R1_DriverSide_Position.path,
+        VehicleAPI::V_Ca_HVAC_Station_R1_Driver_FanSpeed.path,
+        VehicleAPI::V_Ca_HVAC_Station_R1_Passenger_FanSpeed.path
+      },
+      SF_TARGET);
+
+    for (const auto &r : results) {
+      if (r.ok) {
+        frameUpdates->deliverNow(r.handle, r.value);
+      }
     }
 }
 
-void ControlsAsync::vssSubsribeCallback(const std::string &path,
-                                        const std::string &value)
+void ControlsAsync::subscribeSignals()
 {
-    qDebug() << "[SubsCB]" 
-             << QString::fromStdString(path)
-             << "->" 
-             << QString::fromStdString(value);
-
-    // Mirror exactly what you had before, but now
-    // you're assured this runs on the Qt main thread:
-
-    if (path == VehicleAPI::V_Bo_Lights_Beam_Low_IsOn) {
-      bool b = (value == "true");
-      updateWidget_lightCtr_lowBeam(b);
-    }
-    if (path == VehicleAPI::V_Bo_Lights_Beam_High_IsOn) {
-      bool b = (value == "true");
-      updateWidget_lightCtr_highBeam(b);
+    // The subscription is kept by the VAPI client; after a reconnect
+    // only its broker streams have to be opened again.
+    if (vssSubscriptionId != 0) {
+      VAPI_CLIENT.resubscribe(DK_VAPI_DATABROKER);
+      return;
     }
-    else if (path == VehicleAPI::V_Bo_Lights_Hazard_IsSignaling) {
-      bool b = (value == "true");
-      updateWidget_lightCtr_Hazard(b);
-    }
-    else if (path == VehicleAPI::V_Ca_Seat_R1_DriverSide_Position) {
-      try {
-        int p = std::stoi(value);
-        updateWidget_seat_driverSide_position(p);
-      }
-      catch (...) { /* ignore parse errors */ }
-    }
-    else if (path == VehicleAPI::V_Ca_HVAC_Station_R1_Driver_FanSpeed) {
-      try {
-        int speed = std::stoi(value)/10;
-        updateWidget_hvac_driverSide_FanSpeed(speed);
-      }
-      catch (...) { }
-    }
-    else if (path == VehicleAPI::V_Ca_HVAC_Station_R1_Passenger_FanSpeed) {
-      try {
-        int speed = std::stoi(value)/10;
-        updateWidget_hvac_passengerSide_FanSpeed(speed);
+
+    // Both fields update the same widgets, so we ignore 'field'.
+    // Callbacks run on the VAPI client's dispatcher thread; post() only
+    // stores the value, the GUI thread picks it up with the next frame.
+    vssSubscriptionId = VAPI_CLIENT.subscribe(
+      {
+        VehicleSignals::LowBeam,
+        VehicleSignals::HighBeam,
+        VehicleSignals::Hazard,
+        VehicleSignals::SeatPosition,
+        VehicleSignals::DriverFanSpeed,
+        VehicleSignals::PassengerFanSpeed
+      },
+      SF_BOTH,
+      [this](SignalHandle handle, const Datapoint &value, int field) {
+        Q_UNUSED(field);
+        frameUpdates->post(handle, value);
       }
-      catch (...) { }
-    }
+    );
 }
 
-// QML‐invokable slots also make use of the templated get…As<T>() and
-// setCurrent/TargetValue<T>() to simplify:
+// QML‐invokable slots queue current and target for the actuator
+// queue's worker thread and return; failures come back through
+// commandFailed.
 
 void ControlsAsync::qml_setApi_lightCtr_LowBeam(bool sts)
 {
@@ -253,23 +231,7 @@ void ControlsAsync::qml_setApi_lightCtr_LowBeam(bool sts)
         return;
     }
 
-    VAPI_CLIENT.setCurrentValue<bool>(
-      DK_VAPI_DATABROKER,
-      VehicleAPI::V_Bo_Lights_Beam_Low_IsOn,
-      sts);
-    VAPI_CLIENT.setTargetValue<bool>(
-      DK_VAPI_DATABROKER,
-      VehicleAPI::V_Bo_Lights_Beam_Low_IsOn,
-      sts);
-
-    // verify
-    bool newSts = false;
-    if (VAPI_CLIENT.getTargetValueAs<bool>(
-          DK_VAPI_DATABROKER,
-          VehicleAPI::V_Bo_Lights_Beam_Low_IsOn,
-          newSts)) {
-      qDebug() << "Verified LowBeam =" << newSts;
-    }
+    actuatorQueue->submit(VehicleSignals::LowBeam, vssValue(VehicleAPI::V_Bo_Lights_Beam_Low_IsOn, sts), SF_BOTH);
 }
 
 void ControlsAsync::qml_setApi_lightCtr_HighBeam(bool sts)
@@ -283,20 +245,7 @@ void ControlsAsync::qml_setApi_lightCtr_HighBeam(bool sts)
         return;
     }
 
-    VAPI_CLIENT.setCurrentValue<bool>(
-      DK_VAPI_DATABROKER,
-      VehicleAPI::V_Bo_Lights_Beam_High_IsOn, sts);
-    VAPI_CLIENT.setTargetValue<bool>(
-      DK_VAPI_DATABROKER,
-      VehicleAPI::V_Bo_Lights_Beam_High_IsOn, sts);
-
-    bool newSts = false;
-    if (VAPI_CLIENT.getTargetValueAs<bool>(
-          DK_VAPI_DATABROKER,
-          VehicleAPI::V_Bo_Lights_Beam_High_IsOn,
-          newSts)) {
-      qDebug() << "Verified HighBeam =" << newSts;
-    }
+    actuatorQueue->submit(VehicleSignals::HighBeam, vssValue(VehicleAPI::V_Bo_Lights_Beam_High_IsOn, sts), SF_BOTH);
 }
 
 void ControlsAsync::qml_setApi_lightCtr_Hazard(bool sts)
@@ -310,22 +259,7 @@ void ControlsAsync::qml_setApi_lightCtr_Hazard(bool sts)
         return;
     }
 
-    VAPI_CLIENT.setCurrentValue<bool>(
-      DK_VAPI_DATABROKER,
-      VehicleAPI::V_Bo_Lights_Hazard_IsSignaling,
-      sts);
-    VAPI_CLIENT.setTargetValue<bool>(
-      DK_VAPI_DATABROKER,
-      VehicleAPI::V_Bo_Lights_Hazard_IsSignaling,
-      sts);
-
-    bool newSts = false;
-    if (VAPI_CLIENT.getTargetValueAs<bool>(
-          DK_VAPI_DATABROKER,
-          VehicleAPI::V_Bo_Lights_Hazard_IsSignaling,
-          newSts)) {
-      qDebug() << "Verified Hazard =" << newSts;
-    }
+    actuatorQueue->submit(VehicleSignals::Hazard, vssValue(VehicleAPI::V_Bo_Lights_Hazard_IsSignaling, sts), SF_BOTH);
 }
 
 void ControlsAsync::qml_setApi_seat_driverSide_position(int position)
@@ -345,22 +279,7 @@ void ControlsAsync::qml_setApi_seat_driverSide_position(int position)
     qDebug() << "QML → set SeatPos =" << position;
     uint8_t p = static_cast<uint8_t>(position);
 
-    VAPI_CLIENT.setCurrentValue<uint8_t>(
-      DK_VAPI_DATABROKER,
-      VehicleAPI::V_Ca_Seat_R1_DriverSide_Position,
-      p);
-    VAPI_CLIENT.setTargetValue<uint8_t>(
-      DK_VAPI_DATABROKER,
-      VehicleAPI::V_Ca_Seat_R1_DriverSide_Position,
-      p);
-
-    int newPos = 0;
-    if (VAPI_CLIENT.getTargetValueAs<int>(
-          DK_VAPI_DATABROKER,
-          VehicleAPI::V_Ca_Seat_R1_DriverSide_Position,
-          newPos)) {
-      qDebug() << "Verified SeatPos =" << newPos;
-    }
+    actuatorQueue->submit(VehicleSignals::SeatPosition, vssValue(VehicleAPI::V_Ca_Seat_R1_DriverSide_Position, p), SF_BOTH);
 }
 
 void ControlsAsync::qml_setApi_hvac_driverSide_FanSpeed(uint8_t speed)
@@ -374,22 +293,7 @@ void ControlsAsync::qml_setApi_hvac_driverSide_FanSpeed(uint8_t speed)
 
     uint8_t scaledSpeed = speed * 10;
     qDebug() << "QML → set DriverFanSpeed =" << speed << "(scaled" << scaledSpeed << ")";
-    VAPI_CLIENT.setCurrentValue<uint8_t>(
-      DK_VAPI_DATABROKER,
-      VehicleAPI::V_Ca_HVAC_Station_R1_Driver_FanSpeed,
-      scaledSpeed);
-    VAPI_CLIENT.setTargetValue<uint8_t>(
-      DK_VAPI_DATABROKER,
-      VehicleAPI::V_Ca_HVAC_Station_R1_Driver_FanSpeed,
-      scaledSpeed);
-
-    int newSpeed = 0;
-    if (VAPI_CLIENT.getTargetValueAs<int>(
-          DK_VAPI_DATABROKER,
-          VehicleAPI::V_Ca_HVAC_Station_R1_Driver_FanSpeed,
-          newSpeed)) {
-      qDebug() << "Verified DriverFanSpeed =" << (newSpeed);
-    }
+    actuatorQueue->submit(VehicleSignals::DriverFanSpeed, vssValue(VehicleAPI::V_Ca_HVAC_Station_R1_Driver_FanSpeed, scaledSpeed), SF_BOTH);
 }
 
 void ControlsAsync::qml_setApi_hvac_passengerSide_FanSpeed(uint8_t speed)
@@ -403,22 +307,7 @@ void ControlsAsync::qml_setApi_hvac_passengerSide_FanSpeed(uint8_t speed)
 
     uint8_t scaledSpeed = speed * 10;
     qDebug() << "QML → set PassengerFanSpeed =" << speed << "(scaled" << scaledSpeed << ")";
-    VAPI_CLIENT.setCurrentValue<uint8_t>(
-      DK_VAPI_DATABROKER,
-      VehicleAPI::V_Ca_HVAC_Station_R1_Passenger_FanSpeed,
-      scaledSpeed);
-    VAPI_CLIENT.setTargetValue<uint8_t>(
-      DK_VAPI_DATABROKER,
-      VehicleAPI::V_Ca_HVAC_Station_R1_Passenger_FanSpeed,
-      scaledSpeed);
-
-    int newSpeed = 0;
-    if (VAPI_CLIENT.getTargetValueAs<int>(
-          DK_VAPI_DATABROKER,
-          VehicleAPI::V_Ca_HVAC_Station_R1_Passenger_FanSpeed,
-          newSpeed)) {
-      qDebug() << "Verified PassengerFanSpeed =" << (newSpeed);
-    }
+    actuatorQueue->submit(VehicleSignals::PassengerFanSpeed, vssValue(VehicleAPI::V_Ca_HVAC_Station_R1_Passenger_FanSpeed, scaledSpeed), SF_BOTH);
 }
 
 ControlsAsync::~ControlsAsync()
@@ -433,10 +322,14 @@ ControlsAsync::~ControlsAsync()
         reconnectionTimer->stop();
     }
 
+    // No more updates for our widgets
+    if (vssSubscriptionId != 0) {
+        VAPI_CLIENT.unsubscribe(vssSubscriptionId);
+    }
+
     // Use async shutdown to prevent blocking Qt application termination
-    // This detaches subscription threads immediately without waiting for them to join
-    // Prevents "QThread: Destroyed while thread is still running" errors
-    // while allowing quick application shutdown
+    // This only stops the subscription threads; they are joined, within a
+    // bounded time, when the client itself goes away at exit
     VAPI_CLIENT.shutdownAsync();
 
     qDebug() << __func__ << __LINE__ << "  destroyed ControlsAsync";
@@ -488,53 +381,7 @@ void ControlsAsync::reestablishSubscriptions()
 {
     qInfo() << "Re-establishing subscriptions";
 
-    // Build the list of signal paths we want to subscribe to
-    std::vector<std::string> signalPaths = {
-        VehicleAPI::V_Bo_Lights_Beam_Low_IsOn,
-        VehicleAPI::V_Bo_Lights_Beam_High_IsOn,
-        VehicleAPI::V_Bo_Lights_Hazard_IsSignaling,
-        VehicleAPI::V_Ca_Seat_R1_DriverSide_Position,
-        VehicleAPI::V_Ca_HVAC_Station_R1_Driver_FanSpeed,
-        VehicleAPI::V_Ca_HVAC_Station_R1_Passenger_FanSpeed
-    };
-
-    // Re-subscribe to target values
-    VAPI_CLIENT.subscribeTarget(
-      DK_VAPI_DATABROKER,
-      signalPaths,
-      [this](const std::string &path,
-             const std::string &value,
-             const int         &field) {
-        Q_UNUSED(field);
-        // invoke our member function in the GUI thread:
-        QMetaObject::invokeMethod(
-          this,
-          [this, path, value]() {
-            this->vssSubsribeCallback(path, value);
-          },
-          Qt::QueuedConnection
-        );
-      }
-    );
-
-    // Re-subscribe to current values
-    VAPI_CLIENT.subscribeCurrent(
-      DK_VAPI_DATABROKER,
-      signalPaths,
-      [this](const std::string &path,
-             const std::string &value,
-             const int         &field) {
-        Q_UNUSED(field);
-        // invoke our member function in the GUI thread:
-        QMetaObject::invokeMethod(
-          this,
-          [this, path, value]() {
-            this->vssSubsribeCallback(path, value);
-          },
-          Qt::QueuedConnection
-        );
-      }
-    );
+    subscribeSignals();
 
     subscriptionsActive = true;
     emit subscriptionsRestored();
@@ -19,6 +19,9 @@
 #include <QMap>
 #include "QVariant"
 
+class ActuatorQueue;
+class FrameCoalescer;
+
 class ControlsAsync: public QObject
 {
     Q_OBJECT
@@ -42,8 +45,6 @@ public:
     Q_INVOKABLE void forceReconnect();
     Q_INVOKABLE int getReconnectionAttempts() const;
 
-    void vssSubsribeCallback(const std::string &updatePath, const std::string &updateValue); 
-
 Q_SIGNALS:
     // Lighting signals
     void updateWidget_lightCtr_lowBeam(bool sts);
@@ -68,12 +69,16 @@ private:
     int reconnectionAttempts;
     bool subscriptionsActive;
     QTimer *reconnectionTimer;
+    ActuatorQueue *actuatorQueue;
+    FrameCoalescer *frameUpdates;
+    quint64 vssSubscriptionId;
 
     // Internal methods for connection management
     void checkConnectionState();
     void handleConnectionLost();
     void handleConnectionRestored();
     void reestablishSubscriptions();
+    void subscribeSignals();
     void enableAutoReconnection();
 };
 
@@ -39,6 +39,9 @@ QString DK_DREAMKIT_UNIQUE_SERIAL_NUMBER_FILE = DK_MGR_DIR + "serial-number";
 
 QMutex digitalAutoPrototypeMutex;
 
+// docker run of a prototype reports back through the run_state event of dk_manager
+#define DK_APP_START_TIMEOUT_MS 15000
+
 DigitalAutoAppCheckThread::DigitalAutoAppCheckThread(DigitalAutoAppAsync *parent)
 {
     m_digitalAutoAppAsync = parent;
@@ -170,6 +173,103 @@ DigitalAutoAppAsync::DigitalAutoAppAsync()
     m_timer_apprunningcheck = new QTimer(this);
     connect(m_timer_apprunningcheck, SIGNAL(timeout()), this, SLOT(checkRunningAppSts()));
     m_timer_apprunningcheck->start(3000);
+
+    m_appStartTimeout = new QTimer(this);
+    m_appStartTimeout->setSingleShot(true);
+    connect(m_appStartTimeout, SIGNAL(timeout()), this, SLOT(onAppStartTimeout()));
+
+    // polling above stays the fallback while dk_manager's local API is not reachable
+    m_dkManager = new DkManagerClient(DK_MGR_DIR + "dk_manager.sock", this);
+    connect(m_dkManager, &DkManagerClient::connectionChanged, this, &DigitalAutoAppAsync::onDkManagerConnection);
+    connect(m_dkManager, &DkManagerClient::prototypesChanged, this, &DigitalAutoAppAsync::onPrototypesChanged);
+    connect(m_dkManager, &DkManagerClient::runStateChanged, this, &DigitalAutoAppAsync::onRunStateChanged);
+    connect(m_dkManager, &DkManagerClient::replyReceived, this, &DigitalAutoAppAsync::onDkManagerReply);
+    m_dkManager->start();
+}
+
+void DigitalAutoAppAsync::onDkManagerConnection(bool connected)
+{
+    if (connected) {
+        m_timer_apprunningcheck->stop();
+    }
+    else {
+        m_runningApps.clear();
+        m_timer_apprunningcheck->start(3000);
+    }
+}
+
+void DigitalAutoAppAsync::onPrototypesChanged(const QJsonArray &prototypes)
+{
+    bool sameList = (prototypes.size() == m_appListInfo.size());
+    for (int i = 0; i < prototypes.size(); i++) {
+        QJsonObject obj = prototypes[i].toObject();
+        QString appId = obj.value("id").toString();
+        if (obj.value("running").toBool()) {
+            m_runningApps.insert(appId);
+        }
+        else {
+            m_runningApps.remove(appId);
+        }
+        if (sameList) {
+            QString lastDeploy = QString().setNum(obj.value("lastDeploy").toDouble(), 'g', 13);
+            sameList = (m_appListInfo[i].appId == appId && m_appListInfo[i].name == obj.value("name").toString()
+                        && m_appListInfo[i].lastDeploy == lastDeploy);
+        }
+    }
+
+    // only rebuild the view when the list itself changed
+    if (!sameList) {
+        loadAppList(prototypes);
+    }
+    for (int i = 0; i < m_appListInfo.size(); i++) {
+        updateAppRunningSts(m_appListInfo[i].appId, m_runningApps.contains(m_appListInfo[i].appId), i);
+    }
+}
+
+void DigitalAutoAppAsync::onRunStateChanged(const QString &appId, bool running)
+{
+    if (running) {
+        m_runningApps.insert(appId);
+    }
+    else {
+        m_runningApps.remove(appId);
+    }
+
+    int len = m_appListInfo.size();
+    for (int i = 0; i < len; i++) {
+        if (m_appListInfo[i].appId == appId) {
+            updateAppRunningSts(appId, running, i);
+            break;
+        }
+    }
+
+    if (running && appId == m_pendingStartAppId) {
+        QString name = m_pendingStartName;
+        m_appStartTimeout->stop();
+        m_pendingStartAppId.clear();
+        m_pendingStartRequest = -1;
+        handleResults(appId, true, "<b>"+name+"</b>" + " is started successfully.");
+    }
+}
+
+void DigitalAutoAppAsync::onDkManagerReply(int id, const QJsonObject &reply)
+{
+    if (id == m_pendingStartRequest && !reply.value("ok").toBool() && !m_pendingStartAppId.isEmpty()) {
+        m_appStartTimeout->stop();
+        onAppStartTimeout();
+    }
+}
+
+void DigitalAutoAppAsync::onAppStartTimeout()
+{
+    if (m_pendingStartAppId.isEmpty()) {
+        return;
+    }
+    QString appId = m_pendingStartAppId;
+    QString name = m_pendingStartName;
+    m_pendingStartAppId.clear();
+    m_pendingStartRequest = -1;
+    handleResults(appId, false, "<b>"+name+"</b>" + " is NOT started successfully.<br><br>Please contact the car OEM for more information !!!");
 }
 
 void DigitalAutoAppAsync::checkRunningAppSts()
@@ -214,7 +314,10 @@ void DigitalAutoAppAsync::updateDeploymentProgress()
 
     updateProgressValue(m_deploymentProgressPercent);
     if(m_deploymentProgressPercent == 100) {
-        initSubscribeAppFromDB();
+        // dk_manager already pushed the new list, only the progress is shown
+        if (!m_dkManager || !m_dkManager->isConnected()) {
+            initSubscribeAppFromDB();
+        }
     }
     else if(m_deploymentProgressPercent == 200) {
         m_timer->stop();
@@ -224,12 +327,11 @@ void DigitalAutoAppAsync::updateDeploymentProgress()
 
 Q_INVOKABLE void DigitalAutoAppAsync::initSubscribeAppFromDB()
 {
-    // using mutex to project run-time data struct. e.g., if removing app and deploying app occurs quite the same time,
-    // then this function shall be called at the same time. it would corrupt the m_appListInfo
-    digitalAutoPrototypeMutex.lock();
-
-    clearAppListView();
-    updateBoardSerialNumber(m_serialNo);
+    if (m_dkManager && m_dkManager->isConnected()) {
+        // the list comes back through onPrototypesChanged()
+        m_dkManager->requestPrototypes();
+        return;
+    }
 
     QString filename = digitalautoDeployFile;
 
@@ -239,45 +341,59 @@ Q_INVOKABLE void DigitalAutoAppAsync::initSubscribeAppFromDB()
         QString data = QString(file.readAll());
         file.close();
 //        qDebug() << "raw file: " << data;
-        QJsonArray jsonAppList = QJsonDocument::fromJson(data.toUtf8()).array();
+        loadAppList(QJsonDocument::fromJson(data.toUtf8()).array());
+    }
+    else {
+        qDebug() << filename << " is not existing";
+        digitalAutoPrototypeMutex.lock();
+        clearAppListView();
+        updateBoardSerialNumber(m_serialNo);
+        digitalAutoPrototypeMutex.unlock();
+    }
+}
 
-        QList<DigitalAutoAppListStruct> appListInfo;
+void DigitalAutoAppAsync::loadAppList(const QJsonArray &jsonAppList)
+{
+    // using mutex to project run-time data struct. e.g., if removing app and deploying app occurs quite the same time,
+    // then this function shall be called at the same time. it would corrupt the m_appListInfo
+    digitalAutoPrototypeMutex.lock();
 
-        for (const auto obj : jsonAppList) {
-            DigitalAutoAppListStruct appInfo;
+    clearAppListView();
+    updateBoardSerialNumber(m_serialNo);
 
-//            qDebug() << obj.toObject().value("name").toString();
-            appInfo.name = obj.toObject().value("name").toString();
+    QList<DigitalAutoAppListStruct> appListInfo;
 
-//            qDebug() << obj.toObject().value("id").toString();
-            appInfo.appId = obj.toObject().value("id").toString();
+    for (const auto obj : jsonAppList) {
+        DigitalAutoAppListStruct appInfo;
 
-//            qDebug() << QString().setNum(obj.toObject().value("lastDeploy").toDouble(), 'g', 13);
-            appInfo.lastDeploy = QString().setNum(obj.toObject().value("lastDeploy").toDouble(), 'g', 13);
+//        qDebug() << obj.toObject().value("name").toString();
+        appInfo.name = obj.toObject().value("name").toString();
 
-            appInfo.isSubscribed = false;
+//        qDebug() << obj.toObject().value("id").toString();
+        appInfo.appId = obj.toObject().value("id").toString();
 
-            int len = m_appListInfo.size();
-            for (int i = 0; i < len; i++) {
-                if (m_appListInfo[i].appId == appInfo.appId) {
-                    appInfo.isSubscribed = m_appListInfo[i].isSubscribed;
-                    break;
-                }
-            }
+//        qDebug() << QString().setNum(obj.toObject().value("lastDeploy").toDouble(), 'g', 13);
+        appInfo.lastDeploy = QString().setNum(obj.toObject().value("lastDeploy").toDouble(), 'g', 13);
 
-            appListInfo.append(appInfo);
+        appInfo.isSubscribed = false;
 
-//            qDebug() << appInfo.name << " - " << appInfo.appId << " - " << appInfo.isSubscribed << " -------------------------- ";
-            appendAppInfoToAppList(appInfo.name, appInfo.appId, appInfo.isSubscribed);
+        int len = m_appListInfo.size();
+        for (int i = 0; i < len; i++) {
+            if (m_appListInfo[i].appId == appInfo.appId) {
+                appInfo.isSubscribed = m_appListInfo[i].isSubscribed;
+                break;
+            }
         }
 
-        m_appListInfo.clear();
-        m_appListInfo = appListInfo;
-    }
-    else {
-        qDebug() << filename << " is not existing";
+        appListInfo.append(appInfo);
+
+//        qDebug() << appInfo.name << " - " << appInfo.appId << " - " << appInfo.isSubscribed << " -------------------------- ";
+        appendAppInfoToAppList(appInfo.name, appInfo.appId, appInfo.isSubscribed);
     }
 
+    m_appListInfo.clear();
+    m_appListInfo = appListInfo;
+
     digitalAutoPrototypeMutex.unlock();
 }
 
@@ -346,7 +462,18 @@ Q_INVOKABLE void DigitalAutoAppAsync::executeApp(const QString name, const QStri
 {
     QString dockerps = digitalautoDeployFolder + "listcmd.log";
     QString cmd = "";
-    if (isSubsribed) {
+    if (isSubsribed && m_dkManager && m_dkManager->isConnected()) {
+        if (m_runningApps.contains(appId)) {
+            qDebug() << appId << " is already open";
+            return;
+        }
+        // same container as below, started by dk_manager; the result comes with the run_state event
+        m_pendingStartAppId = appId;
+        m_pendingStartName = name;
+        m_pendingStartRequest = m_dkManager->startApp(appId);
+        m_appStartTimeout->start(DK_APP_START_TIMEOUT_MS);
+    }
+    else if (isSubsribed) {
         {
             cmd = "docker ps > " + dockerps;
             system(cmd.toUtf8());            
@@ -377,11 +504,16 @@ Q_INVOKABLE void DigitalAutoAppAsync::executeApp(const QString name, const QStri
         }
     }
     else {
-        QString cmd;
-        cmd += "docker kill " + appId + " &";
-        // cmd += "docker kill " + appId ;
-        qDebug() << cmd;
-        system(cmd.toUtf8());
+        if (m_dkManager && m_dkManager->isConnected()) {
+            m_dkManager->stopApp(appId);
+        }
+        else {
+            QString cmd;
+            cmd += "docker kill " + appId + " &";
+            // cmd += "docker kill " + appId ;
+            qDebug() << cmd;
+            system(cmd.toUtf8());
+        }
 
         int len = m_appListInfo.size();
         for (int i = 0; i < len; i++) {
@@ -14,6 +14,10 @@
 #include <QList>
 #include <QFileSystemWatcher>
 #include <QTimer>
+#include <QSet>
+#include <QJsonArray>
+#include <QJsonObject>
+#include "../platform/integrations/dk-manager/dkmanagerclient.hpp"
 
 typedef struct {
     QString appId;
@@ -78,14 +82,29 @@ public Q_SLOTS:
     void fileChanged(const QString& path);
     void updateDeploymentProgress();
     void checkRunningAppSts();
+    void onDkManagerConnection(bool connected);
+    void onPrototypesChanged(const QJsonArray &prototypes);
+    void onRunStateChanged(const QString &appId, bool running);
+    void onDkManagerReply(int id, const QJsonObject &reply);
+    void onAppStartTimeout();
 
 private:
+    void loadAppList(const QJsonArray &jsonAppList);
+
     QList<DigitalAutoAppListStruct> m_appListInfo;
     DigitalAutoAppCheckThread *workerThread;
     QTimer *m_timer;
     QTimer *m_timer_apprunningcheck;
     int m_deploymentProgressPercent = 0;
     QString m_serialNo;
+
+    // dk_manager's local API; the file watcher and docker ps polling are only used without it
+    DkManagerClient *m_dkManager = nullptr;
+    QSet<QString> m_runningApps;
+    QString m_pendingStartAppId;
+    QString m_pendingStartName;
+    int m_pendingStartRequest = -1;
+    QTimer *m_appStartTimeout;
 };
 
 #endif // DIGITALAUTO_H
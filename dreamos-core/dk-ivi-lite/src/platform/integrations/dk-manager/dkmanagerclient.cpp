@@ -0,0 +1,125 @@
+// Copyright (c) 2025 Eclipse Foundation.
+//
+// This program and the accompanying materials are made available under the
+// terms of the MIT License which is available at
+// https://opensource.org/licenses/MIT.
+//
+// SPDX-License-Identifier: MIT
+#include "dkmanagerclient.hpp"
+#include <QDebug>
+#include <QJsonDocument>
+#include <QtEndian>
+
+DkManagerClient::DkManagerClient(const QString &socketPath, QObject *parent)
+    : QObject(parent)
+    , m_socketPath(socketPath)
+    , m_socket(new QLocalSocket(this))
+    , m_reconnectTimer(new QTimer(this))
+{
+    connect(m_socket, &QLocalSocket::connected, this, &DkManagerClient::onConnected);
+    connect(m_socket, &QLocalSocket::disconnected, this, &DkManagerClient::onDisconnected);
+    connect(m_socket, &QLocalSocket::readyRead, this, &DkManagerClient::onReadyRead);
+    connect(m_socket, &QLocalSocket::errorOccurred, this, [this](QLocalSocket::LocalSocketError) {
+        if (m_socket->state() != QLocalSocket::ConnectedState && !m_reconnectTimer->isActive()) {
+            m_reconnectTimer->start(RECONNECT_INTERVAL);
+        }
+    });
+
+    m_reconnectTimer->setSingleShot(true);
+    connect(m_reconnectTimer, &QTimer::timeout, this, &DkManagerClient::tryConnect);
+}
+
+DkManagerClient::~DkManagerClient()
+{
+    m_socket->disconnect(this);
+    m_socket->abort();
+}
+
+void DkManagerClient::start()
+{
+    tryConnect();
+}
+
+void DkManagerClient::tryConnect()
+{
+    if (m_socket->state() != QLocalSocket::UnconnectedState) {
+        return;
+    }
+    m_socket->connectToServer(m_socketPath);
+}
+
+void DkManagerClient::onConnected()
+{
+    qDebug() << "[DkManagerClient] connected to" << m_socketPath;
+    m_buffer.clear();
+    emit connectionChanged(true);
+    // the state may have changed while disconnected
+    requestPrototypes();
+}
+
+void DkManagerClient::onDisconnected()
+{
+    qDebug() << "[DkManagerClient] disconnected from" << m_socketPath;
+    emit connectionChanged(false);
+    m_reconnectTimer->start(RECONNECT_INTERVAL);
+}
+
+void DkManagerClient::onReadyRead()
+{
+    m_buffer += m_socket->readAll();
+    while (m_buffer.size() >= 4) {
+        quint32 length = qFromBigEndian<quint32>(m_buffer.constData());
+        if (length > MAX_FRAME) {
+            qWarning() << "[DkManagerClient] frame too large, reconnect";
+            m_socket->abort();
+            return;
+        }
+        if (static_cast<quint32>(m_buffer.size()) < 4 + length) {
+            return;
+        }
+        QJsonObject msg = QJsonDocument::fromJson(m_buffer.mid(4, length)).object();
+        m_buffer.remove(0, 4 + length);
+
+        QString event = msg.value("event").toString();
+        if (event == "prototypes") {
+            emit prototypesChanged(msg.value("prototypes").toArray());
+        } else if (event == "run_state") {
+            emit runStateChanged(msg.value("app_id").toString(), msg.value("running").toBool());
+        } else if (msg.contains("id")) {
+            if (msg.value("cmd").toString() == "list_prototypes") {
+                emit prototypesChanged(msg.value("prototypes").toArray());
+            }
+            emit replyReceived(msg.value("id").toInt(), msg);
+        }
+    }
+}
+
+int DkManagerClient::send(QJsonObject request)
+{
+    if (!isConnected()) {
+        return -1;
+    }
+    int id = m_nextId++;
+    request["id"] = id;
+    QByteArray json = QJsonDocument(request).toJson(QJsonDocument::Compact);
+    char header[4];
+    qToBigEndian<quint32>(json.size(), header);
+    m_socket->write(header, 4);
+    m_socket->write(json);
+    return id;
+}
+
+int DkManagerClient::requestPrototypes()
+{
+    return send(QJsonObject{{"cmd", "list_prototypes"}});
+}
+
+int DkManagerClient::startApp(const QString &appId)
+{
+    return send(QJsonObject{{"cmd", "start"}, {"app_id", appId}});
+}
+
+int DkManagerClient::stopApp(const QString &appId)
+{
+    return send(QJsonObject{{"cmd", "stop"}, {"app_id", appId}});
+}
@@ -0,0 +1,62 @@
+// Copyright (c) 2025 Eclipse Foundation.
+//
+// This program and the accompanying materials are made available under the
+// terms of the MIT License which is available at
+// https://opensource.org/licenses/MIT.
+//
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <QObject>
+#include <QTimer>
+#include <QLocalSocket>
+#include <QJsonArray>
+#include <QJsonObject>
+
+/**
+ * @brief Client of dk_manager's local API (unix socket 'dk_manager/dk_manager.sock')
+ *
+ * Messages are a 4 byte big-endian length followed by JSON. dk_manager pushes the
+ * prototype list whenever prototypes.json changes and the run state of containers
+ * as docker reports it, so nothing has to be polled here.
+ * Reconnects on its own; isConnected() tells whether the events can be relied on.
+ */
+class DkManagerClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DkManagerClient(const QString &socketPath, QObject *parent = nullptr);
+    ~DkManagerClient();
+
+    void start();
+    bool isConnected() const { return m_socket->state() == QLocalSocket::ConnectedState; }
+
+    // return the request id, or -1 when not connected
+    int requestPrototypes();
+    int startApp(const QString &appId);
+    int stopApp(const QString &appId);
+
+signals:
+    void connectionChanged(bool connected);
+    void prototypesChanged(const QJsonArray &prototypes);
+    void runStateChanged(const QString &appId, bool running);
+    void replyReceived(int id, const QJsonObject &reply);
+
+private slots:
+    void onConnected();
+    void onDisconnected();
+    void onReadyRead();
+    void tryConnect();
+
+private:
+    int send(QJsonObject request);
+
+    static constexpr int RECONNECT_INTERVAL = 1000;
+    static constexpr quint32 MAX_FRAME = 4 * 1024 * 1024;
+
+    QString m_socketPath;
+    QLocalSocket *m_socket;
+    QTimer *m_reconnectTimer;
+    QByteArray m_buffer;
+    int m_nextId = 1;
+};
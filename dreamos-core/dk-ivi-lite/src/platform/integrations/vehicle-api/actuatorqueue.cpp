@@ -0,0 +1,115 @@
+// Copyright (c) 2025 Eclipse Foundation.
+//
+// This program and the accompanying materials are made available under the
+// terms of the MIT License which is available at
+// https://opensource.org/licenses/MIT.
+//
+// SPDX-License-Identifier: MIT
+#include "actuatorqueue.hpp"
+#include <QDebug>
+
+ActuatorQueue::ActuatorQueue(const std::string &serverURI, QObject *parent)
+    : QObject(parent)
+    , m_serverURI(serverURI)
+{
+    m_worker = std::thread(&ActuatorQueue::run, this);
+}
+
+ActuatorQueue::~ActuatorQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    // at most the write in progress is waited for, queued values are dropped
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+void ActuatorQueue::submit(SignalHandle handle, const Datapoint &value, int fields)
+{
+    if (!handle) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Command &cmd = m_commands[handle];
+        if (cmd.queued) {
+            cmd.coalesced++;
+        } else {
+            cmd.queued = true;
+            cmd.coalesced = 0;
+            m_order.push_back(handle);
+        }
+        cmd.value = value;
+        cmd.fields = fields;
+    }
+    m_cv.notify_one();
+}
+
+void ActuatorQueue::setRateLimit(SignalHandle handle, std::chrono::milliseconds minInterval)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_commands[handle].minInterval = minInterval;
+}
+
+void ActuatorQueue::setDefaultRateLimit(std::chrono::milliseconds minInterval)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_defaultInterval = minInterval;
+}
+
+void ActuatorQueue::run()
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<EntryUpdate> due;
+    std::vector<int> coalesced;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stop) {
+        // everything whose interval has passed; the rest waits for the earliest of them
+        auto now = Clock::now();
+        auto wakeUp = Clock::time_point::max();
+        for (auto it = m_order.begin(); it != m_order.end();) {
+            Command &cmd = m_commands[*it];
+            auto interval = (cmd.minInterval.count() < 0) ? m_defaultInterval : cmd.minInterval;
+            auto next = cmd.lastWrite + interval;
+            if (next <= now) {
+                due.push_back(EntryUpdate{std::string(), cmd.value, cmd.fields, *it});
+                coalesced.push_back(cmd.coalesced);
+                cmd.queued = false;
+                cmd.lastWrite = now;
+                it = m_order.erase(it);
+            } else {
+                wakeUp = std::min(wakeUp, next);
+                ++it;
+            }
+        }
+
+        if (due.empty()) {
+            if (wakeUp == Clock::time_point::max()) {
+                m_cv.wait(lock);
+            } else {
+                m_cv.wait_until(lock, wakeUp);
+            }
+            continue;
+        }
+
+        lock.unlock();
+        auto results = VAPI_CLIENT.setMany(m_serverURI, due);
+        for (size_t i = 0; i < results.size(); i++) {
+            QString path = QString::fromStdString(results[i].path);
+            if (results[i].ok) {
+                emit commandCompleted(path, coalesced[i]);
+            } else {
+                qWarning() << "ActuatorQueue: cannot write" << path << ":" << QString::fromStdString(results[i].error);
+                emit commandFailed(path, QString::fromStdString(results[i].error));
+            }
+        }
+        due.clear();
+        coalesced.clear();
+        lock.lock();
+    }
+}
@@ -0,0 +1,71 @@
+// Copyright (c) 2025 Eclipse Foundation.
+//
+// This program and the accompanying materials are made available under the
+// terms of the MIT License which is available at
+// https://opensource.org/licenses/MIT.
+//
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <QObject>
+#include <QString>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include "vapiclient.hpp"
+
+/**
+ * @brief Outbound actuator commands, written to the broker on a worker thread
+ *
+ * submit() only queues and returns. Per signal the last submitted value wins: a
+ * value that was not written yet is replaced, so dragging a slider ends in one
+ * write of the final position. A signal with a rate limit is written at most once
+ * per interval. Whatever is due is written with one VAPIClient::setMany().
+ * The signals are emitted from the worker thread; connected QObjects get them
+ * queued on their own thread.
+ */
+class ActuatorQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ActuatorQueue(const std::string &serverURI, QObject *parent = nullptr);
+    ~ActuatorQueue();
+
+    // fields: SF_CURRENT / SF_TARGET / SF_BOTH
+    // handle: from VAPIClient::resolve() on this queue's server
+    void submit(SignalHandle handle, const Datapoint &value, int fields);
+
+    // minimum time between two writes of a signal; 0 writes as fast as the broker takes them
+    void setRateLimit(SignalHandle handle, std::chrono::milliseconds minInterval);
+    void setDefaultRateLimit(std::chrono::milliseconds minInterval);
+
+signals:
+    // 'coalesced' submissions were replaced by the written one
+    void commandCompleted(const QString &path, int coalesced);
+    void commandFailed(const QString &path, const QString &error);
+
+private:
+    struct Command {
+        Datapoint value;
+        int fields = 0;
+        int coalesced = 0;
+        bool queued = false;
+        std::chrono::steady_clock::time_point lastWrite;
+        std::chrono::milliseconds minInterval{-1}; // -1: the default
+    };
+
+    void run();
+
+    std::string m_serverURI;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stop = false;
+    std::unordered_map<SignalHandle, Command> m_commands;
+    // signals with a value to write, oldest submission first
+    std::deque<SignalHandle> m_order;
+    std::chrono::milliseconds m_defaultInterval{0};
+    std::thread m_worker;
+};
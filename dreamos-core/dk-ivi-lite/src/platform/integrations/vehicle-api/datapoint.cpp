@@ -0,0 +1,207 @@
+// Copyright (c) 2025 Eclipse Foundation.
+//
+// This program and the accompanying materials are made available under the
+// terms of the MIT License which is available at
+// https://opensource.org/licenses/MIT.
+//
+// SPDX-License-Identifier: MIT
+#include "datapoint.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <sstream>
+
+namespace {
+
+// a number of the whole text, without allocating
+bool parseScalar(const char *first, const char *last, Datapoint::Value &out) {
+  if (first == last) return false;
+  if (last - first == 4 && std::equal(first, last, "true")) {
+    out = true;
+    return true;
+  }
+  if (last - first == 5 && std::equal(first, last, "false")) {
+    out = false;
+    return true;
+  }
+  if (*first == '-') {
+    int64_t i = 0;
+    auto r = std::from_chars(first, last, i);
+    if (r.ec == std::errc() && r.ptr == last) {
+      out = i;
+      return true;
+    }
+  } else {
+    uint64_t u = 0;
+    auto r = std::from_chars(first, last, u);
+    if (r.ec == std::errc() && r.ptr == last) {
+      out = u;
+      return true;
+    }
+  }
+  // strtod needs a terminated string; every caller passes a range that
+  // ends at a delimiter or at the end of a std::string
+  char *end = nullptr;
+  double d = std::strtod(first, &end);
+  if (end == last && end != first) {
+    out = d;
+    return true;
+  }
+  return false;
+}
+
+const char *skipSpace(const char *p, const char *last) {
+  while (p != last && (*p == ' ' || *p == '\t')) ++p;
+  return p;
+}
+
+bool parseArray(const std::string &text, Datapoint::Value &out) {
+  // "[a, b, c]"; the element type is the widest one seen
+  std::vector<Datapoint::Value> items;
+  const char *p = text.data() + 1;
+  const char *last = text.data() + text.size() - 1;
+  bool allBool = true, allSigned = true, allUnsigned = true, allNumber = true;
+  while (true) {
+    p = skipSpace(p, last);
+    if (p == last) break;
+    const char *itemEnd = p;
+    while (itemEnd != last && *itemEnd != ',') ++itemEnd;
+    const char *trimmed = itemEnd;
+    while (trimmed != p && (trimmed[-1] == ' ' || trimmed[-1] == '\t')) --trimmed;
+    if (*p == '"' && trimmed - p >= 2 && trimmed[-1] == '"') {
+      items.emplace_back(std::string(p + 1, trimmed - 1));
+    } else {
+      Datapoint::Value v;
+      std::string item(p, trimmed);
+      if (parseScalar(item.data(), item.data() + item.size(), v)) {
+        items.push_back(v);
+      } else {
+        items.emplace_back(item);
+      }
+    }
+    const auto &v = items.back();
+    allBool     = allBool && std::holds_alternative<bool>(v);
+    allSigned   = allSigned && (std::holds_alternative<int64_t>(v) || std::holds_alternative<uint64_t>(v));
+    allUnsigned = allUnsigned && std::holds_alternative<uint64_t>(v);
+    allNumber   = allNumber && (std::holds_alternative<int64_t>(v) || std::holds_alternative<uint64_t>(v) ||
+                                std::holds_alternative<double>(v));
+    p = (itemEnd == last) ? last : itemEnd + 1;
+  }
+
+  if (items.empty() || allUnsigned) {
+    std::vector<uint64_t> a;
+    for (const auto &v : items) a.push_back(std::get<uint64_t>(v));
+    out = std::move(a);
+  } else if (allBool) {
+    std::vector<bool> a;
+    for (const auto &v : items) a.push_back(std::get<bool>(v));
+    out = std::move(a);
+  } else if (allSigned) {
+    std::vector<int64_t> a;
+    for (const auto &v : items) {
+      a.push_back(std::holds_alternative<int64_t>(v) ? std::get<int64_t>(v)
+                                                     : static_cast<int64_t>(std::get<uint64_t>(v)));
+    }
+    out = std::move(a);
+  } else if (allNumber) {
+    std::vector<double> a;
+    for (const auto &v : items) {
+      a.push_back(std::visit([](const auto &n) -> double {
+        if constexpr (std::is_arithmetic_v<std::decay_t<decltype(n)>>) return static_cast<double>(n);
+        else return 0;
+      }, v));
+    }
+    out = std::move(a);
+  } else {
+    std::vector<std::string> a;
+    for (size_t i = 0; i < items.size(); ++i) {
+      if (auto *s = std::get_if<std::string>(&items[i])) {
+        a.push_back(*s);
+      } else {
+        a.push_back(Datapoint(items[i]).toString());
+      }
+    }
+    out = std::move(a);
+  }
+  return true;
+}
+
+template<typename T>
+void appendText(std::ostringstream &os, const T &v) {
+  if constexpr (std::is_same_v<T, bool>) {
+    os << (v ? "true" : "false");
+  } else if constexpr (std::is_same_v<T, int8_t> || std::is_same_v<T, uint8_t>) {
+    os << static_cast<int>(v);
+  } else {
+    os << v;
+  }
+}
+
+} // namespace
+
+bool Datapoint::parse(const std::string &text, Datapoint &out) {
+  if (text.empty()) {
+    out.mValue = std::monostate();
+    return false;
+  }
+  if (text.size() >= 2 && text.front() == '[' && text.back() == ']') {
+    return parseArray(text, out.mValue);
+  }
+  if (parseScalar(text.data(), text.data() + text.size(), out.mValue)) {
+    return true;
+  }
+  if (auto *s = std::get_if<std::string>(&out.mValue)) {
+    s->assign(text);
+  } else {
+    out.mValue = text;
+  }
+  return true;
+}
+
+bool Datapoint::operator==(const Datapoint &other) const {
+  return std::visit([](const auto &a, const auto &b) {
+    using A = std::decay_t<decltype(a)>;
+    using B = std::decay_t<decltype(b)>;
+    constexpr bool numbers = std::is_arithmetic_v<A> && std::is_arithmetic_v<B> &&
+                             !std::is_same_v<A, bool> && !std::is_same_v<B, bool>;
+    if constexpr (std::is_same_v<A, B>) {
+      return a == b;
+    } else if constexpr (!numbers) {
+      return false;
+    } else if constexpr (std::is_same_v<A, float> || std::is_same_v<B, float>) {
+      // a float sent as text only round-trips at float precision
+      return static_cast<float>(a) == static_cast<float>(b);
+    } else if constexpr (std::is_floating_point_v<A> || std::is_floating_point_v<B>) {
+      return static_cast<double>(a) == static_cast<double>(b);
+    } else if constexpr (std::is_signed_v<A> == std::is_signed_v<B>) {
+      return a == b;
+    } else if constexpr (std::is_signed_v<A>) {
+      return a >= 0 && static_cast<uint64_t>(a) == static_cast<uint64_t>(b);
+    } else {
+      return b >= 0 && static_cast<uint64_t>(a) == static_cast<uint64_t>(b);
+    }
+  }, mValue, other.mValue);
+}
+
+std::string Datapoint::toString() const {
+  std::ostringstream os;
+  std::visit([&os](const auto &v) {
+    using T = std::decay_t<decltype(v)>;
+    if constexpr (std::is_same_v<T, std::monostate>) {
+    } else if constexpr (std::is_same_v<T, std::vector<bool>> ||
+                         std::is_same_v<T, std::vector<int64_t>> ||
+                         std::is_same_v<T, std::vector<uint64_t>> ||
+                         std::is_same_v<T, std::vector<double>> ||
+                         std::is_same_v<T, std::vector<std::string>>) {
+      os << '[';
+      for (size_t i = 0; i < v.size(); ++i) {
+        if (i) os << ", ";
+        appendText(os, static_cast<typename T::value_type>(v[i]));
+      }
+      os << ']';
+    } else {
+      appendText(os, v);
+    }
+  }, mValue);
+  return os.str();
+}
@@ -0,0 +1,141 @@
+// Copyright (c) 2025 Eclipse Foundation.
+//
+// This program and the accompanying materials are made available under the
+// terms of the MIT License which is available at
+// https://opensource.org/licenses/MIT.
+//
+// SPDX-License-Identifier: MIT
+#ifndef DATAPOINT_HPP
+#define DATAPOINT_HPP
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+//----------------------------------------------------------------------
+// Datapoint: a typed VSS value and the time it was taken.
+//
+// Scalars are held inline, so copying or converting them does not
+// allocate; only strings and arrays own memory.
+//----------------------------------------------------------------------
+class Datapoint {
+public:
+  using Timestamp = std::chrono::system_clock::time_point;
+  using Value = std::variant<std::monostate,
+                             bool,
+                             int8_t, int16_t, int32_t, int64_t,
+                             uint8_t, uint16_t, uint32_t, uint64_t,
+                             float, double,
+                             std::string,
+                             std::vector<bool>,
+                             std::vector<int64_t>,
+                             std::vector<uint64_t>,
+                             std::vector<double>,
+                             std::vector<std::string>>;
+
+  Datapoint() = default;
+
+  template<typename T, typename = std::enable_if_t<!std::is_same_v<std::decay_t<T>, Datapoint>>>
+  Datapoint(T v, Timestamp ts = Timestamp()) : mValue(std::move(v)), mTimestamp(ts) {}
+
+  Datapoint(const char *v, Timestamp ts = Timestamp()) : mValue(std::string(v)), mTimestamp(ts) {}
+
+  // Parse the text form the broker client returns ("true", "42", "-1.5",
+  // "[1, 2]", anything else is a string). Integers become int64/uint64,
+  // fractions double; get<T>() narrows them. Reuses the string storage
+  // of 'out', so scalars never allocate.
+  static bool parse(const std::string &text, Datapoint &out);
+
+  bool isValid() const { return !std::holds_alternative<std::monostate>(mValue); }
+
+  const Value &value() const { return mValue; }
+  Timestamp timestamp() const { return mTimestamp; }
+  void setTimestamp(Timestamp ts) { mTimestamp = ts; }
+
+  // Convert to T. Numbers convert between widths as long as the value
+  // fits (and is whole for integer targets); bool takes bool, 0 or 1.
+  // Strings and arrays only convert to their own type.
+  template<typename T>
+  bool get(T &out) const {
+    if constexpr (std::is_arithmetic_v<T>) {
+      return std::visit([&out](const auto &v) { return convertNumber(v, out); }, mValue);
+    } else {
+      if (auto *v = std::get_if<T>(&mValue)) {
+        out = *v;
+        return true;
+      }
+      return false;
+    }
+  }
+
+  template<typename T>
+  T as(T fallback = T()) const {
+    T out;
+    return get(out) ? out : fallback;
+  }
+
+  // Text form, for logging.
+  std::string toString() const;
+
+  // Numbers compare by value whatever their width: the broker's text
+  // form does not keep it, so a written uint8 comes back as uint64.
+  // Everything else compares by type and value.
+  bool operator==(const Datapoint &other) const;
+  bool operator!=(const Datapoint &other) const { return !(*this == other); }
+
+private:
+  template<typename S, typename T>
+  static bool convertNumber(const S &v, T &out) {
+    if constexpr (!std::is_arithmetic_v<S>) {
+      return false;
+    } else if constexpr (std::is_same_v<T, bool>) {
+      if constexpr (std::is_same_v<S, bool>) {
+        out = v;
+        return true;
+      } else {
+        if (v != 0 && v != 1) return false;
+        out = (v == 1);
+        return true;
+      }
+    } else if constexpr (std::is_floating_point_v<T>) {
+      out = static_cast<T>(v);
+      return true;
+    } else if constexpr (std::is_same_v<S, bool>) {
+      out = v ? 1 : 0;
+      return true;
+    } else if constexpr (std::is_floating_point_v<S>) {
+      if (!std::isfinite(v) || std::trunc(v) != v ||
+          v < static_cast<S>(std::numeric_limits<T>::min()) ||
+          v >= static_cast<S>(std::numeric_limits<T>::max()) + 1) {
+        return false;
+      }
+      out = static_cast<T>(v);
+      return true;
+    } else {
+      if (!inRange<T>(v)) return false;
+      out = static_cast<T>(v);
+      return true;
+    }
+  }
+
+  template<typename T, typename S>
+  static bool inRange(S v) {
+    if constexpr (std::is_signed_v<S> && !std::is_signed_v<T>) {
+      return v >= 0 && static_cast<std::make_unsigned_t<S>>(v) <= std::numeric_limits<T>::max();
+    } else if constexpr (!std::is_signed_v<S> && std::is_signed_v<T>) {
+      return v <= static_cast<std::make_unsigned_t<T>>(std::numeric_limits<T>::max());
+    } else {
+      return v >= std::numeric_limits<T>::min() && v <= std::numeric_limits<T>::max();
+    }
+  }
+
+  Value     mValue;
+  Timestamp mTimestamp;
+};
+
+#endif // DATAPOINT_HPP
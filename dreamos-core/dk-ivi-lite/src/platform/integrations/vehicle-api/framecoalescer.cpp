@@ -0,0 +1,118 @@
+// Copyright (c) 2025 Eclipse Foundation.
+//
+// This program and the accompanying materials are made available under the
+// terms of the MIT License which is available at
+// https://opensource.org/licenses/MIT.
+//
+// SPDX-License-Identifier: MIT
+#include "framecoalescer.hpp"
+#include <QGuiApplication>
+#include <QScreen>
+#include <cmath>
+
+FrameCoalescer::FrameCoalescer(QObject *parent)
+    : QObject(parent)
+{
+    // pace the drains like the display
+    qreal refreshRate = QGuiApplication::primaryScreen() ? QGuiApplication::primaryScreen()->refreshRate() : 60;
+    m_frameInterval = qMax(1, qRound(1000.0 / (refreshRate > 0 ? refreshRate : 60)));
+
+    m_frameTimer.setSingleShot(true);
+    m_frameTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_frameTimer, &QTimer::timeout, this, &FrameCoalescer::drain);
+    m_clock.start();
+}
+
+void FrameCoalescer::addSignal(SignalHandle handle, Handler handler,
+                               std::chrono::milliseconds minInterval, double deadband)
+{
+    m_slots.emplace_back();
+    Slot &slot = m_slots.back();
+    slot.handler = std::move(handler);
+    slot.minInterval = minInterval;
+    slot.deadband = deadband;
+    if (handle >= m_byHandle.size()) {
+        m_byHandle.resize(handle + 1, nullptr);
+    }
+    m_byHandle[handle] = &slot;
+}
+
+void FrameCoalescer::post(SignalHandle handle, const Datapoint &value)
+{
+    Slot *target = slot(handle);
+    if (!target) {
+        return;
+    }
+    Slot &slot = *target;
+    slot.buffers[slot.back] = value;
+    slot.back = slot.middle.exchange(slot.back | FRESH, std::memory_order_acq_rel) & 0x3;
+
+    if (!m_scheduled.exchange(true, std::memory_order_acq_rel)) {
+        QMetaObject::invokeMethod(this, &FrameCoalescer::schedule, Qt::QueuedConnection);
+    }
+}
+
+void FrameCoalescer::deliverNow(SignalHandle handle, const Datapoint &value)
+{
+    Slot *target = slot(handle);
+    if (!target) {
+        return;
+    }
+    Slot &slot = *target;
+    slot.delivered = value;
+    slot.deliveredAt = m_clock.elapsed();
+    slot.handler(value);
+}
+
+void FrameCoalescer::schedule()
+{
+    // the next frame boundary after the last drain
+    qint64 wait = qMax<qint64>(0, m_lastDrain + m_frameInterval - m_clock.elapsed());
+    if (!m_frameTimer.isActive()) {
+        m_frameTimer.start(int(wait));
+    }
+}
+
+void FrameCoalescer::drain()
+{
+    // posts from here on schedule the next drain
+    m_scheduled.store(false, std::memory_order_release);
+    m_lastDrain = m_clock.elapsed();
+
+    qint64 nextDue = -1;
+    for (Slot &slot : m_slots) {
+        if (slot.middle.load(std::memory_order_acquire) & FRESH) {
+            slot.front = slot.middle.exchange(slot.front, std::memory_order_acq_rel) & 0x3;
+            slot.held = true;
+        }
+        if (!slot.held) {
+            continue;
+        }
+
+        const Datapoint &value = slot.buffers[slot.front];
+        if (slot.deliveredAt >= 0 && slot.minInterval.count() > 0) {
+            qint64 due = slot.deliveredAt + slot.minInterval.count();
+            if (due > m_lastDrain) {
+                nextDue = (nextDue < 0) ? due : qMin(nextDue, due);
+                continue;
+            }
+        }
+        slot.held = false;
+
+        double current = 0;
+        double previous = 0;
+        if (slot.deadband > 0 && slot.delivered.isValid() &&
+            value.get(current) && slot.delivered.get(previous) &&
+            std::fabs(current - previous) < slot.deadband) {
+            continue;
+        }
+        slot.delivered = value;
+        slot.deliveredAt = m_lastDrain;
+        slot.handler(value);
+    }
+
+    // values held back by minInterval
+    if (nextDue >= 0 && !m_scheduled.exchange(true, std::memory_order_acq_rel)) {
+        m_frameTimer.start(int(qMax<qint64>(nextDue - m_clock.elapsed(), m_frameInterval)));
+    }
+}
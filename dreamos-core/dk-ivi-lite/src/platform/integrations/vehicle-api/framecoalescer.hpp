@@ -0,0 +1,90 @@
+// Copyright (c) 2025 Eclipse Foundation.
+//
+// This program and the accompanying materials are made available under the
+// terms of the MIT License which is available at
+// https://opensource.org/licenses/MIT.
+//
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <vector>
+#include "vapiclient.hpp"
+
+/**
+ * @brief Hands subscription updates to the GUI once per frame
+ *
+ * Every signal has a latest-value slot. post() runs on the subscription thread
+ * and only overwrites the slot (a lock-free triple buffer, so neither side ever
+ * waits for the other). The first post() after a drain schedules the next one;
+ * the GUI thread then delivers each slot that changed, at most once per frame.
+ * A burst of 100 Hz updates on many paths costs one event per frame instead of
+ * one per update.
+ *
+ * Per signal, optional filters run on the GUI side: minInterval delays a value
+ * until the interval since the last delivery has passed, deadband drops
+ * numeric changes smaller than it.
+ *
+ * Register all signals before the first post(); the slot lookup is not locked.
+ */
+class FrameCoalescer : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Handler = std::function<void(const Datapoint &value)>;
+
+    explicit FrameCoalescer(QObject *parent = nullptr);
+
+    // handler runs on the GUI thread
+    void addSignal(SignalHandle handle, Handler handler,
+                   std::chrono::milliseconds minInterval = std::chrono::milliseconds(0),
+                   double deadband = 0);
+
+    // any thread; one writer per signal at a time
+    void post(SignalHandle handle, const Datapoint &value);
+
+    // GUI thread: run the handler right away, without the filters
+    void deliverNow(SignalHandle handle, const Datapoint &value);
+
+private:
+    static constexpr uint8_t FRESH = 0x4;
+
+    struct Slot {
+        Handler handler;
+        std::chrono::milliseconds minInterval{0};
+        double deadband = 0;
+
+        Datapoint buffers[3];
+        // index of the buffer between writer and reader, FRESH when it holds a new value
+        std::atomic<uint8_t> middle{1};
+        uint8_t back = 0;   // writer side
+        uint8_t front = 2;  // reader side
+
+        // GUI side
+        Datapoint delivered;
+        bool held = false;  // front value waits for minInterval
+        qint64 deliveredAt = -1;
+    };
+
+    void schedule();
+    void drain();
+    Slot *slot(SignalHandle handle) const
+    {
+        return handle < m_byHandle.size() ? m_byHandle[handle] : nullptr;
+    }
+
+    std::deque<Slot> m_slots;
+    // indexed by handle, null for signals without a slot
+    std::vector<Slot *> m_byHandle;
+    std::atomic<bool> m_scheduled{false};
+    QTimer m_frameTimer;
+    QElapsedTimer m_clock;
+    qint64 m_lastDrain = 0;
+    int m_frameInterval;
+};
@@ -6,9 +6,15 @@
 //
 // SPDX-License-Identifier: MIT
 #include "vapiclient.hpp"
-#include <future>
+#include <algorithm>
 #include <chrono>
 
+// an update that differs from a write of ours is taken as older than
+// the write until this long after it
+static constexpr auto kWriteEchoTimeout = std::chrono::milliseconds(1000);
+// shutdown() waits this long for all connections together
+static constexpr auto kShutdownDeadline = std::chrono::milliseconds(200);
+
 
 VAPIClient& VAPIClient::instance() {
   static VAPIClient inst;
@@ -40,8 +46,8 @@ bool VAPIClient::connectToServer(const std::string &serverURI,
     client->connect();
     client->getServerInfo();
 
-    ClientEntry entry;
-    entry.client = std::move(client);
+    auto entry = std::make_unique<ClientEntry>();
+    entry->client = std::move(client);
     mClients_.try_emplace(serverURI, std::move(entry));
 
     std::cout << "[VAPIClient] Connected to " << serverURI << "\n";
@@ -54,8 +60,8 @@ bool VAPIClient::connectToServer(const std::string &serverURI,
     // Create client entry for future reconnection attempts
     try {
       auto client = std::make_unique<KuksaClient::KuksaClient>(cfg);
-      ClientEntry entry;
-      entry.client = std::move(client);
+      auto entry = std::make_unique<ClientEntry>();
+      entry->client = std::move(client);
       mClients_.try_emplace(serverURI, std::move(entry));
       std::cout << "[VAPIClient] Created client entry for future reconnection to " << serverURI << "\n";
     } catch (const std::exception &e2) {
@@ -74,7 +80,7 @@ VAPIClient::findClient(const std::string &serverURI) {
     std::cerr << "[VAPIClient] No client for server " << serverURI << "\n";
     return nullptr;
   }
-  return it->second.client.get();
+  return it->second->client.get();
 }
 
 KuksaClient::KuksaClient*
@@ -85,7 +91,7 @@ VAPIClient::findClient(const std::string &serverURI) const {
     std::cerr << "[VAPIClient] No client for server " << serverURI << "\n";
     return nullptr;
   }
-  return it->second.client.get();
+  return it->second->client.get();
 }
 
 bool VAPIClient::getCurrentValue(const std::string &serverURI,
@@ -106,63 +112,603 @@ bool VAPIClient::getTargetValue(const std::string &serverURI,
   return !outValue.empty();
 }
 
-bool VAPIClient::subscribeCurrent(const std::string               &serverURI,
-                                  const std::vector<std::string> &paths,
-                                  SubscribeCallback               callback) {
+bool VAPIClient::get(const std::string &serverURI,
+                     const std::string &path,
+                     Datapoint         &out,
+                     int                field) {
   auto *c = findClient(serverURI);
   if (!c) return false;
+  std::string text = (field == SF_TARGET) ? c->getTargetValue(path) : c->getCurrentValue(path);
+  out.setTimestamp(std::chrono::system_clock::now());
+  return Datapoint::parse(text, out);
+}
+
+VAPIClient::Signal* VAPIClient::resolveSignal(const std::string &serverURI,
+                                              const std::string &path,
+                                              SignalHandle      *handle) {
+  ClientEntry *entry = findEntry(serverURI);
+  if (!entry) {
+    std::cerr << "[VAPIClient] No client for server " << serverURI << "\n";
+    return nullptr;
+  }
+
+  std::lock_guard lock(mSignalsMtx_);
+  std::string key = serverURI + '\n' + path;
+  auto it = mSignalIds_.find(key);
+  if (it != mSignalIds_.end()) {
+    if (handle) *handle = it->second;
+    return mSignalStore_[it->second - 1].get();
+  }
+  if (mSignalStore_.size() + 1 >= kMaxSignals) {
+    std::cerr << "[VAPIClient] Too many signals, cannot resolve " << path << "\n";
+    return nullptr;
+  }
+
+  auto sig = std::make_unique<Signal>();
+  sig->serverURI = serverURI;
+  sig->path      = path;
+  sig->entry     = entry;
+  mSignalStore_.push_back(std::move(sig));
+  auto h = static_cast<SignalHandle>(mSignalStore_.size());
+  mSignalIds_.emplace(std::move(key), h);
+  // published last: a reader that sees the pointer sees the whole record
+  mSignals_[h].store(mSignalStore_.back().get(), std::memory_order_release);
+  if (handle) *handle = h;
+  return mSignalStore_.back().get();
+}
+
+SignalHandle VAPIClient::resolve(const std::string &serverURI, const std::string &path) {
+  SignalHandle h = 0;
+  resolveSignal(serverURI, path, &h);
+  return h;
+}
+
+const std::string& VAPIClient::signalPath(SignalHandle handle) const {
+  static const std::string none;
+  Signal *sig = findSignal(handle);
+  return sig ? sig->path : none;
+}
+
+const std::string& VAPIClient::signalServer(SignalHandle handle) const {
+  static const std::string none;
+  Signal *sig = findSignal(handle);
+  return sig ? sig->serverURI : none;
+}
+
+size_t VAPIClient::signalType(SignalHandle handle) const {
+  Signal *sig = findSignal(handle);
+  return sig ? sig->valueType.load(std::memory_order_relaxed) : 0;
+}
+
+bool VAPIClient::get(SignalHandle handle, Datapoint &out, int field) {
+  Signal *sig = findSignal(handle);
+  if (!sig) return false;
+  auto *c = sig->entry->client.get();
+  std::string text = (field == SF_TARGET) ? c->getTargetValue(sig->path) : c->getCurrentValue(sig->path);
+  out.setTimestamp(std::chrono::system_clock::now());
+  return Datapoint::parse(text, out);
+}
+
+bool VAPIClient::isSettable(const Datapoint &value) {
+  return std::visit([](const auto &v) {
+    using T = std::decay_t<decltype(v)>;
+    return std::is_arithmetic_v<T> || std::is_same_v<T, std::string>;
+  }, value.value());
+}
 
-  // Sequential subscription to prevent race conditions during gRPC setup
+bool VAPIClient::brokerWrite(KuksaClient::KuksaClient *c,
+                             const std::string        &path,
+                             const Datapoint          &value,
+                             int                       fields,
+                             std::string              &error) {
+  try {
+    return std::visit([c, &path, fields, &error](const auto &v) {
+      using T = std::decay_t<decltype(v)>;
+      if constexpr (std::is_arithmetic_v<T> || std::is_same_v<T, std::string>) {
+        if (fields & SF_CURRENT) c->setCurrentValue<T>(path, v);
+        if (fields & SF_TARGET)  c->setTargetValue<T>(path, v);
+        return true;
+      } else {
+        error = "unsupported value type";
+        return false;
+      }
+    }, value.value());
+  } catch (const std::exception &e) {
+    error = e.what();
+    return false;
+  }
+}
+
+void VAPIClient::cacheWrite(Signal *sig, const Datapoint &value, int fields, WriteUndo &undo) {
+  static const int cachedFields[] = { SF_CURRENT, SF_TARGET };
+  if (!sig->subscribedFields) return;
+
+  Datapoint written = value;
+  written.setTimestamp(std::chrono::system_clock::now());
+  for (int i = 0; i < 2; i++) {
+    // only fields a subscription will confirm
+    if (!(fields & sig->subscribedFields & cachedFields[i])) continue;
+    auto &f = sig->cache.field(cachedFields[i]);
+    undo.before[i]  = f;
+    undo.touched[i] = true;
+    f.value   = written;
+    f.written = written;
+    f.valid   = true;
+    f.pending = true;
+  }
+}
+
+void VAPIClient::cacheRevert(Signal *sig, const WriteUndo &undo) {
+  static const int cachedFields[] = { SF_CURRENT, SF_TARGET };
+  for (int i = 0; i < 2; i++) {
+    auto &f = sig->cache.field(cachedFields[i]);
+    // unless the broker has sent something newer meanwhile
+    if (undo.touched[i] && f.pending) {
+      f = undo.before[i];
+    }
+  }
+}
+
+bool VAPIClient::set(const std::string &serverURI,
+                     const std::string &path,
+                     const Datapoint   &value,
+                     int                fields) {
+  auto results = setMany(serverURI, { EntryUpdate{path, value, fields} });
+  if (!results[0].ok) {
+    std::cerr << "[VAPIClient] Cannot set " << path << ": " << results[0].error << std::endl;
+  }
+  return results[0].ok;
+}
+
+bool VAPIClient::set(SignalHandle handle, const Datapoint &value, int fields) {
+  Signal *sig = findSignal(handle);
+  if (!sig) return false;
+  EntryUpdate update{std::string(), value, fields, handle};
+  auto results = writeSignals(sig->entry, { update }, { sig });
+  if (!results[0].ok) {
+    std::cerr << "[VAPIClient] Cannot set " << sig->path << ": " << results[0].error << std::endl;
+  }
+  return results[0].ok;
+}
+
+std::vector<EntryResult> VAPIClient::getMany(const std::string              &serverURI,
+                                             const std::vector<std::string> &paths,
+                                             int                             field,
+                                             bool                            useCache) {
+  std::vector<EntryResult> results(paths.size());
+  auto *c = findClient(serverURI);
+  ClientEntry *entry = findEntry(serverURI);
+
+  std::vector<Signal*> signals(paths.size(), nullptr);
+  for (size_t i = 0; entry && i < paths.size(); i++) {
+    signals[i] = resolveSignal(serverURI, paths[i], &results[i].handle);
+  }
+
+  // one lock for everything the cache has, so the values belong together
+  std::vector<size_t> missing;
   {
-    std::lock_guard lock(mClientsMtx_);
-    auto &entry = mClients_.at(serverURI);
-
-    // Create single thread that handles all current value subscriptions sequentially
-    std::thread subThread([c, paths, callback]() {
-      for (const auto &p : paths) {
-        try {
-          c->subscribeWithReconnect(p, callback, KuksaClient::FT_VALUE);
-          // Small delay between subscriptions to prevent gRPC resource conflicts
-          std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        } catch (const std::exception& e) {
-          std::cerr << "[VAPIClient] Failed to subscribe to current value for " << p << ": " << e.what() << std::endl;
-        }
+    std::unique_lock<std::mutex> lock;
+    if (entry && useCache) lock = std::unique_lock(entry->mtx);
+    for (size_t i = 0; i < paths.size(); i++) {
+      results[i].path = paths[i];
+      if (lock.owns_lock() && signals[i] && signals[i]->cache.field(field).valid) {
+        results[i].value = signals[i]->cache.field(field).value;
+        results[i].ok    = true;
+        continue;
       }
-    });
-    entry.subThreads.emplace_back(std::move(subThread));
+      missing.push_back(i);
+    }
   }
+
+  for (size_t i : missing) {
+    if (!c) {
+      results[i].error = "no client for " + serverURI;
+      continue;
+    }
+    try {
+      std::string text = (field == SF_TARGET) ? c->getTargetValue(paths[i]) : c->getCurrentValue(paths[i]);
+      results[i].value.setTimestamp(std::chrono::system_clock::now());
+      results[i].ok = Datapoint::parse(text, results[i].value);
+      if (!results[i].ok) results[i].error = "no value";
+    } catch (const std::exception &e) {
+      results[i].error = e.what();
+    }
+  }
+  return results;
+}
+
+std::vector<EntryResult> VAPIClient::setMany(const std::string              &serverURI,
+                                             const std::vector<EntryUpdate> &updates) {
+  ClientEntry *entry = findEntry(serverURI);
+  std::vector<Signal*> signals(updates.size(), nullptr);
+  for (size_t i = 0; entry && i < updates.size(); i++) {
+    signals[i] = updates[i].handle ? findSignal(updates[i].handle)
+                                   : resolveSignal(serverURI, updates[i].path);
+    if (signals[i] && signals[i]->entry != entry) signals[i] = nullptr;
+  }
+
+  if (!entry) {
+    std::vector<EntryResult> results(updates.size());
+    for (size_t i = 0; i < updates.size(); i++) {
+      results[i].handle = updates[i].handle;
+      results[i].path   = updates[i].path;
+      results[i].value  = updates[i].value;
+      results[i].error  = "no client for " + serverURI;
+    }
+    return results;
+  }
+  return writeSignals(entry, updates, signals);
+}
+
+std::vector<EntryResult> VAPIClient::writeSignals(ClientEntry                    *entry,
+                                                  const std::vector<EntryUpdate> &updates,
+                                                  const std::vector<Signal*>     &signals) {
+  std::vector<EntryResult> results(updates.size());
+  for (size_t i = 0; i < updates.size(); i++) {
+    results[i].handle = updates[i].handle;
+    results[i].path   = signals[i] ? signals[i]->path : updates[i].path;
+    results[i].value  = updates[i].value;
+  }
+  auto *c = entry->client.get();
+
+  // all or nothing on our side: one unsupported value and none is written
+  bool valid = true;
+  for (size_t i = 0; i < updates.size(); i++) {
+    if (!signals[i]) {
+      results[i].error = "unknown signal";
+      valid = false;
+    } else if (!updates[i].value.isValid() || !isSettable(updates[i].value)) {
+      results[i].error = "unsupported value type";
+      valid = false;
+    }
+  }
+  if (!valid) {
+    for (auto &r : results) {
+      if (r.error.empty()) r.error = "not written, another entry is invalid";
+    }
+    return results;
+  }
+
+  // readers see the whole group switch at once
+  std::vector<WriteUndo> undo(updates.size());
+  {
+    std::lock_guard lock(entry->mtx);
+    for (size_t i = 0; i < updates.size(); i++) {
+      cacheWrite(signals[i], updates[i].value, updates[i].fields, undo[i]);
+    }
+  }
+
+  bool failed = false;
+  for (size_t i = 0; i < updates.size(); i++) {
+    results[i].ok = brokerWrite(c, signals[i]->path, updates[i].value, updates[i].fields, results[i].error);
+    failed = failed || !results[i].ok;
+  }
+
+  if (failed) {
+    std::lock_guard lock(entry->mtx);
+    for (size_t i = 0; i < updates.size(); i++) {
+      if (!results[i].ok) cacheRevert(signals[i], undo[i]);
+    }
+  }
+  return results;
+}
+
+bool VAPIClient::getCached(const std::string &serverURI,
+                           const std::string &path,
+                           CachedValue       &out,
+                           int                field) {
+  SignalHandle h = 0;
+  if (!resolveSignal(serverURI, path, &h)) return false;
+  return getCached(h, out, field);
+}
+
+bool VAPIClient::getCached(SignalHandle handle, CachedValue &out, int field) {
+  Signal *sig = findSignal(handle);
+  if (!sig) return false;
+  std::lock_guard lock(sig->entry->mtx);
+  const auto &f = sig->cache.field(field);
+  if (!f.valid) return false;
+  out.value   = f.value;
+  out.pending = f.pending;
+  out.age     = std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::system_clock::now() - f.value.timestamp());
   return true;
 }
 
-bool VAPIClient::subscribeTarget(const std::string               &serverURI,
-                                 const std::vector<std::string> &paths,
-                                 SubscribeCallback               callback) {
-  auto *c = findClient(serverURI);
-  if (!c) return false;
+bool VAPIClient::getCachedOrFetch(const std::string &serverURI,
+                                  const std::string &path,
+                                  Datapoint         &out,
+                                  int                field) {
+  CachedValue cached;
+  if (getCached(serverURI, path, cached, field)) {
+    out = cached.value;
+    return true;
+  }
+  return get(serverURI, path, out, field);
+}
+
+SubscriptionId VAPIClient::subscribe(const std::string               &serverURI,
+                                     const std::vector<std::string> &paths,
+                                     int                             fields,
+                                     SubscribeCallback               callback) {
+  std::vector<SignalHandle> handles;
+  if (!resolveAll(serverURI, paths, handles)) return 0;
+  return subscribe(serverURI, handles, fields,
+    [this, callback = std::move(callback)](SignalHandle h, const Datapoint &value, int field) {
+      callback(signalPath(h), value, field);
+    });
+}
+
+SubscriptionId VAPIClient::subscribe(const std::vector<SignalHandle> &handles,
+                                     int                              fields,
+                                     SignalCallback                   callback) {
+  Signal *first = handles.empty() ? nullptr : findSignal(handles[0]);
+  if (!first) {
+    std::cerr << "[VAPIClient] Cannot subscribe without a valid signal\n";
+    return 0;
+  }
+  return subscribe(first->serverURI, handles, fields, std::move(callback));
+}
+
+bool VAPIClient::resolveAll(const std::string               &serverURI,
+                            const std::vector<std::string> &paths,
+                            std::vector<SignalHandle>       &handles) {
+  handles.resize(paths.size());
+  for (size_t i = 0; i < paths.size(); i++) {
+    if (!resolveSignal(serverURI, paths[i], &handles[i])) return false;
+  }
+  // an empty list still needs the server to exist
+  return paths.size() || findEntry(serverURI);
+}
+
+SubscriptionId VAPIClient::subscribe(const std::string               &serverURI,
+                                     const std::vector<SignalHandle> &handles,
+                                     int                              fields,
+                                     SignalCallback                   callback) {
+  std::lock_guard lock(mClientsMtx_);
+  auto it = mClients_.find(serverURI);
+  if (it == mClients_.end()) {
+    std::cerr << "[VAPIClient] No client for server " << serverURI << "\n";
+    return 0;
+  }
+  ClientEntry *entry = it->second.get();
+  for (SignalHandle h : handles) {
+    Signal *sig = findSignal(h);
+    if (!sig || sig->entry != entry) {
+      std::cerr << "[VAPIClient] Signal " << h << " is not on " << serverURI << "\n";
+      return 0;
+    }
+  }
+
+  auto sub = std::make_shared<Subscriber>();
+  sub->fields   = fields & SF_BOTH;
+  sub->handles  = std::set<SignalHandle>(handles.begin(), handles.end());
+  sub->callback = std::move(callback);
+
+  SubscriptionId id = mNextSubscriptionId_++;
+  mSubscriptionServers_[id] = serverURI;
+  {
+    std::lock_guard entryLock(entry->mtx);
+    entry->subscribers[id] = sub;
+    updateSubscribers(entry);
+  }
+  if (!entry->dispatcher.joinable()) {
+    entry->dispatcher = std::thread(&VAPIClient::dispatchLoop, this, entry);
+  }
+  entry->cv.notify_one();
+  return id;
+}
+
+VAPIClient::ClientEntry* VAPIClient::findEntry(const std::string &serverURI) {
+  std::lock_guard lock(mClientsMtx_);
+  auto it = mClients_.find(serverURI);
+  return (it == mClients_.end()) ? nullptr : it->second.get();
+}
+
+VAPIClient::ClientEntry* VAPIClient::findEntry(SubscriptionId id, std::string *serverURI) {
+  auto sit = mSubscriptionServers_.find(id);
+  if (sit == mSubscriptionServers_.end()) return nullptr;
+  auto it = mClients_.find(sit->second);
+  if (it == mClients_.end()) return nullptr;
+  if (serverURI) *serverURI = sit->second;
+  return it->second.get();
+}
 
-  // Sequential subscription to prevent race conditions during gRPC setup
+bool VAPIClient::addPaths(SubscriptionId id, const std::vector<std::string> &paths) {
+  std::vector<SignalHandle> handles;
+  std::string serverURI;
   {
     std::lock_guard lock(mClientsMtx_);
-    auto &entry = mClients_.at(serverURI);
-
-    // Create single thread that handles all target value subscriptions sequentially
-    std::thread subThread([c, paths, callback]() {
-      // Larger delay to ensure current subscriptions complete first
-      std::this_thread::sleep_for(std::chrono::milliseconds(500));
-
-      for (const auto &p : paths) {
-        try {
-          c->subscribeWithReconnect(p, callback, KuksaClient::FT_ACTUATOR_TARGET);
-          // Small delay between subscriptions to prevent gRPC resource conflicts
-          std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        } catch (const std::exception& e) {
-          std::cerr << "[VAPIClient] Failed to subscribe to target value for " << p << ": " << e.what() << std::endl;
+    if (!findEntry(id, &serverURI)) return false;
+  }
+  if (!resolveAll(serverURI, paths, handles)) return false;
+
+  std::lock_guard lock(mClientsMtx_);
+  ClientEntry *entry = findEntry(id);
+  if (!entry) return false;
+  {
+    std::lock_guard entryLock(entry->mtx);
+    auto it = entry->subscribers.find(id);
+    if (it == entry->subscribers.end()) return false;
+    // subscribers are immutable once published, change a copy
+    auto sub = std::make_shared<Subscriber>(*it->second);
+    sub->handles.insert(handles.begin(), handles.end());
+    it->second = sub;
+    updateSubscribers(entry);
+  }
+  entry->cv.notify_one();
+  return true;
+}
+
+bool VAPIClient::removePaths(SubscriptionId id, const std::vector<std::string> &paths) {
+  std::string serverURI;
+  {
+    std::lock_guard lock(mClientsMtx_);
+    if (!findEntry(id, &serverURI)) return false;
+  }
+  std::vector<SignalHandle> handles;
+  if (!resolveAll(serverURI, paths, handles)) return false;
+
+  std::lock_guard lock(mClientsMtx_);
+  ClientEntry *entry = findEntry(id);
+  if (!entry) return false;
+  std::lock_guard entryLock(entry->mtx);
+  auto it = entry->subscribers.find(id);
+  if (it == entry->subscribers.end()) return false;
+  auto sub = std::make_shared<Subscriber>(*it->second);
+  for (SignalHandle h : handles) {
+    sub->handles.erase(h);
+  }
+  it->second = sub;
+  updateSubscribers(entry);
+  return true;
+}
+
+void VAPIClient::unsubscribe(SubscriptionId id) {
+  std::lock_guard lock(mClientsMtx_);
+  ClientEntry *entry = findEntry(id);
+  mSubscriptionServers_.erase(id);
+  if (!entry) return;
+  std::lock_guard entryLock(entry->mtx);
+  entry->subscribers.erase(id);
+  updateSubscribers(entry);
+}
+
+void VAPIClient::resubscribe(const std::string &serverURI) {
+  std::lock_guard lock(mClientsMtx_);
+  auto it = mClients_.find(serverURI);
+  if (it == mClients_.end()) return;
+  ClientEntry *entry = it->second.get();
+  {
+    std::lock_guard entryLock(entry->mtx);
+    entry->openStreams.clear();
+    entry->pendingStreams.clear();
+    updateSubscribers(entry);
+  }
+  entry->cv.notify_one();
+}
+
+void VAPIClient::updateSubscribers(ClientEntry *entry) {
+  auto byPath = std::make_shared<SubscriberMap>();
+  for (const auto &kv : entry->subscribers) {
+    const auto &sub = kv.second;
+    for (SignalHandle h : sub->handles) {
+      Signal *sig = findSignal(h);
+      auto &node = (*byPath)[sig->path];
+      if (!node) {
+        node = std::make_shared<PathSubscribers>();
+        node->handle = h;
+        node->signal = sig;
+      }
+      node->subscribers.push_back(sub);
+      node->fields |= sub->fields;
+      for (int field : { (int)SF_CURRENT, (int)SF_TARGET }) {
+        auto stream = std::make_pair(sig->path, field);
+        if ((sub->fields & field) && entry->openStreams.insert(stream).second) {
+          entry->pendingStreams.push_back(stream);
         }
       }
-    });
-    entry.subThreads.emplace_back(std::move(subThread));
+    }
   }
-  return true;
+
+  // signals nobody subscribes any more lose their cached values
+  for (const auto &kv : *entry->byPath) {
+    kv.second->signal->subscribedFields = 0;
+  }
+  for (const auto &kv : *byPath) {
+    kv.second->signal->subscribedFields = kv.second->fields;
+  }
+  for (const auto &kv : *entry->byPath) {
+    if (!kv.second->signal->subscribedFields) kv.second->signal->cache = PathCache();
+  }
+  entry->byPath = byPath;
+}
+
+void VAPIClient::dispatchLoop(ClientEntry *entry) {
+  // KuksaClient threads only queue their updates here; this thread opens
+  // the broker streams and runs every subscriber callback. Nothing on the
+  // way allocates for a scalar value: the update refers to the subscriber
+  // table, callbacks get the signal handle and the queue keeps its
+  // capacity. The path lookup below is the only hashing left, the
+  // library reports updates by path.
+  auto onUpdate = [entry](const std::string &path,
+                          const std::string &value,
+                          const int         &field) {
+    Datapoint dp;
+    Datapoint::parse(value, dp);
+    dp.setTimestamp(std::chrono::system_clock::now());
+    {
+      std::lock_guard lock(entry->mtx);
+      if (entry->stop) return;
+      auto it = entry->byPath->find(path);
+      if (it == entry->byPath->end()) return;  // nobody left on this path
+
+      Signal *sig = it->second->signal;
+      sig->valueType.store(dp.value().index(), std::memory_order_relaxed);
+      auto &f = sig->cache.field(field);
+      if (f.pending) {
+        if (dp == f.written) {
+          f.pending = false;  // our write came back
+        } else if (dp.timestamp() - f.written.timestamp() < kWriteEchoTimeout) {
+          return;             // sent before our write, do not flip the UI back
+        } else {
+          f.pending = false;  // the broker did not take it, its value wins
+        }
+      }
+      f.value = dp;
+      f.valid = true;
+      entry->updates.push_back(Update{it->second, std::move(dp), field});
+    }
+    entry->cv.notify_one();
+  };
+
+  std::vector<Update> updates;
+  std::deque<std::pair<std::string, int>> streams;
+  for (;;) {
+    {
+      std::unique_lock lock(entry->mtx);
+      entry->cv.wait(lock, [entry]() {
+        return entry->stop || !entry->updates.empty() || !entry->pendingStreams.empty();
+      });
+      if (entry->stop) return;
+      updates.swap(entry->updates);
+      streams.swap(entry->pendingStreams);
+    }
+
+    for (const auto &s : streams) {
+      try {
+        entry->client->subscribeWithReconnect(s.first, onUpdate, s.second);
+      } catch (const std::exception &e) {
+        std::cerr << "[VAPIClient] Failed to subscribe to " << s.first
+                  << " (field " << s.second << "): " << e.what() << std::endl;
+        std::lock_guard lock(entry->mtx);
+        entry->openStreams.erase(s);
+      }
+    }
+    streams.clear();
+
+    // a subscriber removed after the update was queued may still see it
+    for (const auto &u : updates) {
+      for (const auto &sub : u.subscribers->subscribers) {
+        if (sub->fields & u.field) {
+          sub->callback(u.subscribers->handle, u.value, u.field);
+        }
+      }
+    }
+    updates.clear();
+  }
+}
+
+bool VAPIClient::subscribeCurrent(const std::string               &serverURI,
+                                  const std::vector<std::string> &paths,
+                                  SubscribeCallback               callback) {
+  return subscribe(serverURI, paths, SF_CURRENT, std::move(callback)) != 0;
+}
+
+bool VAPIClient::subscribeTarget(const std::string               &serverURI,
+                                 const std::vector<std::string> &paths,
+                                 SubscribeCallback               callback) {
+  return subscribe(serverURI, paths, SF_TARGET, std::move(callback)) != 0;
 }
 
 bool VAPIClient::isConnected(const std::string &serverURI) const {
@@ -189,96 +735,121 @@ bool VAPIClient::forceReconnect(const std::string &serverURI) {
   return false;
 }
 
-void VAPIClient::shutdown() {
-  std::cout << "[VAPIClient] Shutting down all clients and threads..." << std::endl;
-
-  std::lock_guard lock(mClientsMtx_);
-
+void VAPIClient::stopAll() {
   for (auto &kv : mClients_) {
-    auto &entry = kv.second;
+    auto &entry = *kv.second;
+    // Stop the dispatcher; updates still queued are dropped
+    {
+      std::lock_guard entryLock(entry.mtx);
+      entry.stop = true;
+    }
+    entry.cv.notify_all();
 
-    // Signal KuksaClient to stop first
+    // a reconnect attempt would only reopen what is being torn down
     if (entry.client) {
-      std::cout << "[VAPIClient] Shutting down client for " << kv.first << std::endl;
+      try {
+        entry.client->setAutoReconnect(false);
+      } catch (const std::exception &e) {
+        std::cerr << "[VAPIClient] Exception while stopping " << kv.first << ": " << e.what() << std::endl;
+      }
     }
+  }
+}
 
-    // Join subscription threads with timeout
-    std::cout << "[VAPIClient] Joining " << entry.subThreads.size()
-              << " subscription threads..." << std::endl;
+void VAPIClient::shutdown() {
+  std::cout << "[VAPIClient] Shutting down all clients and threads..." << std::endl;
+  const auto deadline = std::chrono::steady_clock::now() + kShutdownDeadline;
 
-    size_t joinedCount = 0;
-    size_t detachedCount = 0;
+  std::lock_guard lock(mClientsMtx_);
 
-    for (auto &t : entry.subThreads) {
+  // Everything is told to stop before anything is waited for, so the
+  // connections wind down together instead of one after the other.
+  stopAll();
+
+  // Each connection is torn down on its own thread: join the dispatcher,
+  // then destroy the client, which closes its streams. The barrier is
+  // shared with the threads, a late one may still report to it.
+  struct Barrier {
+    std::mutex              mtx;
+    std::condition_variable cv;
+    std::vector<bool>       done;
+  };
+  auto barrier = std::make_shared<Barrier>();
+  barrier->done.assign(mClients_.size(), false);
+
+  std::vector<std::thread> teardown;
+  teardown.reserve(mClients_.size());
+  for (auto &kv : mClients_) {
+    const size_t index = teardown.size();
+    ClientEntry *entry = kv.second.get();
+    teardown.emplace_back([entry, barrier, index]() {
       try {
-        if (t.joinable()) {
-          // Try to join with timeout using async approach
-          auto future = std::async(std::launch::async, [&t]() {
-            t.join();
-          });
-
-          if (future.wait_for(std::chrono::seconds(3)) == std::future_status::ready) {
-            joinedCount++;
-          } else {
-            std::cerr << "[VAPIClient] Thread join timeout, detaching thread" << std::endl;
-            t.detach();
-            detachedCount++;
-          }
-        }
-      } catch (const std::exception& e) {
-        std::cerr << "[VAPIClient] Exception while joining thread: " << e.what() << std::endl;
-        try {
-          if (t.joinable()) {
-            t.detach();
-            detachedCount++;
-          }
-        } catch (...) {
-          std::cerr << "[VAPIClient] Failed to detach thread after join exception" << std::endl;
-        }
+        if (entry->dispatcher.joinable()) entry->dispatcher.join();
+        entry->client.reset();
+      } catch (const std::exception &e) {
+        std::cerr << "[VAPIClient] Exception while closing a client: " << e.what() << std::endl;
       }
-    }
+      {
+        std::lock_guard barrierLock(barrier->mtx);
+        barrier->done[index] = true;
+      }
+      barrier->cv.notify_all();
+    });
+  }
 
-    std::cout << "[VAPIClient] Thread cleanup completed for " << kv.first
-              << " - joined: " << joinedCount << ", detached: " << detachedCount << std::endl;
+  // One deadline for all of them
+  {
+    std::unique_lock barrierLock(barrier->mtx);
+    barrier->cv.wait_until(barrierLock, deadline, [&barrier]() {
+      return std::find(barrier->done.begin(), barrier->done.end(), false) == barrier->done.end();
+    });
+  }
 
-    entry.subThreads.clear();
-    // unique_ptr<KuksaClient> will be destroyed here
+  std::vector<ClientEntry*> leaked;
+  size_t index = 0;
+  for (auto &kv : mClients_) {
+    bool done;
+    {
+      std::lock_guard barrierLock(barrier->mtx);
+      done = barrier->done[index];
+    }
+    if (done) {
+      teardown[index].join();
+    } else {
+      // Stuck in a broker call. Its thread still uses the entry, so the
+      // entry is left behind rather than destroyed under it.
+      std::cerr << "[VAPIClient] " << kv.first << " did not stop within "
+                << kShutdownDeadline.count() << " ms, leaving it behind" << std::endl;
+      teardown[index].detach();
+      leaked.push_back(kv.second.release());
+    }
+    index++;
   }
 
   mClients_.clear();
+  mSubscriptionServers_.clear();
+  {
+    std::lock_guard signalsLock(mSignalsMtx_);
+    for (auto &s : mSignals_) s.store(nullptr, std::memory_order_relaxed);
+    mSignalIds_.clear();
+    // a left-behind entry still dispatches into its signals (byPath holds
+    // them), so they are left behind with it
+    for (auto &sig : mSignalStore_) {
+      if (std::find(leaked.begin(), leaked.end(), sig->entry) != leaked.end()) sig.release();
+    }
+    mSignalStore_.clear();
+  }
   std::cout << "[VAPIClient] Shutdown completed" << std::endl;
 }
 
 void VAPIClient::shutdownAsync() {
   std::cout << "[VAPIClient] Starting async shutdown..." << std::endl;
 
-  // Signal all clients to stop without blocking
+  // Signal everything to stop without waiting for it; the threads are
+  // joined by shutdown(), at the latest when the client is destroyed.
   {
     std::lock_guard lock(mClientsMtx_);
-    for (auto &kv : mClients_) {
-      auto &entry = kv.second;
-
-      // Just signal shutdown to KuksaClient instances
-      // They will handle their own thread cleanup in their destructors
-      if (entry.client) {
-        std::cout << "[VAPIClient] Signaling async shutdown for " << kv.first << std::endl;
-      }
-
-      // Detach all subscription threads immediately - don't wait
-      std::cout << "[VAPIClient] Detaching " << entry.subThreads.size()
-                << " subscription threads for " << kv.first << std::endl;
-
-      for (auto &t : entry.subThreads) {
-        try {
-          if (t.joinable()) {
-            t.detach();
-          }
-        } catch (const std::exception& e) {
-          std::cerr << "[VAPIClient] Exception while detaching thread: " << e.what() << std::endl;
-        }
-      }
-      entry.subThreads.clear();
-    }
+    stopAll();
   }
 
   std::cout << "[VAPIClient] Async shutdown completed" << std::endl;
@@ -9,6 +9,8 @@
 #define VAPI_CLIENT_HPP
 
 #include "KuksaClient.hpp"
+#include "datapoint.hpp"
+#include "vsssignal.hpp"
 #include <memory>
 #include <string>
 #include <vector>
@@ -16,7 +18,13 @@
 #include <unordered_map>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <set>
 #include <optional>
+#include <chrono>
+#include <array>
+#include <atomic>
 #include <iostream>
 
 // Define VAPI server names for consistency across your project.
@@ -26,13 +34,69 @@
 #define VAPI_SERVER_LIST { DK_VAPI_DATABROKER }
 
 //----------------------------------------------------------------------
-// callback signature used by KuksaClient::subscribe*()
+// callback signature used by VAPIClient::subscribe*(); the value is
+// typed and stamped with the time of the update
 //----------------------------------------------------------------------  
 using SubscribeCallback = 
   std::function<void(const std::string &entryPath,
-                     const std::string &value,
+                     const Datapoint   &value,
                      const int &field)>;
 
+//----------------------------------------------------------------------
+// field mask for subscribe(); the bits are the KuksaClient field types,
+// so the 'field' of a callback can be tested against it directly
+//----------------------------------------------------------------------
+enum SubscribeField {
+  SF_CURRENT = KuksaClient::FT_VALUE,
+  SF_TARGET  = KuksaClient::FT_ACTUATOR_TARGET,
+  SF_BOTH    = SF_CURRENT | SF_TARGET
+};
+
+using SubscriptionId = uint64_t;
+
+//----------------------------------------------------------------------
+// SignalHandle: a (server, path) resolved once by VAPIClient::resolve().
+// Calls taking a handle find the connection and the cache through it,
+// without locking the client table or hashing strings. 0 is no signal;
+// handles stay valid until shutdown().
+//----------------------------------------------------------------------
+using SignalHandle = uint32_t;
+
+using SignalCallback =
+  std::function<void(SignalHandle      handle,
+                     const Datapoint   &value,
+                     int                field)>;
+
+//----------------------------------------------------------------------
+// one entry of setMany(), and the per-entry result of getMany()/setMany()
+//----------------------------------------------------------------------
+struct EntryUpdate {
+  std::string  path;
+  Datapoint    value;
+  int          fields = SF_CURRENT;
+  // used instead of 'path' when set
+  SignalHandle handle = 0;
+};
+
+struct EntryResult {
+  SignalHandle handle = 0;
+  std::string path;
+  Datapoint   value;
+  bool        ok = false;
+  std::string error;
+};
+
+//----------------------------------------------------------------------
+// a value served from the subscription cache
+//----------------------------------------------------------------------
+struct CachedValue {
+  Datapoint                 value;
+  // time since the value arrived (or was written)
+  std::chrono::milliseconds age{0};
+  // written here and not confirmed by the broker yet
+  bool                      pending = false;
+};
+
 //----------------------------------------------------------------------
 // VAPIClient: singleton  
 //----------------------------------------------------------------------  
@@ -46,6 +110,25 @@ public:
   bool connectToServer(const std::string &serverURI,
     const std::vector<std::string> &signalPaths = {});
 
+  // Intern (serverURI, path); the same pair always gives the same
+  // handle. Returns 0 if there is no client for the server.
+  SignalHandle resolve(const std::string &serverURI, const std::string &path);
+
+  // Metadata of a handle, no locking. Empty for an unknown handle.
+  const std::string &signalPath(SignalHandle handle) const;
+  const std::string &signalServer(SignalHandle handle) const;
+  // Datapoint::Value index of the last value seen, 0 before the first
+  size_t signalType(SignalHandle handle) const;
+
+  // Handle versions of get(), set(), getCached() and subscribe()
+  bool get(SignalHandle handle, Datapoint &out, int field = SF_CURRENT);
+  bool set(SignalHandle handle, const Datapoint &value, int fields = SF_CURRENT);
+  bool getCached(SignalHandle handle, CachedValue &out, int field = SF_CURRENT);
+  // all handles must belong to one server
+  SubscriptionId subscribe(const std::vector<SignalHandle> &handles,
+                           int                              fields,
+                           SignalCallback                   callback);
+
   // Get/Set current or target values.
   // getCurrent/TargetValue return true if non-empty string was retrieved.
   bool getCurrentValue(const std::string &serverURI,
@@ -56,21 +139,68 @@ public:
                       const std::string &path,
                       std::string       &outValue);
 
-  // Templated conversions
+  // Typed get of one field (SF_CURRENT or SF_TARGET).
+  // Returns false if there is no client or no value.
+  bool get(const std::string &serverURI,
+           const std::string &path,
+           Datapoint         &out,
+           int                field = SF_CURRENT);
+
+  // Typed set of the fields in 'fields'. Arrays are not supported by
+  // KuksaClient's setters and return false.
+  // A subscribed path shows the written value in getCached() right
+  // away; it is confirmed when the subscription echoes it and dropped
+  // again if the set fails.
+
+  bool set(const std::string &serverURI,
+           const std::string &path,
+           const Datapoint   &value,
+           int                fields = SF_CURRENT);
+
+  // Get a group of paths. Cached values are taken together under one
+  // lock (unless useCache is false), the rest is read from the broker.
+  // The results are in the order of 'paths'.
+  std::vector<EntryResult> getMany(const std::string              &serverURI,
+                                   const std::vector<std::string> &paths,
+                                   int                             field    = SF_CURRENT,
+                                   bool                            useCache = true);
+
+  // Set a group of entries, each with its own fields (SF_BOTH writes
+  // current and target). Nothing is written if any value can not be
+  // set; the cache switches to the whole group at once and an entry the
+  // broker refuses is reverted. The results are in the order of 'updates'.
+  std::vector<EntryResult> setMany(const std::string              &serverURI,
+                                   const std::vector<EntryUpdate> &updates);
+
+  // Value of a subscribed path from the subscription cache, no broker
+  // call. Returns false if the path is not subscribed for that field or
+  // nothing has arrived yet.
+  bool getCached(const std::string &serverURI,
+                 const std::string &path,
+                 CachedValue       &out,
+                 int                field = SF_CURRENT);
+
+  // getCached(), else get() from the broker
+  bool getCachedOrFetch(const std::string &serverURI,
+                        const std::string &path,
+                        Datapoint         &out,
+                        int                field = SF_CURRENT);
+
+  // Templated conversions (see Datapoint::get for the rules)
   template<typename T>
   bool getCurrentValueAs(const std::string &serverURI,
                          const std::string &path,
                          T                  &out) {
-    auto *c = findClient(serverURI);
-    return c ? c->getCurrentValueAs<T>(path, out) : false;
+    Datapoint dp;
+    return get(serverURI, path, dp, SF_CURRENT) && dp.get(out);
   }
 
   template<typename T>
   bool getTargetValueAs(const std::string &serverURI,
                         const std::string &path,
                         T                  &out) {
-    auto *c = findClient(serverURI);
-    return c ? c->getTargetValueAs<T>(path, out) : false;
+    Datapoint dp;
+    return get(serverURI, path, dp, SF_TARGET) && dp.get(out);
   }
 
   template<typename T>
@@ -93,21 +223,69 @@ public:
     return true;
   }
 
-  // Subscribe to *current* value updates for a list of paths.
-  // Each subscription runs in its own thread.
+  // Typed access through the generated VSS constants (vss_signals.hpp):
+  // 'out' must be the signal's type, and set() does not compile for a
+  // value that does not fit its datatype.
+  template<typename T>
+  bool getAs(const std::string &serverURI,
+             const VssSignal<T> &signal,
+             T                  &out,
+             int                 field = SF_CURRENT) {
+    Datapoint dp;
+    return get(serverURI, signal.path, dp, field) && dp.get(out);
+  }
+
+  template<typename T, typename V>
+  bool set(const std::string  &serverURI,
+           const VssSignal<T> &signal,
+           const V            &value,
+           int                 fields = SF_CURRENT) {
+    return set(serverURI, signal.path, vssValue(signal, value), fields);
+  }
+
+  template<typename T>
+  SignalHandle resolve(const std::string &serverURI, const VssSignal<T> &signal) {
+    return resolve(serverURI, std::string(signal.path));
+  }
+
+  // Subscribe to updates of 'paths' for the fields in 'fields' (SF_*).
+  // All subscriptions of a connection share one dispatcher thread: a
+  // (path, field) is opened on the broker once, however many subscribers
+  // it has, and every update is delivered from that thread.
+  // Returns 0 if there is no client for the server.
+  SubscriptionId subscribe(const std::string               &serverURI,
+                           const std::vector<std::string> &paths,
+                           int                             fields,
+                           SubscribeCallback               callback);
+
+  // Change the paths of a subscription while it is active.
+  bool addPaths(SubscriptionId id, const std::vector<std::string> &paths);
+  bool removePaths(SubscriptionId id, const std::vector<std::string> &paths);
+
+  // Stop delivering updates to a subscription.
+  void unsubscribe(SubscriptionId id);
+
+  // Open the broker side of every subscribed (path, field) again, e.g.
+  // after a reconnect. Subscribers are kept.
+  void resubscribe(const std::string &serverURI);
+
+  // Subscribe to *current* / *target* value updates for a list of paths.
   bool subscribeCurrent(const std::string               &serverURI,
                         const std::vector<std::string> &paths,
                         SubscribeCallback               callback);
 
-  // Subscribe to *target* value updates
   bool subscribeTarget(const std::string               &serverURI,
                        const std::vector<std::string> &paths,
                        SubscribeCallback               callback);
 
-  // Blocks/destroys all subscription threads and clients.
+  // Stops all subscription threads and destroys the clients. Waits at
+  // most 200 ms in total; a connection stuck in a broker call past that
+  // is left running and never destroyed, together with its signals.
+  // Their handles are no longer valid either way.
   void shutdown();
 
-  // Non-blocking shutdown suitable for Qt application termination
+  // Non-blocking shutdown suitable for Qt application termination: stops
+  // everything, the threads are joined by shutdown()
   void shutdownAsync();
 
   // Connection status and control
@@ -124,16 +302,126 @@ private:
 
   // internal helper
   KuksaClient::KuksaClient* findClient(const std::string &serverURI);
+  // sets stop on every entry and disables reconnecting; mClientsMtx_ held
+  void stopAll();
   KuksaClient::KuksaClient* findClient(const std::string &serverURI) const;
 
+  struct ClientEntry;
+  struct Signal;
+
+  struct Subscriber {
+    int                    fields;
+    std::set<SignalHandle> handles;
+    SignalCallback         callback;
+  };
+  // the subscribers of one path; updates keep a reference to it, so the
+  // path is not copied for each of them
+  struct PathSubscribers {
+    SignalHandle                                   handle = 0;
+    Signal                                        *signal = nullptr;
+    // SF_* subscribed by any of them
+    int                                            fields = 0;
+    std::vector<std::shared_ptr<const Subscriber>> subscribers;
+  };
+  using SubscriberMap =
+    std::unordered_map<std::string, std::shared_ptr<PathSubscribers>>;
+
+  struct Update {
+    std::shared_ptr<const PathSubscribers> subscribers;
+    Datapoint                              value;
+    int                                    field;
+  };
+
+  // the cache of one field of a path
+  struct CachedField {
+    Datapoint value;
+    // the write waiting for its echo
+    Datapoint written;
+    bool      valid   = false;
+    bool      pending = false;
+  };
+  struct PathCache {
+    CachedField current;
+    CachedField target;
+    CachedField &field(int f) { return (f == SF_TARGET) ? target : current; }
+  };
+
   // one entry per connected server
   struct ClientEntry {
+    std::mutex                             mtx;
+    std::condition_variable                cv;
+    bool                                   stop = false;
+    // swapped with the dispatcher's own vector, so both keep their capacity
+    std::vector<Update>                    updates;
+    // (path, field) waiting to be opened on the broker / already opened
+    std::deque<std::pair<std::string, int>> pendingStreams;
+    std::set<std::pair<std::string, int>>   openStreams;
+    std::unordered_map<SubscriptionId, std::shared_ptr<const Subscriber>> subscribers;
+    // path -> subscribers, rebuilt on every change; queued updates keep the old nodes alive
+    std::shared_ptr<const SubscriberMap>   byPath = std::make_shared<SubscriberMap>();
+    std::thread                            dispatcher;
+    // declared last: destroyed first, so its threads are gone before the queue
     std::unique_ptr<KuksaClient::KuksaClient> client;
-    std::vector<std::thread>                  subThreads;
   };
 
-  std::unordered_map<std::string, ClientEntry> mClients_;
+  // an interned (server, path); never changes after resolve() except
+  // for the guarded members
+  struct Signal {
+    std::string         serverURI;
+    std::string         path;
+    ClientEntry        *entry = nullptr;
+    std::atomic<size_t> valueType{0};
+    // guarded by entry->mtx: SF_* subscribed, and the last values
+    // fed by the subscriptions
+    int                 subscribedFields = 0;
+    PathCache           cache;
+  };
+  static constexpr size_t kMaxSignals = 4096;
+
+  Signal* findSignal(SignalHandle handle) const {
+    return (handle > 0 && handle < kMaxSignals)
+      ? mSignals_[handle].load(std::memory_order_acquire) : nullptr;
+  }
+  Signal* resolveSignal(const std::string &serverURI, const std::string &path, SignalHandle *handle = nullptr);
+  std::vector<EntryResult> writeSignals(ClientEntry *entry,
+                                        const std::vector<EntryUpdate> &updates,
+                                        const std::vector<Signal*> &signals);
+
+  // what a cached write replaced, restored if the broker refuses it
+  struct WriteUndo {
+    CachedField before[2];
+    bool        touched[2] = { false, false };
+  };
+  // entry->mtx held
+  static void cacheWrite(Signal *sig, const Datapoint &value, int fields, WriteUndo &undo);
+  static void cacheRevert(Signal *sig, const WriteUndo &undo);
+  static bool isSettable(const Datapoint &value);
+  static bool brokerWrite(KuksaClient::KuksaClient *c, const std::string &path,
+                          const Datapoint &value, int fields, std::string &error);
+
+  void dispatchLoop(ClientEntry *entry);
+  // rebuild byPath and queue the streams not opened yet; entry->mtx held
+  void updateSubscribers(ClientEntry *entry);
+  ClientEntry* findEntry(SubscriptionId id, std::string *serverURI = nullptr);
+  ClientEntry* findEntry(const std::string &serverURI);
+  bool resolveAll(const std::string               &serverURI,
+                  const std::vector<std::string> &paths,
+                  std::vector<SignalHandle>       &handles);
+  SubscriptionId subscribe(const std::string               &serverURI,
+                           const std::vector<SignalHandle> &handles,
+                           int                              fields,
+                           SignalCallback                   callback);
+
+  std::unordered_map<std::string, std::unique_ptr<ClientEntry>> mClients_;
+  std::unordered_map<SubscriptionId, std::string>               mSubscriptionServers_;
+  SubscriptionId                                                mNextSubscriptionId_ = 1;
   std::mutex                                  mClientsMtx_;
+
+  // handle -> signal, written once under mSignalsMtx_ and read without it
+  std::array<std::atomic<Signal*>, kMaxSignals>         mSignals_{};
+  std::vector<std::unique_ptr<Signal>>                  mSignalStore_;
+  std::unordered_map<std::string, SignalHandle>         mSignalIds_;
+  std::mutex                                            mSignalsMtx_;
 };
 
 // convenience macro
@@ -0,0 +1,76 @@
+// Copyright (c) 2025 Eclipse Foundation.
+//
+// This program and the accompanying materials are made available under the
+// terms of the MIT License which is available at
+// https://opensource.org/licenses/MIT.
+//
+// SPDX-License-Identifier: MIT
+#ifndef VSSSIGNAL_HPP
+#define VSSSIGNAL_HPP
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "datapoint.hpp"
+
+//----------------------------------------------------------------------
+// VssSignal<T>: one VSS leaf known at compile time. The constants are
+// generated from the vss.json picked at build time (vss_signals.hpp,
+// see DK_VSS_JSON in CMakeLists.txt); T is the C++ type of the VSS
+// datatype, so typed reads and writes are checked by the compiler.
+//----------------------------------------------------------------------
+enum class VssEntryType { Sensor, Actuator, Attribute };
+
+// FNV-1a of the path, usable in constant expressions and case labels
+constexpr uint32_t vssId(const char *path) {
+  uint32_t h = 2166136261u;
+  for (; *path; ++path) {
+    h = (h ^ static_cast<uint8_t>(*path)) * 16777619u;
+  }
+  return h;
+}
+
+template<typename T>
+struct VssSignal {
+  using value_type = T;
+
+  const char   *path;
+  uint32_t      id;
+  VssEntryType  type;
+  const char   *datatype;  // as in the vss.json, e.g. "uint8"
+};
+
+namespace vss_detail {
+
+// V converts to T without losing range or precision
+template<typename V, typename T>
+constexpr bool fits() {
+  if constexpr (std::is_same_v<V, T>) {
+    return true;
+  } else if constexpr (std::is_same_v<V, bool> || std::is_same_v<T, bool>) {
+    return false;
+  } else if constexpr (std::is_integral_v<V> && std::is_integral_v<T>) {
+    return (std::is_signed_v<V> == std::is_signed_v<T> && sizeof(V) <= sizeof(T)) ||
+           (std::is_unsigned_v<V> && std::is_signed_v<T> && sizeof(V) < sizeof(T));
+  } else if constexpr (std::is_floating_point_v<T>) {
+    return std::is_floating_point_v<V> ? sizeof(V) <= sizeof(T)
+                                       : std::is_integral_v<V> && sizeof(V) < sizeof(T);
+  } else {
+    return std::is_convertible_v<V, T> && !std::is_arithmetic_v<V>;
+  }
+}
+
+} // namespace vss_detail
+
+// A Datapoint of the signal's own type. Does not compile for a value
+// that does not fit the VSS datatype (a string for a boolean, an int
+// for a uint8, ...).
+template<typename T, typename V>
+Datapoint vssValue(const VssSignal<T> &, const V &value) {
+  static_assert(vss_detail::fits<V, T>(), "value does not fit the VSS datatype of the signal");
+  return Datapoint(T(value));
+}
+
+#endif // VSSSIGNAL_HPP
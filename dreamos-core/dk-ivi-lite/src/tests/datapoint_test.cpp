@@ -0,0 +1,59 @@
+// Copyright (c) 2025 Eclipse Foundation.
+//
+// This program and the accompanying materials are made available under the
+// terms of the MIT License which is available at
+// https://opensource.org/licenses/MIT.
+//
+// SPDX-License-Identifier: MIT
+
+//------------------------------------------------------------------------------
+// Datapoint comparison as used by the write echo check of VAPIClient:
+// a value written with one width comes back from the broker in its text
+// form, parsed with another.
+//------------------------------------------------------------------------------
+#include "../platform/integrations/vehicle-api/datapoint.hpp"
+#include <cstdio>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                    \
+  do {                                                                 \
+    if (!(cond)) {                                                     \
+      std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      failures++;                                                      \
+    }                                                                  \
+  } while (0)
+
+// what onUpdate compares a pending write against
+static Datapoint echo(const Datapoint &written) {
+  Datapoint dp;
+  Datapoint::parse(written.toString(), dp);
+  return dp;
+}
+
+int main() {
+  // the echo is parsed as uint64 / int64 / double
+  CHECK(echo(Datapoint(uint8_t(3))) == Datapoint(uint8_t(3)));
+  CHECK(Datapoint(uint8_t(3)) == echo(Datapoint(uint8_t(3))));
+  CHECK(echo(Datapoint(uint16_t(40000))) == Datapoint(uint16_t(40000)));
+  CHECK(echo(Datapoint(int8_t(-5))) == Datapoint(int8_t(-5)));
+  CHECK(echo(Datapoint(int32_t(7))) == Datapoint(int32_t(7)));
+  CHECK(echo(Datapoint(float(0.1f))) == Datapoint(float(0.1f)));
+  CHECK(echo(Datapoint(double(-2.5))) == Datapoint(double(-2.5)));
+  CHECK(echo(Datapoint(true)) == Datapoint(true));
+  CHECK(echo(Datapoint("on")) == Datapoint("on"));
+
+  // another value still differs, whatever the width
+  CHECK(Datapoint(uint8_t(3)) != Datapoint(uint64_t(4)));
+  CHECK(Datapoint(int8_t(-1)) != Datapoint(uint64_t(UINT64_MAX)));
+  CHECK(Datapoint(uint64_t(UINT64_MAX)) != Datapoint(int64_t(-1)));
+  CHECK(Datapoint(uint8_t(1)) != Datapoint(true));
+  CHECK(Datapoint(uint8_t(1)) != Datapoint("1"));
+
+  if (failures) {
+    std::printf("%d check(s) failed\n", failures);
+    return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,155 @@
+# Copyright (c) 2025 Eclipse Foundation.
+#
+# This program and the accompanying materials are made available under the
+# terms of the MIT License which is available at
+# https://opensource.org/licenses/MIT.
+#
+# SPDX-License-Identifier: MIT
+
+"""
+Generates the typed VSS constants of dk_ivi from a vss.json.
+
+Every leaf becomes a VssSignal<T> (vsssignal.hpp) in nested namespaces that
+follow the path, e.g. vss::Vehicle::Body::Lights::Beam::Low::IsOn. Called by
+CMake at build time:
+
+    python3 vss_bindings.py <vss.json> <output header>
+"""
+
+import json
+import keyword
+import re
+import sys
+
+# VSS datatype -> C++ type; arrays use the element types Datapoint holds
+CPP_TYPES = {
+    'boolean': 'bool',
+    'int8': 'int8_t',
+    'int16': 'int16_t',
+    'int32': 'int32_t',
+    'int64': 'int64_t',
+    'uint8': 'uint8_t',
+    'uint16': 'uint16_t',
+    'uint32': 'uint32_t',
+    'uint64': 'uint64_t',
+    'float': 'float',
+    'double': 'double',
+    'string': 'std::string',
+    'boolean[]': 'std::vector<bool>',
+    'int8[]': 'std::vector<int64_t>',
+    'int16[]': 'std::vector<int64_t>',
+    'int32[]': 'std::vector<int64_t>',
+    'int64[]': 'std::vector<int64_t>',
+    'uint8[]': 'std::vector<uint64_t>',
+    'uint16[]': 'std::vector<uint64_t>',
+    'uint32[]': 'std::vector<uint64_t>',
+    'uint64[]': 'std::vector<uint64_t>',
+    'float[]': 'std::vector<double>',
+    'double[]': 'std::vector<double>',
+    'string[]': 'std::vector<std::string>',
+}
+
+ENTRY_TYPES = {
+    'sensor': 'VssEntryType::Sensor',
+    'actuator': 'VssEntryType::Actuator',
+    'attribute': 'VssEntryType::Attribute',
+}
+
+CPP_KEYWORDS = {'auto', 'bool', 'char', 'class', 'const', 'default', 'delete', 'double',
+                'enum', 'float', 'int', 'long', 'namespace', 'new', 'operator', 'private',
+                'public', 'register', 'short', 'signed', 'struct', 'template', 'this',
+                'union', 'unsigned', 'void', 'volatile'}
+
+
+# same hash as vssId() in vsssignal.hpp; only used to report collisions here,
+# the ids in the header are computed by the compiler from vssId()
+def fnv1a(path):
+    h = 2166136261
+    for b in path.encode('utf-8'):
+        h = ((h ^ b) * 16777619) & 0xffffffff
+    return h
+
+
+def identifier(name):
+    ident = re.sub(r'[^A-Za-z0-9_]', '_', name)
+    if ident[0].isdigit() or ident in CPP_KEYWORDS or keyword.iskeyword(ident):
+        ident = '_' + ident
+    return ident
+
+
+def emit(node, name, path, depth, out, ids, skipped):
+    indent = '  ' * depth
+    if 'children' in node:
+        out.append('%snamespace %s {' % (indent, identifier(name)))
+        for child, sub in node['children'].items():
+            emit(sub, child, path + '.' + child, depth + 1, out, ids, skipped)
+        out.append('%s}' % indent)
+        return
+
+    cpp_type = CPP_TYPES.get(node.get('datatype'))
+    entry_type = ENTRY_TYPES.get(node.get('type'))
+    if not cpp_type or not entry_type:
+        skipped.append(path)
+        return
+
+    signal_id = fnv1a(path)
+    if signal_id in ids:
+        sys.exit('vss_bindings: id collision between %s and %s' % (ids[signal_id], path))
+    ids[signal_id] = path
+    out.append('%sinline constexpr VssSignal<%s> %s{"%s", vssId("%s"), %s, "%s"};'
+               % (indent, cpp_type, identifier(name), path, path, entry_type, node['datatype']))
+
+
+def version(tree):
+    try:
+        v = tree['Vehicle']['children']['VersionVSS']['children']
+        return int(v['Major'].get('default', 0)), int(v['Minor'].get('default', 0))
+    except (KeyError, ValueError):
+        return 0, 0
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit('usage: vss_bindings.py <vss.json> <output header>')
+    source, target = sys.argv[1], sys.argv[2]
+
+    with open(source) as f:
+        tree = json.load(f)
+
+    major, minor = version(tree)
+    out = [
+        '// Generated by tools/vss_bindings.py from %s, do not edit.' % source.replace('\\', '/'),
+        '#ifndef VSS_SIGNALS_HPP',
+        '#define VSS_SIGNALS_HPP',
+        '',
+        '#include "vsssignal.hpp"',
+        '',
+        '// 0.0 if the vss.json has no Vehicle.VersionVSS',
+        '#define DK_VSS_VERSION_MAJOR %d' % major,
+        '#define DK_VSS_VERSION_MINOR %d' % minor,
+        '',
+        'namespace vss {',
+    ]
+    ids = {}
+    skipped = []
+    for name, node in tree.items():
+        emit(node, name, name, 0, out, ids, skipped)
+    out += ['} // namespace vss', '', '#endif // VSS_SIGNALS_HPP', '']
+
+    for path in skipped:
+        print('vss_bindings: skipping %s, unknown type or datatype' % path)
+
+    text = '\n'.join(out)
+    # leave the header alone when nothing changed, so nothing rebuilds
+    try:
+        with open(target) as f:
+            if f.read() == text:
+                return
+    except OSError:
+        pass
+    with open(target, 'w') as f:
+        f.write(text)
+
+
+if __name__ == '__main__':
+    main()
@@ -1,6 +1,8 @@
 #include "dapr_utils.h"
 #include "fileutils.h"
 #include "common_utils.h"
+#include "prototype_pool.h"
+#include "resource_limits.h"
 #include <QFile>
 #include <QDebug>
 #include <QThread>
@@ -14,6 +16,10 @@
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QRandomGenerator>
+#include <QProcess>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <QSet>
 
 extern std::string DK_VCU_USERNAME;
 extern std::string DK_ARCH;
@@ -38,18 +44,108 @@ int Dapr_Utils::stopApp(QString app_id) {
     return system(cmd.toUtf8());
 }
 
+QString Dapr_Utils::appContainerOptions() {
+    return " --log-opt max-size=10m --log-opt max-file=3 -v /home/" + QString::fromStdString(DK_VCU_USERNAME) + "/.dk/dk_vssgeneration/vehicle_gen/:/home/vss/vehicle_gen:ro -v /home/" + QString::fromStdString(DK_VCU_USERNAME) + "/.dk/dk_app_python_template/target/" + QString::fromStdString(DK_ARCH) + "/python-packages:/home/python-packages:ro --network host ";
+}
+
+QString Dapr_Utils::appImage() {
+    return QString::fromStdString(DK_DOCKER_HUB_NAMESPACE) + "/dk_app_python_template:baseimage";
+}
+
+QString Dapr_Utils::appSpec() {
+    return QCryptographicHash::hash((appContainerOptions() + appImage()).toUtf8(), QCryptographicHash::Sha1).toHex().left(12);
+}
+
+static QString dockerOutput(const QStringList &args) {
+    QProcess docker;
+    docker.start("docker", args);
+    if (!docker.waitForFinished(10000)) {
+        docker.kill();
+        return QString();
+    }
+    if (docker.exitStatus() != QProcess::NormalExit || docker.exitCode() != 0) {
+        return QString();
+    }
+    return QString::fromUtf8(docker.readAllStandardOutput()).trimmed();
+}
+
+bool Dapr_Utils::isAppRunning(QString app_id) {
+    if(app_id.length()<=0) return false;
+    return dockerOutput(QStringList() << "inspect" << "-f" << "{{.State.Running}}" << app_id) == "true";
+}
+
+bool Dapr_Utils::reloadApp(QString app_id) {
+    if(app_id.length()<=0) return false;
+
+    // main.py is bind mounted, restarting the container's process picks up the new code;
+    // other mounts or a new image need a new container
+    QString current = dockerOutput(QStringList() << "inspect" << "-f" << "{{index .Config.Labels \"dk.spec\"}} {{.Image}}" << app_id);
+    if (current.isEmpty()) {
+        return false;
+    }
+    QString imageId = dockerOutput(QStringList() << "image" << "inspect" << "-f" << "{{.Id}}" << appImage());
+    if (current != appSpec() + " " + imageId) {
+        qDebug() << __func__ << __LINE__ << " : " << app_id << " changed (" << current << "), recreate";
+        return false;
+    }
+
+    // the limits may have changed since the container was created
+    this->applyLimits(app_id);
+
+    QString cmd = "docker restart -t 2 " + app_id;
+    qDebug() << cmd;
+    return system(cmd.toUtf8()) == 0;
+}
+
+int Dapr_Utils::applyLimits(QString app_id) {
+    if(app_id.length()<=0) return -1;
+
+    QString options = ResourceLimits::DockerOptions(ResourceLimits::ForApp(this->_proto_dir, app_id));
+    if (options.isEmpty()) {
+        return 0;
+    }
+    QString cmd = "docker update" + options + app_id;
+    qDebug() << cmd;
+    return system(cmd.toUtf8());
+}
+
+QString Dapr_Utils::lastStartMode() {
+    return this->_last_start_mode;
+}
+
 int Dapr_Utils::startApp(QString app_id) {
     if(app_id.length()<=0) return -1;
 
+    if (this->reloadApp(app_id)) {
+        this->_last_start_mode = "reload";
+        return 0;
+    }
+
     // try to stop app before start
     this->stopApp(app_id);
 
+    // a pre-started container is much faster than docker run
+    PrototypePool *pool = PrototypePool::Instance();
+    if (pool && pool->Adopt(app_id)) {
+        // idle containers run with the default limits
+        this->applyLimits(app_id);
+        this->_last_start_mode = "pool";
+        return 0;
+    }
+    this->_last_start_mode = "cold";
+
+    // left by a pool container, the app writes its own main.log again
+    QString logFile = this->_proto_dir + app_id + "/main.log";
+    if (QFileInfo(logFile).isSymLink()) {
+        QFile::remove(logFile);
+    }
+
     QString cmd;
     cmd.clear();
 
     // docker run -d -it --name giWROQ6WzQcJOkEd3OFn --log-opt max-size=10m --log-opt max-file=3 -v ~/.dk/dk_vssgeneration/vehicle_gen/:/home/vss/vehicle_gen:ro -v ~/.dk/dk_app_python_template/target/amd64/python-packages:/home/python-packages:ro --network host -v ~/.dk/dk_manager/prototypes/giWROQ6WzQcJOkEd3OFn:/app/exec phongbosch/dk_app_python_template:baseimage
     // cmd += "docker run -d -it --name " + app_id + " --log-opt max-size=10m --log-opt max-file=3 -v /app/.dk/dk_vssgeneration/vehicle_gen/:/home/vss/vehicle_gen:ro -v /app/.dk/dk_app_python_template/target/amd64/python-packages:/home/python-packages:ro --network host -v /app/.dk/dk_manager/prototypes/" + app_id + ":/app/exec dk_app_python_template:baseimage";
-    cmd += "docker run -d -it --name " + app_id + " --log-opt max-size=10m --log-opt max-file=3 -v /home/" + QString::fromStdString(DK_VCU_USERNAME) + "/.dk/dk_vssgeneration/vehicle_gen/:/home/vss/vehicle_gen:ro -v /home/" + QString::fromStdString(DK_VCU_USERNAME) + "/.dk/dk_app_python_template/target/" + QString::fromStdString(DK_ARCH) + "/python-packages:/home/python-packages:ro --network host -v /home/" + QString::fromStdString(DK_VCU_USERNAME) + "/.dk/dk_manager/prototypes/" + app_id + ":/app/exec " + QString::fromStdString(DK_DOCKER_HUB_NAMESPACE) +"/dk_app_python_template:baseimage";
+    cmd += "docker run -d -it --name " + app_id + " --label dk.spec=" + appSpec() + appContainerOptions() + ResourceLimits::DockerOptions(ResourceLimits::ForApp(this->_proto_dir, app_id)) + "-v /home/" + QString::fromStdString(DK_VCU_USERNAME) + "/.dk/dk_manager/prototypes/" + app_id + ":/app/exec " + appImage();
     // cmd += "python3 main.py  > main.log 2>&1 &";
     qDebug() << cmd;
     return system(cmd.toUtf8());
@@ -76,26 +172,113 @@ QString Dapr_Utils::daprCliList() {
     return rawDaprRunStatus;
 }
 
+QByteArray Dapr_Utils::daprCliListJson() {
+    QProcess dapr;
+    dapr.start("dapr", QStringList() << "list" << "-o" << "json");
+    if (!dapr.waitForFinished(5000)) {
+        dapr.kill();
+        return "[]";
+    }
+    QByteArray out = dapr.readAllStandardOutput().trimmed();
+    return out.isEmpty() ? QByteArray("[]") : out;
+}
+
+QStringList Dapr_Utils::runningApps() {
+    // one query for the whole bulk operation: docker containers (prototypes started by startApp)
+    // and apps still started through the dapr cli
+    QStringList running;
+    QProcess docker;
+    docker.start("docker", QStringList() << "ps" << "--format" << "{{.Names}}");
+    if (docker.waitForFinished(5000)) {
+        running += QString::fromUtf8(docker.readAllStandardOutput()).split('\n', Qt::SkipEmptyParts);
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(daprCliListJson());
+    for (const auto app : doc.array()) {
+        running.append(app.toObject().value("appId").toString());
+    }
+    running.removeAll(QString());
+    return running;
+}
+
+QList<App_Stop_Result> Dapr_Utils::stopApps(const QStringList &app_ids, int maxParallel, int deadlineMs) {
+    QList<App_Stop_Result> results;
+    QMutex resultsMutex;
+    QElapsedTimer deadline;
+    deadline.start();
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, maxParallel));
+    for (const QString &appId : app_ids) {
+        pool.start(QRunnable::create([appId, deadlineMs, &deadline, &results, &resultsMutex]() {
+            App_Stop_Result result;
+            result.appId = appId;
+            result.stopped = false;
+
+            qint64 remaining = deadlineMs - deadline.elapsed();
+            if (remaining <= 0) {
+                result.detail = "skipped, deadline exceeded";
+            } else {
+                // docker stop is a no-op for a dapr-only app and vice versa
+                QString cmd = "docker stop -t 3 " + appId + " >/dev/null 2>&1; docker rm " + appId + " >/dev/null 2>&1; dapr stop --app-id " + appId + " >/dev/null 2>&1; exit 0";
+                QProcess proc;
+                proc.start("sh", QStringList() << "-c" << cmd);
+                if (proc.waitForFinished(remaining)) {
+                    result.stopped = true;
+                    result.detail = QString("stopped in %1 ms").arg(deadline.elapsed());
+                } else {
+                    proc.kill();
+                    proc.waitForFinished(1000);
+                    result.detail = "deadline exceeded";
+                }
+            }
+            QMutexLocker locker(&resultsMutex);
+            results.append(result);
+        }));
+    }
+    pool.waitForDone();
+    return results;
+}
+
 int Dapr_Utils::stopAllApp() {
+    QList<App_Stop_Result> results;
+    return stopAllApp(results);
+}
+
+int Dapr_Utils::stopAllApp(QList<App_Stop_Result> &results, int maxParallel, int deadlineMs) {
     qDebug() << "stop all dapr digital.auto apps and the apps based on velocitas";
-    QString prototypes_file_path = this->_log_dir + "prototypes.json";
+    QString prototypes_file_path = this->_proto_dir + "prototypes.json";
     QFile file(prototypes_file_path);
     file.open(QIODevice::ReadOnly | QIODevice::Text);
-    if (file.isOpen())
+    if (!file.isOpen()) {
+        return -1;
+    }
+    QString data = QString(file.readAll());
+    file.close();
+
+    // only the deployed prototypes which are running now
+    QSet<QString> running;
+    for (const QString &name : runningApps()) {
+        running.insert(name);
+    }
+    QStringList toStop;
+    QJsonArray jsonAppList = QJsonDocument::fromJson(data.toUtf8()).array();
+    for (const auto obj : jsonAppList)
     {
-        QString data = QString(file.readAll());
-        file.close();
-        //        qDebug() << "raw file: " << data;
-        QJsonArray jsonAppList = QJsonDocument::fromJson(data.toUtf8()).array();
-        for (const auto obj : jsonAppList)
-        {
-            QString appId = obj.toObject().value("id").toString();
-            std::string cmd = "dapr stop " + appId.toStdString();
-            qDebug() << "dapr cmd : " << QString::fromStdString(cmd);
-            std::string ret = CommonUtils::runLinuxCommand(cmd.c_str());
+        QString appId = obj.toObject().value("id").toString();
+        if (running.contains(appId) && !toStop.contains(appId)) {
+            toStop.append(appId);
+        }
+    }
+    qDebug() << __func__ << __LINE__ << " : " << toStop.size() << " of " << jsonAppList.size() << " prototypes are running";
+
+    results = stopApps(toStop, maxParallel, deadlineMs);
+    int failed = 0;
+    for (const auto &r : results) {
+        qDebug() << __func__ << __LINE__ << " : " << r.appId << " : " << r.detail;
+        if (!r.stopped) {
+            failed++;
         }
-    } else {
-        return -1;
     }
-    return 0;
+    return (failed == 0) ? 0 : -1;
 }
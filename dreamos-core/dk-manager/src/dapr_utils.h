@@ -6,6 +6,13 @@
 #include <QThread>
 #include <QFile>
 
+typedef struct
+{
+    QString appId;
+    bool stopped;
+    QString detail;
+} App_Stop_Result;
+
 class Dapr_Utils: public QObject
 {
     Q_OBJECT
@@ -14,12 +21,30 @@ private:
     QString _proto_dir;
     QString _app_args;
     QString _log_dir;
+    QString _last_start_mode;
 public:
     Dapr_Utils(QString dapr_dir, QString proto_dir, QString _log_dir);
     int stopApp(QString app_id);
     int startApp(QString app_id);
+    // "reload" when the existing container was restarted, "pool" when a pre-started
+    // container took the app, "cold" otherwise
+    QString lastStartMode();
+    // options shared by every prototype container (logs, mounts, network) and its image
+    static QString appContainerOptions();
+    static QString appImage();
+    // hash of the options and image, kept as the container's dk.spec label
+    static QString appSpec();
+    // restarts the app's container in place if its spec and image are unchanged
+    bool reloadApp(QString app_id);
+    bool isAppRunning(QString app_id);
+    // docker update of a container to the app's current limits, see ResourceLimits
+    int applyLimits(QString app_id);
     int stopAllApp();
+    int stopAllApp(QList<App_Stop_Result> &results, int maxParallel = 4, int deadlineMs = 20000);
+    QStringList runningApps();
+    QList<App_Stop_Result> stopApps(const QStringList &app_ids, int maxParallel, int deadlineMs);
     QString daprCliList();
+    QByteArray daprCliListJson();
 };
 
 #endif // DAPR_UTILS_H
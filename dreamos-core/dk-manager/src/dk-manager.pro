@@ -1,5 +1,5 @@
 QT -= gui
-QT += core network
+QT += core network websockets
 
 CONFIG += no_keywords
 CONFIG += c++11 console
@@ -9,6 +9,10 @@ CONFIG -= app_bundle
 #DEFINES += USING_DK_ORCHESTRATOR
 DEFINES += DREAMKIT_MINI
 
+# version of this build, see DK_MANAGER_VERSION in CMakeLists.txt
+isEmpty(DK_MANAGER_VERSION): DK_MANAGER_VERSION = 1.0
+DEFINES += DK_MANAGER_VERSION=\\\"$$DK_MANAGER_VERSION\\\"
+
 # The following define makes your compiler emit warnings if you use
 # any Qt feature that has been marked deprecated (the exact warnings
 # depend on your compiler). Please consult the documentation of the
@@ -26,13 +30,23 @@ SOURCES += \
         common_utils.cpp \
         dapr_utils.cpp \
         dkmanager.cpp \
+        dk_downloader.cpp \
         fileutils.cpp \
+        lan_server.cpp \
+        local_api.cpp \
+        log_uploader.cpp \
+        mapping_snapshots.cpp \
         message_to_kit_handler.cpp \
+        prototype_pool.cpp \
         prototype_utils.cpp \
+        resource_limits.cpp \
+        reply_codec.cpp \
+        swupdate.cpp \
         vcuorchestrator.cpp \
+        vss_mapping_validator.cpp \
         main.cpp
 
-LIBS += -lsioclient_tls -lssl -lcrypto
+LIBS += -lsioclient_tls -lssl -lcrypto -lzstd
 #-lboost_random -lboost_system -lboost_date_time
 
 # Default rules for deployment.
@@ -44,6 +58,16 @@ HEADERS += \
     common_utils.h \
     dapr_utils.h \
     dkmanager.h \
+    dk_downloader.h \
     fileutils.h \
+    lan_server.h \
+    local_api.h \
+    log_uploader.h \
+    mapping_snapshots.h \
     message_to_kit_handler.h \
-    prototype_utils.h
+    prototype_pool.h \
+    prototype_utils.h \
+    resource_limits.h \
+    reply_codec.h \
+    swupdate.h \
+    vss_mapping_validator.h
@@ -0,0 +1,385 @@
+#include "dk_downloader.h"
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QThread>
+#include <QTimer>
+#include <QNetworkRequest>
+#include <QCryptographicHash>
+
+// files smaller than 2 x kSegmentMinSize are downloaded in one stream
+#define kSegmentMinSize (16 * 1024 * 1024)
+#define kMaxRetries 3
+#define kRetryDelayMs 2000
+#define kProgressIntervalMs 500
+// a request which receives nothing for this long is aborted, and retried like an error
+#define kStallTimeoutMs 30000
+
+DkDownloader::DkDownloader(const QString &downloadDir, int maxConcurrent, int maxSegments, QObject *parent)
+    : QObject(parent), m_nam(new QNetworkAccessManager(this)), m_downloadDir(downloadDir),
+      m_maxConcurrent(qMax(1, maxConcurrent)), m_maxSegments(qMax(1, maxSegments))
+{
+}
+
+DkDownloader::~DkDownloader()
+{
+    // partial files are kept on disk, the next request for the same file resumes them
+    for (Job *job : m_active + m_pending)
+    {
+        for (Segment *seg : job->segments)
+        {
+            if (seg->reply)
+            {
+                seg->reply->disconnect(this);
+                seg->reply->abort();
+                seg->reply->deleteLater();
+            }
+            delete seg->file;
+            delete seg;
+        }
+        delete job;
+    }
+}
+
+void DkDownloader::enqueue(const QString &id, const QString &url, const QString &fileName, const QString &sha256)
+{
+    for (Job *job : m_active + m_pending)
+    {
+        if (job->id == id)
+        {
+            qDebug() << __func__ << __LINE__ << " : " << id << " is already in progress";
+            return;
+        }
+    }
+
+    Job *job = new Job();
+    job->id = id;
+    job->url = QUrl(url);
+    job->fileName = fileName;
+    job->sha256 = sha256.toLower();
+    job->target = QDir(m_downloadDir).filePath(fileName);
+    m_pending.append(job);
+    qDebug() << __func__ << __LINE__ << " : " << id << " queued, active = " << m_active.size() << ", pending = " << m_pending.size();
+
+    scheduleNext();
+}
+
+void DkDownloader::scheduleNext()
+{
+    // jobs for the same file would share its '.part' files, they run one after the other
+    int i = 0;
+    while (m_active.size() < m_maxConcurrent && i < m_pending.size())
+    {
+        Job *job = m_pending.at(i);
+        if (isTargetActive(job->target))
+        {
+            i++;
+            continue;
+        }
+        m_pending.removeAt(i);
+        m_active.append(job);
+        probe(job);
+    }
+}
+
+bool DkDownloader::isTargetActive(const QString &target) const
+{
+    for (Job *job : m_active)
+    {
+        if (job->target == target)
+            return true;
+    }
+    return false;
+}
+
+void DkDownloader::probe(Job *job)
+{
+    // HEAD tells the size and whether the server accepts Range requests
+    QNetworkRequest req(job->url);
+    req.setTransferTimeout(kStallTimeoutMs);
+    QNetworkReply *reply = m_nam->head(req);
+    connect(reply, &QNetworkReply::finished, this, [this, job, reply]() {
+        reply->deleteLater();
+        if (reply->error() == QNetworkReply::NoError)
+        {
+            job->total = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+            if (job->total <= 0)
+                job->total = -1;
+            job->acceptRanges = (reply->rawHeader("Accept-Ranges").toLower() == "bytes") && (job->total > 0);
+        }
+        else
+        {
+            qDebug() << __func__ << __LINE__ << " : HEAD failed (" << reply->errorString() << "), download without resume";
+        }
+        startSegments(job);
+    });
+}
+
+void DkDownloader::startSegments(Job *job)
+{
+    int count = 1;
+    if (job->acceptRanges && job->total >= 2LL * kSegmentMinSize)
+    {
+        count = qMin<qint64>(m_maxSegments, job->total / kSegmentMinSize);
+    }
+
+    qint64 segSize = (job->total > 0) ? (job->total + count - 1) / count : -1;
+    for (int i = 0; i < count; i++)
+    {
+        Segment *seg = new Segment();
+        seg->job = job;
+        seg->start = (count == 1) ? 0 : i * segSize;
+        seg->end = (count == 1) ? job->total - 1 : qMin(job->total, (i + 1) * segSize) - 1;
+        if (job->total <= 0)
+            seg->end = -1;
+        seg->file = new QFile(job->target + ((count == 1) ? QString(".part") : QString(".part%1").arg(i)));
+        job->segments.append(seg);
+    }
+
+    qDebug() << __func__ << __LINE__ << " : " << job->id << " size = " << job->total << ", segments = " << count;
+    job->lastProgress.start();
+    const QList<Segment *> segments = job->segments;
+    for (Segment *seg : segments)
+    {
+        if (!m_active.contains(job))
+            return;
+        startSegment(seg);
+    }
+}
+
+void DkDownloader::startSegment(Segment *seg)
+{
+    Job *job = seg->job;
+
+    // without Range support a retry starts from scratch
+    QIODevice::OpenMode mode = QIODevice::WriteOnly | (job->acceptRanges ? QIODevice::Append : QIODevice::Truncate);
+    if (!seg->file->isOpen() && !seg->file->open(mode))
+    {
+        finishJob(job, false, seg->file->errorString());
+        return;
+    }
+    if (!job->acceptRanges)
+    {
+        seg->file->resize(0);
+    }
+
+    qint64 have = seg->file->size();
+    qint64 length = (seg->end >= 0) ? (seg->end - seg->start + 1) : -1;
+    if (length >= 0 && have > length)
+    {
+        // left over from a different layout, start the segment again
+        seg->file->resize(0);
+        have = 0;
+    }
+    if (length >= 0 && have == length)
+    {
+        seg->done = true;
+        onSegmentFinished(seg);
+        return;
+    }
+
+    QNetworkRequest req(job->url);
+    req.setTransferTimeout(kStallTimeoutMs);
+    if (job->acceptRanges)
+    {
+        QByteArray range = "bytes=" + QByteArray::number(seg->start + have) + "-";
+        if (seg->end >= 0)
+            range += QByteArray::number(seg->end);
+        req.setRawHeader("Range", range);
+    }
+
+    QNetworkReply *reply = m_nam->get(req);
+    seg->reply = reply;
+    connect(reply, &QNetworkReply::readyRead, this, [this, seg, reply]() {
+        seg->file->write(reply->readAll());
+        reportProgress(seg->job, false);
+    });
+    connect(reply, &QNetworkReply::metaDataChanged, this, [seg, reply]() {
+        // the server ignored the Range header: a single stream takes the whole body
+        // from the beginning, a segment cannot use it
+        int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (status == 200 && seg->job->segments.size() > 1)
+        {
+            reply->abort();
+        }
+        else if (status == 200 && seg->file->size() > 0)
+        {
+            seg->file->resize(0);
+        }
+    });
+    connect(reply, &QNetworkReply::finished, this, [this, seg]() {
+        onSegmentFinished(seg);
+    });
+}
+
+void DkDownloader::onSegmentFinished(Segment *seg)
+{
+    Job *job = seg->job;
+    QNetworkReply *reply = seg->reply;
+    seg->reply = nullptr;
+
+    if (reply)
+    {
+        reply->deleteLater();
+        int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if ((status == 200) && (job->segments.size() > 1))
+        {
+            finishJob(job, false, "server ignored the Range request");
+            return;
+        }
+        if (reply->error() != QNetworkReply::NoError)
+        {
+            seg->file->flush();
+            if (seg->retries++ < kMaxRetries)
+            {
+                qDebug() << __func__ << __LINE__ << " : " << job->id << " " << reply->errorString() << ", retry " << seg->retries;
+                QTimer::singleShot(kRetryDelayMs * seg->retries, this, [this, job, seg]() {
+                    // the job may have failed on another segment meanwhile
+                    if (m_active.contains(job) && job->segments.contains(seg))
+                        startSegment(seg);
+                });
+                return;
+            }
+            finishJob(job, false, reply->errorString());
+            return;
+        }
+        seg->file->write(reply->readAll());
+        seg->done = true;
+    }
+    seg->file->close();
+
+    for (Segment *s : job->segments)
+    {
+        if (!s->done)
+            return;
+    }
+    reportProgress(job, true);
+    finalize(job);
+}
+
+void DkDownloader::finalize(Job *job)
+{
+    QStringList parts;
+    for (Segment *seg : job->segments)
+    {
+        parts.append(seg->file->fileName());
+    }
+    QString target = job->target;
+    qint64 total = job->total;
+    QString sha256 = job->sha256;
+
+    // merging and hashing a large image takes a while, keep it off the event loop
+    QThread *worker = QThread::create([this, job, parts, target, total, sha256]() {
+        QString error;
+        QString partFile = target + ".part";
+        if (parts.size() > 1)
+        {
+            QFile out(partFile);
+            if (out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            {
+                for (const QString &p : parts)
+                {
+                    QFile in(p);
+                    if (!in.open(QIODevice::ReadOnly))
+                    {
+                        error = "cannot read " + p;
+                        break;
+                    }
+                    while (!in.atEnd())
+                        out.write(in.read(1024 * 1024));
+                }
+                out.close();
+            }
+            else
+            {
+                error = out.errorString();
+            }
+            if (error.isEmpty())
+            {
+                for (const QString &p : parts)
+                    QFile::remove(p);
+            }
+        }
+
+        if (error.isEmpty() && total > 0 && QFileInfo(partFile).size() != total)
+        {
+            error = QString("size mismatch: %1 of %2 bytes").arg(QFileInfo(partFile).size()).arg(total);
+        }
+        if (error.isEmpty() && !sha256.isEmpty())
+        {
+            QFile f(partFile);
+            QCryptographicHash hash(QCryptographicHash::Sha256);
+            if (f.open(QIODevice::ReadOnly) && hash.addData(&f))
+            {
+                if (QString::fromLatin1(hash.result().toHex()) != sha256)
+                    error = "sha256 mismatch";
+            }
+            else
+            {
+                error = "cannot hash " + partFile;
+            }
+        }
+        if (!error.isEmpty())
+        {
+            // a corrupt file must not be resumed
+            QFile::remove(partFile);
+            for (const QString &p : parts)
+                QFile::remove(p);
+        }
+        else
+        {
+            QFile::remove(target);
+            if (!QFile::rename(partFile, target))
+                error = "cannot rename " + partFile;
+        }
+
+        QMetaObject::invokeMethod(this, [this, job, error]() {
+            finishJob(job, error.isEmpty(), error);
+        }, Qt::QueuedConnection);
+    });
+    connect(worker, &QThread::finished, worker, &QObject::deleteLater);
+    worker->start();
+}
+
+void DkDownloader::finishJob(Job *job, bool ok, const QString &error)
+{
+    if (!m_active.removeOne(job))
+        return;
+
+    for (Segment *seg : job->segments)
+    {
+        if (seg->reply)
+        {
+            seg->reply->disconnect(this);
+            seg->reply->abort();
+            seg->reply->deleteLater();
+        }
+        delete seg->file;
+        delete seg;
+    }
+    job->segments.clear();
+
+    qDebug() << __func__ << __LINE__ << " : " << job->id << (ok ? " done" : " failed: ") << error;
+    Q_EMIT finished(job->id, job->fileName, ok, ok ? job->target : QString(), error);
+    delete job;
+
+    scheduleNext();
+}
+
+qint64 DkDownloader::received(Job *job) const
+{
+    qint64 sum = 0;
+    for (Segment *seg : job->segments)
+    {
+        sum += seg->file->size();
+    }
+    return sum;
+}
+
+void DkDownloader::reportProgress(Job *job, bool force)
+{
+    if (!force && job->lastProgress.elapsed() < kProgressIntervalMs)
+        return;
+    job->lastProgress.restart();
+    Q_EMIT progress(job->id, job->fileName, received(job), job->total);
+}
@@ -0,0 +1,82 @@
+#ifndef DK_DOWNLOADER_H
+#define DK_DOWNLOADER_H
+
+#include <QObject>
+#include <QFile>
+#include <QList>
+#include <QUrl>
+#include <QElapsedTimer>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+
+// Asynchronous, resumable HTTP downloader used by dk_downloadFile.
+// - a download is written to '<file>.part' and renamed when it is complete (and the
+//   sha256, if given, matches), so a broken download resumes with a Range request.
+// - large files are fetched in parallel segments ('<file>.part<N>') when the server
+//   accepts ranges.
+// - at most 'maxConcurrent' downloads run at the same time, the others are queued;
+//   downloads to the same file never run at the same time.
+// - a request which receives nothing for 30 s is aborted and retried like a failed one.
+// Lives in the main thread; call enqueue() through a queued connection from other threads.
+class DkDownloader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DkDownloader(const QString &downloadDir, int maxConcurrent = 2, int maxSegments = 4, QObject *parent = nullptr);
+    ~DkDownloader();
+
+public Q_SLOTS:
+    void enqueue(const QString &id, const QString &url, const QString &fileName, const QString &sha256);
+
+Q_SIGNALS:
+    void progress(const QString &id, const QString &fileName, qint64 received, qint64 total);
+    void finished(const QString &id, const QString &fileName, bool ok, const QString &filePath, const QString &error);
+
+private:
+    struct Job;
+
+    struct Segment
+    {
+        Job *job = nullptr;
+        QFile *file = nullptr;
+        QNetworkReply *reply = nullptr;
+        qint64 start = 0;
+        qint64 end = -1;    // inclusive, -1: until the end of the stream
+        int retries = 0;
+        bool done = false;
+    };
+
+    struct Job
+    {
+        QString id;
+        QUrl url;
+        QString fileName;
+        QString sha256;
+        QString target;
+        qint64 total = -1;
+        bool acceptRanges = false;
+        QList<Segment *> segments;
+        QElapsedTimer lastProgress;
+    };
+
+    void scheduleNext();
+    bool isTargetActive(const QString &target) const;
+    void probe(Job *job);
+    void startSegments(Job *job);
+    void startSegment(Segment *seg);
+    void onSegmentFinished(Segment *seg);
+    void finalize(Job *job);
+    void finishJob(Job *job, bool ok, const QString &error);
+    qint64 received(Job *job) const;
+    void reportProgress(Job *job, bool force);
+
+    QNetworkAccessManager *m_nam;
+    QString m_downloadDir;
+    int m_maxConcurrent;
+    int m_maxSegments;
+    QList<Job *> m_pending;
+    QList<Job *> m_active;
+};
+
+#endif // DK_DOWNLOADER_H
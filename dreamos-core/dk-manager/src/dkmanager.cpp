@@ -15,6 +15,11 @@
 #include <QJsonObject>
 #include <QRandomGenerator>
 
+// set by the build (CMake DK_MANAGER_VERSION), compared with the version of a pending self-update
+#ifndef DK_MANAGER_VERSION
+#define DK_MANAGER_VERSION "dev"
+#endif
+
 QMutex digitalAutoPrototypeMutex;
 QMutex vssMappingMutex;
 QMutex vssMappingFactoryResetMutex;
@@ -54,6 +59,10 @@ std::string DK_SYSTEM_CONFIG_FILE = (DK_MGR_ROOT_DIR + "dk_system_cfg.json");
 std::string DK_LOG_FOLDER = (DK_MGR_ROOT_DIR + "log/");
 std::string DK_LOG_CMD_FOLDER = (DK_LOG_FOLDER + "cmd/");
 std::string DK_DOWNLOAD_FOLDER = (DK_MGR_ROOT_DIR + "download/");
+std::string DK_UPLOAD_FOLDER = (DK_MGR_ROOT_DIR + "upload/");
+std::string DK_LAN_TOKEN_FILE = (DK_MGR_ROOT_DIR + "lan_token");
+std::string DK_LOCAL_API_SOCKET = (DK_MGR_ROOT_DIR + "dk_manager.sock");
+std::string DK_PROTOTYPE_POOL_FOLDER = (DK_MGR_ROOT_DIR + "pool/");
 std::string DK_VSSMAPPING_FOLDER = (DK_MGR_ROOT_DIR + "vssmapping/");
 std::string DK_VSSMAPPING_GLOBAL_CONFIG = (DK_VSSMAPPING_FOLDER + "vssmapping_global_config.json");
 std::string DK_VSSMAPPING_DEPLOY_CONFIG = (DK_VSSMAPPING_FOLDER + "vssmapping_deploy_config.json");
@@ -66,6 +75,7 @@ std::string DK_VSPECS2JSON_LOG = (DK_VSSMAPPING_FOLDER + "vspec2json.log");
 std::string DK_VMODEL_GEN_LOG = (DK_VSSMAPPING_FOLDER + "gen_vehicle_model.log");
 std::string DK_DATABROKER_LOG = (DK_VSSMAPPING_FOLDER + "vehicle_databroker.log");
 std::string DK_DBCFEEDER_LOG = (DK_VSSMAPPING_FOLDER + "dbcfeeder.log");
+std::string DK_VSSMAPPING_SNAPSHOTS_FOLDER = (DK_VSSMAPPING_FOLDER + "snapshots/");
 std::string DK_VSS_SPECS_FOLDER = (DK_VSSMAPPING_FOLDER + "vss_specs/");
 std::string DK_VMODEL_GEN_FOLDER = (DK_VSSMAPPING_FOLDER + "vehicle-model-generator/");
 std::string DK_ZONECTL_FOLDER = (DK_VSSMAPPING_FOLDER);
@@ -102,8 +112,22 @@ DkManger::DkManger() : _io(new client())
 
     InitDigitalautoFolder();
 
+    InitMappingSnapshots();
+
     InitUserInfo();
 
+    InitDownloader();
+
+    InitSwUpdate();
+
+    InitLanServer();
+
+    InitLocalApi();
+
+    ResourceLimits::LoadDefaults(QString::fromStdString(DK_SYSTEM_CONFIG_FILE));
+
+    InitPrototypePool();
+
     using std::placeholders::_1;
     using std::placeholders::_2;
     using std::placeholders::_3;
@@ -124,6 +148,7 @@ DkManger::DkManger() : _io(new client())
     // _io->set_reconnect_delay_max(1000);
 #ifdef USING_DK_ORCHESTRATOR
     m_orchestrator = new DkOrchestrator();
+    InitZoneControllers();
 #endif
     m_timer = new QTimer(this);
     connect(m_timer, SIGNAL(timeout()), this, SLOT(BroadCastGlobalStatus()));
@@ -231,6 +256,177 @@ void DkManger::InitDigitalautoFolder()
     }
 }
 
+void DkManger::InitZoneControllers()
+{
+    // zone controllers and their CAN channels are configured in dk_system_cfg.json, e.g.
+    // "zonecontrollers": [ { "name": "zonecontroller", "canChannels": ["can0", "can1"], "capabilities": ["kuksa_feeder"] } ]
+    QJsonObject cfg = QJsonDocument::fromJson(FileUtils::ReadFile(QString::fromStdString(DK_SYSTEM_CONFIG_FILE)).toUtf8()).object();
+    QJsonArray zoneList = cfg.value("zonecontrollers").toArray();
+    for (const auto zoneVal : zoneList)
+    {
+        QJsonObject zoneObj = zoneVal.toObject();
+        ZoneController zone;
+        zone.name = zoneObj.value("name").toString().toStdString();
+        if (zone.name.empty())
+        {
+            continue;
+        }
+        for (const auto ch : zoneObj.value("canChannels").toArray())
+        {
+            zone.canChannels.push_back(ch.toString().toStdString());
+        }
+        for (const auto cap : zoneObj.value("capabilities").toArray())
+        {
+            zone.capabilities.push_back(cap.toString().toStdString());
+        }
+        m_orchestrator->RegisterZoneController(zone);
+    }
+
+    if (m_orchestrator->GetZoneControllers().empty())
+    {
+        // default: a single zone controller owning all CAN channels
+        ZoneController zone;
+        zone.name = "zonecontroller";
+        zone.capabilities.push_back("kuksa_feeder");
+        m_orchestrator->RegisterZoneController(zone);
+    }
+}
+
+void DkManger::InitDownloader()
+{
+    // optional limits in dk_system_cfg.json, e.g. "downloader": { "max_concurrent": 2, "segments": 4 }
+    QJsonObject cfg = QJsonDocument::fromJson(FileUtils::ReadFile(QString::fromStdString(DK_SYSTEM_CONFIG_FILE)).toUtf8()).object();
+    QJsonObject downloaderCfg = cfg.value("downloader").toObject();
+    int maxConcurrent = downloaderCfg.value("max_concurrent").toInt(2);
+    int segments = downloaderCfg.value("segments").toInt(4);
+
+    m_downloader = new DkDownloader(QString::fromStdString(DK_DOWNLOAD_FOLDER), maxConcurrent, segments, this);
+    connect(m_downloader, &DkDownloader::progress, this, &DkManger::OnDownloadProgress);
+    connect(m_downloader, &DkDownloader::finished, this, &DkManger::OnDownloadFinished);
+}
+
+void DkManger::InitSwUpdate()
+{
+    m_swUpdate = new SwUpdate(QString::fromStdString(DK_SWUPDATE_DIR), QString::fromStdString(DK_SWUPDATE_PATCH_DIR), this);
+    connect(m_swUpdate, &SwUpdate::progress, this, &DkManger::OnSelfUpdateProgress);
+    connect(m_swUpdate, &SwUpdate::finished, this, &DkManger::OnSelfUpdateFinished);
+
+    // roll back an update which keeps failing before it reaches the server
+    m_swUpdate->CheckPendingUpdates();
+}
+
+void DkManger::InitLanServer()
+{
+    // optional, e.g. "lan_server": { "enabled": true, "port": 8765, "token": "", "cert": "", "key": "", "insecure": false, "advertise": [] }
+    QJsonObject cfg = QJsonDocument::fromJson(FileUtils::ReadFile(QString::fromStdString(DK_SYSTEM_CONFIG_FILE)).toUtf8()).object();
+    QJsonObject lanCfg = cfg.value("lan_server").toObject();
+    if (!lanCfg.value("enabled").toBool(false))
+    {
+        return;
+    }
+
+    QString token = lanCfg.value("token").toString();
+    if (token.isEmpty())
+    {
+        // generated once and kept, the cloud hands it to the kit's web clients via register_kit
+        token = FileUtils::ReadFile(QString::fromStdString(DK_LAN_TOKEN_FILE)).trimmed();
+        if (token.isEmpty())
+        {
+            QByteArray bytes;
+            for (int i = 0; i < 8; i++)
+            {
+                quint32 r = QRandomGenerator::system()->generate();
+                bytes.append(reinterpret_cast<const char *>(&r), sizeof(r));
+            }
+            token = QString::fromLatin1(bytes.toHex());
+            QFile file(QString::fromStdString(DK_LAN_TOKEN_FILE));
+            if (file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            {
+                file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+                file.write(token.toUtf8());
+            }
+        }
+    }
+    for (const auto item : lanCfg.value("advertise").toArray())
+    {
+        m_lanAdvertise.append(item.toString());
+    }
+
+    m_lanServer = new LanServer(token, [this](message::ptr const &data, const ReplySink &sink) {
+        StartMessageToKitHandler(data, sink);
+    }, this);
+    if (!m_lanServer->Listen(lanCfg.value("port").toInt(8765), lanCfg.value("cert").toString(), lanCfg.value("key").toString(),
+                             lanCfg.value("insecure").toBool(false)))
+    {
+        delete m_lanServer;
+        m_lanServer = nullptr;
+    }
+}
+
+void DkManger::InitLocalApi()
+{
+    // shared with the other containers through the .dk mount
+    m_localApi = new LocalApi(QString::fromStdString(DK_LOCAL_API_SOCKET), QString::fromStdString(DK_PROTOTYPES_FOLDER),
+                              QString::fromStdString(DK_LOG_FOLDER), this);
+    if (!m_localApi->Start())
+    {
+        delete m_localApi;
+        m_localApi = nullptr;
+    }
+}
+
+void DkManger::InitMappingSnapshots()
+{
+    // everything a vss mapping changes; the live paths become links into the current snapshot
+    QList<QPair<QString, QString>> files;
+    files.append(qMakePair(QString("vssmapping_overlay.vspec"), QString::fromStdString(DK_VSSOVERLAY_VSPECS)));
+    files.append(qMakePair(QString("vssmapping_dbc_can_channels.json"), QString::fromStdString(DK_VSSMAPPING_DBC_CAN)));
+    files.append(qMakePair(QString("vssmapping_deploy_config.json"), QString::fromStdString(DK_VSSMAPPING_DEPLOY_CONFIG)));
+    files.append(qMakePair(QString("dbc_default_values.json"), QString::fromStdString(DK_DBCDEFAULT_VALUES)));
+    files.append(qMakePair(QString("vss.json"), QString::fromStdString(DK_VSS_VSPECS_JSON)));
+    files.append(qMakePair(QString("start_kuksa_feeder_script.sh"), QString::fromStdString(DK_STARTKUKFEEDER_SCRIPT)));
+    files.append(qMakePair(QString("stop_kuksa_feeder_script.sh"), QString::fromStdString(DK_STOPKUKFEEDER_SCRIPT)));
+    files.append(qMakePair(QString("supportedvssapi.json"), QString::fromStdString(DK_SUPPORTED_VSS_FILE)));
+    // the vssgen and databroker containers mount dk_vssgeneration/ or the file alone, a link into dk_manager/ would dangle there
+    QStringList copied;
+    copied.append("vss.json");
+
+    // same content as InitDigitalautoFolder creates, vss.json is generated on the first factory reset
+    QHash<QString, QString> factoryContent;
+    factoryContent["vssmapping_overlay.vspec"] = "Vehicle:\n  type: branch\n\n";
+    factoryContent["vssmapping_dbc_can_channels.json"] = "[]";
+    factoryContent["vssmapping_deploy_config.json"] = "{}";
+    factoryContent["dbc_default_values.json"] = "{}";
+    factoryContent["start_kuksa_feeder_script.sh"] = "";
+    factoryContent["stop_kuksa_feeder_script.sh"] = "pkill -f 'python3 dbcfeeder.py'\n";
+    factoryContent["supportedvssapi.json"] = "[]";
+
+    MappingSnapshots::Init(QString::fromStdString(DK_VSSMAPPING_SNAPSHOTS_FOLDER), files, copied, factoryContent);
+}
+
+void DkManger::InitPrototypePool()
+{
+    // optional, e.g. "prototype_pool": { "size": 2, "python": "python3", "preload": ["vehicle"] }
+    QJsonObject cfg = QJsonDocument::fromJson(FileUtils::ReadFile(QString::fromStdString(DK_SYSTEM_CONFIG_FILE)).toUtf8()).object();
+    QJsonObject poolCfg = cfg.value("prototype_pool").toObject();
+    int size = poolCfg.value("size").toInt(0);
+    if (size <= 0)
+    {
+        return;
+    }
+    QStringList preload;
+    for (const auto item : poolCfg.value("preload").toArray())
+    {
+        preload.append(item.toString());
+    }
+
+    // docker runs on the host, mounts need the host's paths
+    QString hostMgrDir = "/home/" + QString::fromStdString(DK_VCU_USERNAME) + "/.dk/dk_manager/";
+    m_prototypePool = new PrototypePool(QString::fromStdString(DK_PROTOTYPE_POOL_FOLDER), hostMgrDir + "pool/",
+                                        QString::fromStdString(DK_PROTOTYPES_FOLDER), hostMgrDir + "prototypes", size, poolCfg.value("python").toString("python3"), preload);
+    m_prototypePool->Start();
+}
+
 void DkManger::Start()
 {
     qDebug() << "URL: " << kURL;
@@ -248,13 +444,21 @@ DkManger::~DkManger()
     delete m_timer;
     delete _io;
     delete m_orchestrator;
+    delete m_logUploader;
+    delete m_prototypePool;
 }
 
 void DkManger::OnMessageToKit(std::string const &name, message::ptr const &data, bool hasAck, message::list &ack_resp)
 {
     // qDebug() << __func__ << __LINE__;
 
+    StartMessageToKitHandler(data, ReplySink());
+}
+
+void DkManger::StartMessageToKitHandler(message::ptr const &data, const ReplySink &sink)
+{
     MessageToKitHandler *messageToKitHandler = new MessageToKitHandler(_io, data, m_orchestrator);
+    messageToKitHandler->SetReplySink(sink);
     connect(messageToKitHandler, &MessageToKitHandler::messageToKitHandlerFinished, this, &DkManger::FinishedHandler);
     messageToKitHandler->start();
     // qDebug() << __func__ << __LINE__ << "messageToKitHandler address = " << messageToKitHandler;
@@ -263,6 +467,58 @@ void DkManger::OnMessageToKit(std::string const &name, message::ptr const &data,
 void DkManger::OnSelfUpdateRequest(std::string const &name, message::ptr const &data, bool hasAck, message::list &ack_resp)
 {
     qDebug() << __func__ << __LINE__;
+
+    if (data->get_flag() != message::flag_object)
+    {
+        return;
+    }
+
+    // { "target": "dk_manager" (the only target which confirms its updates), "action": "update" (default) | "rollback",
+    //   "type": "delta" | "full", "version", "base_version", "url", "patch_sha256", "sha256" }
+    auto field = [&data](const char *key) -> QString {
+        message::ptr value = data->get_map()[key];
+        if (value && value->get_flag() == message::flag_string)
+        {
+            return QString::fromStdString(value->get_string());
+        }
+        return QString();
+    };
+
+    QString target = field("target");
+    if (field("action") == "rollback")
+    {
+        QMetaObject::invokeMethod(m_swUpdate, "Rollback", Qt::QueuedConnection, Q_ARG(QString, target));
+        return;
+    }
+
+    QString type = field("type").isEmpty() ? QString("delta") : field("type");
+    QMetaObject::invokeMethod(m_swUpdate, "RequestUpdate", Qt::QueuedConnection,
+                              Q_ARG(QString, target),
+                              Q_ARG(QString, type),
+                              Q_ARG(QString, field("version")),
+                              Q_ARG(QString, field("base_version")),
+                              Q_ARG(QString, field("url")),
+                              Q_ARG(QString, field("patch_sha256")),
+                              Q_ARG(QString, field("sha256")));
+}
+
+void DkManger::OnSelfUpdateProgress(const QString &target, qint64 received, qint64 total)
+{
+    message::ptr obj = object_message::create();
+    obj->get_map()["target"] = string_message::create(target.toStdString());
+    obj->get_map()["received"] = int_message::create(received);
+    obj->get_map()["total"] = int_message::create(total);
+    _io->socket()->emit("dk_selfUpdate-progress", obj);
+}
+
+void DkManger::OnSelfUpdateFinished(const QString &target, const QString &version, bool ok, const QString &log)
+{
+    message::ptr obj = object_message::create();
+    obj->get_map()["target"] = string_message::create(target.toStdString());
+    obj->get_map()["version"] = string_message::create(version.toStdString());
+    obj->get_map()["result"] = bool_message::create(ok);
+    obj->get_map()["log"] = string_message::create(log.toStdString());
+    _io->socket()->emit("dk_selfUpdate-result", obj);
 }
 
 void DkManger::OnDownloadFileRequest(std::string const &name, message::ptr const &data, bool hasAck, message::list &ack_resp)
@@ -271,24 +527,153 @@ void DkManger::OnDownloadFileRequest(std::string const &name, message::ptr const
 
     if (data->get_flag() == message::flag_object)
     {
-        std::string cmd;
-        cmd.clear();
-        cmd = "> " + DK_DOWNLOAD_LOGFILE;
-        system(cmd.data()); // clear old log,
-
         std::string filename = data->get_map()["filename"]->get_string();
         std::string url = data->get_map()["url"]->get_string();
+        // optional: "id" to match the progress/result events, "sha256" to verify the file
+        std::string id = filename;
+        std::string sha256;
+        if (data->get_map()["id"] && data->get_map()["id"]->get_flag() == message::flag_string)
+        {
+            id = data->get_map()["id"]->get_string();
+        }
+        if (data->get_map()["sha256"] && data->get_map()["sha256"]->get_flag() == message::flag_string)
+        {
+            sha256 = data->get_map()["sha256"]->get_string();
+        }
+        qDebug() << __func__ << __LINE__ << " : " << QString::fromStdString(url) << " -> " << QString::fromStdString(filename);
 
-        cmd.clear();
-        cmd = "wget -O " + DK_DOWNLOAD_FOLDER + filename + " " + url + " -o " + DK_DOWNLOAD_LOGFILE;
-        qDebug() << __func__ << __LINE__ << " cmd : " << QString::fromStdString(cmd);
-        system(cmd.data());
+        // the socket.io thread must not wait for the download
+        QMetaObject::invokeMethod(m_downloader, "enqueue", Qt::QueuedConnection,
+                                  Q_ARG(QString, QString::fromStdString(id)),
+                                  Q_ARG(QString, QString::fromStdString(url)),
+                                  Q_ARG(QString, QString::fromStdString(filename)),
+                                  Q_ARG(QString, QString::fromStdString(sha256)));
+
+        if (hasAck)
+        {
+            message::ptr obj = object_message::create();
+            obj->get_map()["id"] = string_message::create(id);
+            obj->get_map()["queued"] = bool_message::create(true);
+            ack_resp.push(obj);
+        }
+    }
+}
+
+void DkManger::OnDownloadProgress(const QString &id, const QString &fileName, qint64 received, qint64 total)
+{
+    message::ptr obj = object_message::create();
+    obj->get_map()["id"] = string_message::create(id.toStdString());
+    obj->get_map()["filename"] = string_message::create(fileName.toStdString());
+    obj->get_map()["received"] = int_message::create(received);
+    obj->get_map()["total"] = int_message::create(total);
+    _io->socket()->emit("dk_downloadFile-progress", obj);
+}
+
+void DkManger::OnDownloadFinished(const QString &id, const QString &fileName, bool ok, const QString &filePath, const QString &error)
+{
+    QString logLine = QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss") + " " + id + " : " + (ok ? filePath : "failed, " + error) + "\n";
+    QFile log(QString::fromStdString(DK_DOWNLOAD_LOGFILE));
+    if (log.open(QIODevice::Append | QIODevice::Text))
+    {
+        log.write(logLine.toUtf8());
+        log.close();
     }
+
+    message::ptr obj = object_message::create();
+    obj->get_map()["id"] = string_message::create(id.toStdString());
+    obj->get_map()["filename"] = string_message::create(fileName.toStdString());
+    obj->get_map()["result"] = bool_message::create(ok);
+    obj->get_map()["path"] = string_message::create(filePath.toStdString());
+    obj->get_map()["error"] = string_message::create(error.toStdString());
+    _io->socket()->emit("dk_downloadFile-result", obj);
 }
 
 void DkManger::OnUploadFileRequest(std::string const &name, message::ptr const &data, bool hasAck, message::list &ack_resp)
 {
     qDebug() << __func__ << __LINE__;
+
+    if (data->get_flag() != message::flag_object)
+    {
+        return;
+    }
+
+    // { "upload_id": "...", "paths": ["log", "vssmapping/*.log"], "offset": 0, "max_rate_kbps": 256 }
+    // paths are relative to DK_MGR_ROOT_DIR; offset resumes an upload the server already has a part of.
+    std::string uploadId = "dk_logs_" + QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss").toStdString();
+    QStringList paths;
+    qint64 offset = 0;
+    int maxRateKbps = 256;
+
+    auto &map = data->get_map();
+    if (map["upload_id"] && map["upload_id"]->get_flag() == message::flag_string)
+    {
+        uploadId = map["upload_id"]->get_string();
+    }
+    if (map["paths"] && map["paths"]->get_flag() == message::flag_array)
+    {
+        for (const auto &p : map["paths"]->get_vector())
+        {
+            if (p->get_flag() == message::flag_string)
+            {
+                paths.append(QString::fromStdString(p->get_string()));
+            }
+        }
+    }
+    if (map["offset"] && map["offset"]->get_flag() == message::flag_integer)
+    {
+        offset = map["offset"]->get_int();
+    }
+    if (map["max_rate_kbps"] && map["max_rate_kbps"]->get_flag() == message::flag_integer)
+    {
+        maxRateKbps = map["max_rate_kbps"]->get_int();
+    }
+    if (paths.isEmpty())
+    {
+        paths << "log" << "vssmapping/*.log";
+    }
+
+    // only logs may leave the kit (not lan_token, dk_system_cfg.json, ...): the log folder
+    // and the vssmapping logs. The paths also end up in a shell command.
+    QRegularExpression logPath("^log(/[A-Za-z0-9_.*-]+)*/?$");
+    QRegularExpression vssMappingLogPath("^vssmapping/[A-Za-z0-9_.*-]+\\.log$");
+    QRegularExpression validId("^[A-Za-z0-9_.-]+$");
+    bool valid = validId.match(QString::fromStdString(uploadId)).hasMatch();
+    for (const QString &p : paths)
+    {
+        valid = valid && (logPath.match(p).hasMatch() || vssMappingLogPath.match(p).hasMatch()) && !p.contains("..");
+    }
+
+    QString status;
+    if (!valid)
+    {
+        status = "invalid request";
+    }
+    else if (m_logUploader && m_logUploader->isRunning() && m_logUploader->UploadId() == QString::fromStdString(uploadId))
+    {
+        m_logUploader->Resume(offset);
+        status = "resumed";
+    }
+    else if (m_logUploader && m_logUploader->isRunning())
+    {
+        status = "busy with " + m_logUploader->UploadId();
+    }
+    else
+    {
+        delete m_logUploader;
+        m_logUploader = new LogUploader(_io, QString::fromStdString(uploadId), QString::fromStdString(DK_MGR_ROOT_DIR), paths,
+                                        QString::fromStdString(DK_UPLOAD_FOLDER), offset, maxRateKbps);
+        m_logUploader->start();
+        status = "started";
+    }
+    qDebug() << __func__ << __LINE__ << " : " << QString::fromStdString(uploadId) << " " << status;
+
+    if (hasAck)
+    {
+        message::ptr obj = object_message::create();
+        obj->get_map()["upload_id"] = string_message::create(uploadId);
+        obj->get_map()["status"] = string_message::create(status.toStdString());
+        ack_resp.push(obj);
+    }
 }
 
 void DkManger::OnConnected(std::string const &nsp)
@@ -303,19 +688,42 @@ void DkManger::OnConnected(std::string const &nsp)
     obj->get_map()["kit_id"] = string_message::create(serialNo.toStdString());
     obj->get_map()["name"] = string_message::create(serialNo.toStdString());
     obj->get_map()["support_apis"] = string_message::create(supportAPIs.toStdString());
-    _io->socket()->emit("register_kit", obj);
+    // a server which knows the capabilities acks with the ones it accepts, others do not ack
+    obj->get_map()["capabilities"] = ReplyCodec::Capabilities();
+    if (m_lanServer)
+    {
+        // clients on the same network can talk to the kit directly and fall back to the server
+        obj->get_map()["lan_endpoint"] = m_lanServer->Endpoint(m_lanAdvertise);
+    }
+    // the server may not be the one of the last connection
+    ReplyCodec::ResetServerCapabilities();
+    _io->socket()->emit("register_kit", obj, [](message::list const &ack) {
+        ReplyCodec::SetServerCapabilities(ack);
+    });
 
     isSocketConnected = true;
+
+    // continue an upload which lost its connection
+    if (m_logUploader && m_logUploader->isRunning())
+    {
+        m_logUploader->Resume();
+    }
+
+    // this version works, keep it; an update installed by this process is kept by its own binary
+    QMetaObject::invokeMethod(m_swUpdate, "Commit", Qt::QueuedConnection,
+                              Q_ARG(QString, QString("dk_manager")), Q_ARG(QString, QString(DK_MANAGER_VERSION)));
 }
 
 void DkManger::OnClosed(client::close_reason const &reason)
 {
     qDebug() << __func__ << __LINE__;
+    ReplyCodec::ResetServerCapabilities();
 }
 
 void DkManger::OnFailed()
 {
     qDebug() << __func__ << __LINE__;
+    ReplyCodec::ResetServerCapabilities();
 }
 
 void DkManger::BroadCastGlobalStatus()
@@ -7,6 +7,14 @@
 #include <sio_client.h>
 #include "vcuorchestrator.hpp"
 #include "message_to_kit_handler.h"
+#include "dk_downloader.h"
+#include "swupdate.h"
+#include "log_uploader.h"
+#include "lan_server.h"
+#include "local_api.h"
+#include "prototype_pool.h"
+#include "resource_limits.h"
+#include "mapping_snapshots.h"
 
 using namespace sio;
 
@@ -27,6 +35,10 @@ Q_SIGNALS:
 private Q_SLOTS:
     void FinishedHandler(MessageToKitHandler *thread);
     void BroadCastGlobalStatus();
+    void OnDownloadProgress(const QString &id, const QString &fileName, qint64 received, qint64 total);
+    void OnDownloadFinished(const QString &id, const QString &fileName, bool ok, const QString &filePath, const QString &error);
+    void OnSelfUpdateProgress(const QString &target, qint64 received, qint64 total);
+    void OnSelfUpdateFinished(const QString &target, const QString &version, bool ok, const QString &log);
 
 private:
     //    void OnExecuteCmd(std::string const& name,message::ptr const& data,bool hasAck,message::list &ack_resp);
@@ -34,6 +46,7 @@ private:
     void OnDownloadFileRequest(std::string const &name, message::ptr const &data, bool hasAck, message::list &ack_resp);
     void OnUploadFileRequest(std::string const &name, message::ptr const &data, bool hasAck, message::list &ack_resp);
     void OnMessageToKit(std::string const &name, message::ptr const &data, bool hasAck, message::list &ack_resp);
+    void StartMessageToKitHandler(message::ptr const &data, const ReplySink &sink);
 
     void OnConnected(std::string const &nsp);
     void OnClosed(client::close_reason const &reason);
@@ -44,11 +57,32 @@ private:
 
     void InitDigitalautoFolder();
 
+    void InitMappingSnapshots();
+
     void InitUserInfo();
 
+    void InitZoneControllers();
+
+    void InitDownloader();
+
+    void InitSwUpdate();
+
+    void InitLanServer();
+
+    void InitLocalApi();
+
+    void InitPrototypePool();
+
     //    std::unique_ptr<client> _io;
     client *_io;
     DkOrchestrator *m_orchestrator = nullptr;
+    DkDownloader *m_downloader = nullptr;
+    SwUpdate *m_swUpdate = nullptr;
+    LogUploader *m_logUploader = nullptr;
+    LanServer *m_lanServer = nullptr;
+    LocalApi *m_localApi = nullptr;
+    PrototypePool *m_prototypePool = nullptr;
+    QStringList m_lanAdvertise;
 
     QTimer *m_timer;
     bool isSocketConnected = false;
@@ -0,0 +1,493 @@
+#include "lan_server.h"
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QNetworkInterface>
+#include <QPointer>
+#include <QRandomGenerator>
+#include <QSslCertificate>
+#include <QSslConfiguration>
+#include <QSslKey>
+#include <QUrlQuery>
+
+#define kLanPingIntervalMs 25000
+#define kLanPingTimeoutMs 20000
+// a client has to authenticate within this time after connecting
+#define kLanAuthTimeoutMs 10000
+#define kLanMaxClients 16
+// deployments carry the whole prototype code
+#define kLanMaxPayload (16 * 1024 * 1024)
+#define kLanMaxAttachments 16
+
+static QMutex announcedMutex;
+static message::ptr announcedEndpoint;
+
+static QJsonValue MessageToJson(message::ptr const &msg, std::vector<std::shared_ptr<const std::string>> &buffers)
+{
+    if (!msg)
+    {
+        return QJsonValue();
+    }
+    switch (msg->get_flag())
+    {
+    case message::flag_integer:
+        return QJsonValue((qint64)msg->get_int());
+    case message::flag_double:
+        return QJsonValue(msg->get_double());
+    case message::flag_string:
+        return QJsonValue(QString::fromStdString(msg->get_string()));
+    case message::flag_boolean:
+        return QJsonValue(msg->get_bool());
+    case message::flag_binary:
+    {
+        // sent as an attachment of a binary event
+        QJsonObject placeholder;
+        placeholder["_placeholder"] = true;
+        placeholder["num"] = (int)buffers.size();
+        buffers.push_back(msg->get_binary());
+        return placeholder;
+    }
+    case message::flag_array:
+    {
+        QJsonArray arr;
+        for (const auto &item : msg->get_vector())
+        {
+            arr.append(MessageToJson(item, buffers));
+        }
+        return arr;
+    }
+    case message::flag_object:
+    {
+        QJsonObject obj;
+        for (const auto &item : msg->get_map())
+        {
+            obj[QString::fromStdString(item.first)] = MessageToJson(item.second, buffers);
+        }
+        return obj;
+    }
+    default:
+        return QJsonValue();
+    }
+}
+
+static void ResolvePlaceholders(message::ptr &msg, const std::vector<std::shared_ptr<const std::string>> &buffers)
+{
+    if (!msg)
+    {
+        return;
+    }
+    if (msg->get_flag() == message::flag_array)
+    {
+        for (auto &item : msg->get_vector())
+        {
+            ResolvePlaceholders(item, buffers);
+        }
+    }
+    else if (msg->get_flag() == message::flag_object)
+    {
+        auto &map = msg->get_map();
+        auto placeholder = map.find("_placeholder");
+        auto num = map.find("num");
+        if (placeholder != map.end() && num != map.end() && num->second->get_flag() == message::flag_integer)
+        {
+            size_t index = (size_t)num->second->get_int();
+            if (index < buffers.size())
+            {
+                msg = binary_message::create(buffers[index]);
+            }
+            return;
+        }
+        for (auto &item : map)
+        {
+            ResolvePlaceholders(item.second, buffers);
+        }
+    }
+}
+
+static QString NewSid()
+{
+    QByteArray bytes;
+    for (int i = 0; i < 4; i++)
+    {
+        quint32 r = QRandomGenerator::system()->generate();
+        bytes.append(reinterpret_cast<const char *>(&r), sizeof(r));
+    }
+    return QString::fromLatin1(bytes.toBase64(QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals));
+}
+
+LanServer::LanServer(const QString &token, const RequestHandler &handler, QObject *parent)
+    : QObject(parent), m_token(token), m_handler(handler)
+{
+    m_pingTimer = new QTimer(this);
+    connect(m_pingTimer, &QTimer::timeout, this, &LanServer::OnPing);
+}
+
+LanServer::~LanServer()
+{
+    for (auto it = m_clients.begin(); it != m_clients.end(); ++it)
+    {
+        it.key()->disconnect(this);
+        it.key()->close();
+        it.key()->deleteLater();
+    }
+    m_clients.clear();
+}
+
+bool LanServer::Listen(quint16 port, const QString &certFile, const QString &keyFile, bool allowInsecure)
+{
+    bool secure = !certFile.isEmpty() && !keyFile.isEmpty();
+    if (!secure && !allowInsecure)
+    {
+        qDebug() << __func__ << __LINE__ << " : no cert/key, not starting without \"insecure\": true";
+        return false;
+    }
+    m_server = new QWebSocketServer("dk_manager", secure ? QWebSocketServer::SecureMode : QWebSocketServer::NonSecureMode, this);
+    if (secure)
+    {
+        QFile cert(certFile);
+        QFile key(keyFile);
+        if (!cert.open(QIODevice::ReadOnly) || !key.open(QIODevice::ReadOnly))
+        {
+            qDebug() << __func__ << __LINE__ << " : cannot read " << certFile << " / " << keyFile;
+            return false;
+        }
+        QSslKey sslKey(&key, QSsl::Rsa, QSsl::Pem);
+        if (sslKey.isNull())
+        {
+            key.seek(0);
+            sslKey = QSslKey(&key, QSsl::Ec, QSsl::Pem);
+        }
+        QSslConfiguration ssl = QSslConfiguration::defaultConfiguration();
+        ssl.setPeerVerifyMode(QSslSocket::VerifyNone);
+        ssl.setLocalCertificate(QSslCertificate(&cert, QSsl::Pem));
+        ssl.setPrivateKey(sslKey);
+        m_server->setSslConfiguration(ssl);
+    }
+    connect(m_server, &QWebSocketServer::newConnection, this, &LanServer::OnNewConnection);
+
+    if (!m_server->listen(QHostAddress::Any, port))
+    {
+        qDebug() << __func__ << __LINE__ << " : cannot listen on port " << port << " : " << m_server->errorString();
+        return false;
+    }
+    m_port = m_server->serverPort();
+    m_secure = secure;
+    m_pingTimer->start(kLanPingIntervalMs);
+    qDebug() << __func__ << __LINE__ << " : listening on port " << m_port << (secure ? " (wss)" : " (ws)");
+    return true;
+}
+
+message::ptr LanServer::Endpoint(const QStringList &advertise) const
+{
+    QStringList addresses = advertise;
+    if (addresses.isEmpty())
+    {
+        for (const QHostAddress &address : QNetworkInterface::allAddresses())
+        {
+            if (address.protocol() == QAbstractSocket::IPv4Protocol && !address.isLoopback())
+            {
+                addresses.append(address.toString());
+            }
+        }
+    }
+
+    message::ptr urls = array_message::create();
+    for (const QString &address : addresses)
+    {
+        QString url = QString("%1://%2:%3").arg(m_secure ? "wss" : "ws").arg(address).arg(m_port);
+        urls->get_vector().push_back(string_message::create(url.toStdString()));
+    }
+    message::ptr obj = object_message::create();
+    obj->get_map()["urls"] = urls;
+    obj->get_map()["path"] = string_message::create("/socket.io/");
+    obj->get_map()["token"] = string_message::create(m_token.toStdString());
+
+    QMutexLocker locker(&announcedMutex);
+    announcedEndpoint = obj;
+    return obj;
+}
+
+message::ptr LanServer::Announced()
+{
+    QMutexLocker locker(&announcedMutex);
+    return announcedEndpoint;
+}
+
+bool LanServer::TokenMatches(const QString &token) const
+{
+    // compare in constant time
+    QByteArray a = token.toUtf8();
+    QByteArray b = m_token.toUtf8();
+    if (a.isEmpty() || a.size() != b.size())
+    {
+        return false;
+    }
+    char diff = 0;
+    for (int i = 0; i < a.size(); i++)
+    {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
+
+void LanServer::OnNewConnection()
+{
+    while (m_server->hasPendingConnections())
+    {
+        QWebSocket *socket = m_server->nextPendingConnection();
+        QUrlQuery query(socket->requestUrl());
+        if (!socket->requestUrl().path().startsWith("/socket.io") || query.queryItemValue("EIO") != "4" || m_clients.size() >= kLanMaxClients)
+        {
+            qDebug() << __func__ << __LINE__ << " : reject " << socket->requestUrl().toString();
+            socket->close(QWebSocketProtocol::CloseCodePolicyViolated);
+            socket->deleteLater();
+            continue;
+        }
+        socket->setMaxAllowedIncomingMessageSize(kLanMaxPayload);
+
+        Client client;
+        client.sid = NewSid();
+        client.lastSeen.start();
+        m_clients.insert(socket, client);
+
+        connect(socket, &QWebSocket::textMessageReceived, this, &LanServer::OnTextMessage);
+        connect(socket, &QWebSocket::binaryMessageReceived, this, &LanServer::OnBinaryMessage);
+        connect(socket, &QWebSocket::disconnected, this, &LanServer::OnDisconnected);
+        QTimer::singleShot(kLanAuthTimeoutMs, socket, [this, socket]() {
+            if (m_clients.contains(socket) && !m_clients[socket].authorized)
+            {
+                socket->close(QWebSocketProtocol::CloseCodePolicyViolated);
+            }
+        });
+
+        // Engine.IO open packet
+        socket->sendTextMessage(QString("0{\"sid\":\"%1\",\"upgrades\":[],\"pingInterval\":%2,\"pingTimeout\":%3,\"maxPayload\":%4}")
+                                    .arg(client.sid).arg(kLanPingIntervalMs).arg(kLanPingTimeoutMs).arg(kLanMaxPayload));
+        qDebug() << __func__ << __LINE__ << " : " << socket->peerAddress().toString() << " connected";
+    }
+}
+
+void LanServer::OnDisconnected()
+{
+    QWebSocket *socket = qobject_cast<QWebSocket *>(sender());
+    if (!socket)
+    {
+        return;
+    }
+    qDebug() << __func__ << __LINE__ << " : " << socket->peerAddress().toString() << " disconnected";
+    m_clients.remove(socket);
+    socket->deleteLater();
+}
+
+void LanServer::OnPing()
+{
+    for (auto it = m_clients.begin(); it != m_clients.end(); ++it)
+    {
+        if (it.value().lastSeen.elapsed() > kLanPingIntervalMs + kLanPingTimeoutMs)
+        {
+            it.key()->close(QWebSocketProtocol::CloseCodeGoingAway);
+            continue;
+        }
+        it.key()->sendTextMessage("2");
+    }
+}
+
+void LanServer::OnTextMessage(const QString &text)
+{
+    QWebSocket *socket = qobject_cast<QWebSocket *>(sender());
+    if (!socket || !m_clients.contains(socket) || text.isEmpty())
+    {
+        return;
+    }
+    Client &client = m_clients[socket];
+    client.lastSeen.restart();
+
+    // Engine.IO packet types: 1 close, 2 ping, 3 pong, 4 message, 6 noop
+    QChar type = text.at(0);
+    if (type == '2')
+    {
+        socket->sendTextMessage("3" + text.mid(1));
+        return;
+    }
+    if (type == '1')
+    {
+        socket->close();
+        return;
+    }
+    if (type != '4' || text.size() < 2)
+    {
+        return;
+    }
+
+    QString packet = text.mid(1);
+    if (packet.at(0) == '5' || packet.at(0) == '6')
+    {
+        // binary event/ack: "<type><attachments>-..." followed by the attachments
+        int dash = packet.indexOf('-');
+        int attachments = (dash > 1) ? packet.mid(1, dash - 1).toInt() : 0;
+        if (attachments <= 0 || attachments > kLanMaxAttachments)
+        {
+            socket->close(QWebSocketProtocol::CloseCodeProtocolError);
+            return;
+        }
+        client.pendingPacket = packet;
+        client.pendingAttachments = attachments;
+        client.pendingBuffers.clear();
+        return;
+    }
+    HandlePacket(socket, packet, Buffers());
+}
+
+void LanServer::OnBinaryMessage(const QByteArray &data)
+{
+    QWebSocket *socket = qobject_cast<QWebSocket *>(sender());
+    if (!socket || !m_clients.contains(socket))
+    {
+        return;
+    }
+    Client &client = m_clients[socket];
+    client.lastSeen.restart();
+    if (client.pendingAttachments <= 0)
+    {
+        return;
+    }
+
+    client.pendingBuffers.push_back(std::make_shared<const std::string>(data.constData(), data.size()));
+    if ((int)client.pendingBuffers.size() < client.pendingAttachments)
+    {
+        return;
+    }
+    QString packet = client.pendingPacket;
+    Buffers buffers;
+    buffers.swap(client.pendingBuffers);
+    client.pendingPacket.clear();
+    client.pendingAttachments = 0;
+    HandlePacket(socket, packet, buffers);
+}
+
+void LanServer::HandlePacket(QWebSocket *socket, const QString &packet, const Buffers &buffers)
+{
+    // socket.io packet: <type>[<attachments>-][<namespace>,][<ack id>][<json>]
+    Client &client = m_clients[socket];
+    int type = packet.at(0).digitValue();
+    int pos = 1;
+    if (type == 5 || type == 6)
+    {
+        pos = packet.indexOf('-') + 1;
+    }
+    if (pos < packet.size() && packet.at(pos) == '/')
+    {
+        int comma = packet.indexOf(',', pos);
+        QString nsp = packet.mid(pos, (comma < 0) ? -1 : comma - pos);
+        if (nsp != "/")
+        {
+            socket->sendTextMessage("44" + nsp + ",{\"message\":\"Invalid namespace\"}");
+            return;
+        }
+        pos = (comma < 0) ? packet.size() : comma + 1;
+    }
+    int ackStart = pos;
+    while (pos < packet.size() && packet.at(pos).isDigit())
+    {
+        pos++;
+    }
+    QString ackId = packet.mid(ackStart, pos - ackStart);
+    QJsonDocument doc = QJsonDocument::fromJson(packet.mid(pos).toUtf8());
+
+    switch (type)
+    {
+    case 0: // CONNECT
+    {
+        // only from the auth payload: a query string ends up in logs and browser history
+        QString token = doc.object().value("token").toString();
+        if (!TokenMatches(token))
+        {
+            qDebug() << __func__ << __LINE__ << " : " << socket->peerAddress().toString() << " not authorized";
+            socket->sendTextMessage("44{\"message\":\"not authorized\"}");
+            socket->close(QWebSocketProtocol::CloseCodePolicyViolated);
+            return;
+        }
+        client.authorized = true;
+        socket->sendTextMessage("40{\"sid\":\"" + client.sid + "\"}");
+        break;
+    }
+    case 1: // DISCONNECT
+        socket->close();
+        break;
+    case 2: // EVENT
+    case 5: // BINARY_EVENT
+    {
+        if (!client.authorized)
+        {
+            socket->close(QWebSocketProtocol::CloseCodePolicyViolated);
+            return;
+        }
+        QJsonArray args = doc.array();
+        if (args.isEmpty() || !args.at(0).isString())
+        {
+            return;
+        }
+        QString event = args.at(0).toString();
+        message::ptr data = (args.size() > 1) ? ReplyCodec::JsonToMessage(args.at(1)) : message::ptr(null_message::create());
+        ResolvePlaceholders(data, buffers);
+        if (!ackId.isEmpty())
+        {
+            socket->sendTextMessage("43" + ackId + "[]");
+        }
+
+        if (event == "messageToKit" && data->get_flag() == message::flag_object)
+        {
+            m_handler(data, MakeSink(socket));
+        }
+        else
+        {
+            qDebug() << __func__ << __LINE__ << " : unsupported event " << event;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+ReplySink LanServer::MakeSink(QWebSocket *socket)
+{
+    // called from the handler threads, the socket belongs to the main thread
+    QPointer<LanServer> self(this);
+    QPointer<QWebSocket> target(socket);
+    return [self, target](const std::string &event, message::ptr const &data) {
+        if (!self)
+        {
+            return;
+        }
+        QMetaObject::invokeMethod(self.data(), [self, target, event, data]() {
+            if (self && target && self->m_clients.contains(target.data()))
+            {
+                self->Emit(target.data(), event, data);
+            }
+        }, Qt::QueuedConnection);
+    };
+}
+
+void LanServer::Emit(QWebSocket *socket, const std::string &event, message::ptr const &data)
+{
+    Buffers buffers;
+    QJsonArray args;
+    args.append(QString::fromStdString(event));
+    args.append(MessageToJson(data, buffers));
+    QString json = QString::fromUtf8(QJsonDocument(args).toJson(QJsonDocument::Compact));
+
+    if (buffers.empty())
+    {
+        socket->sendTextMessage("42" + json);
+        return;
+    }
+    socket->sendTextMessage("45" + QString::number(buffers.size()) + "-" + json);
+    for (const auto &buffer : buffers)
+    {
+        socket->sendBinaryMessage(QByteArray(buffer->data(), (int)buffer->size()));
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef LAN_SERVER_H
+#define LAN_SERVER_H
+
+#include <QObject>
+#include <QHash>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QWebSocket>
+#include <QWebSocketServer>
+#include <sio_client.h>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "reply_codec.h"
+
+using namespace sio;
+
+// socket.io (Engine.IO v4, websocket transport) endpoint for clients on the kit's LAN.
+// A client connects to 'wss://<kit>:<port>/socket.io/?EIO=4&transport=websocket' with
+// the token in the socket.io auth payload ({ "token": ... }) and then talks the same
+// messageToKit protocol as through the cloud server. Replies and progress events only
+// go back to the connection the request came from.
+// Lives in the main thread.
+class LanServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef std::function<void(message::ptr const &data, const ReplySink &sink)> RequestHandler;
+
+    LanServer(const QString &token, const RequestHandler &handler, QObject *parent = nullptr);
+    ~LanServer();
+
+    // wss with certFile and keyFile; without them the token would travel in clear text,
+    // so plain ws needs 'allowInsecure'
+    bool Listen(quint16 port, const QString &certFile, const QString &keyFile, bool allowInsecure = false);
+
+    // what register_kit announces so that clients can try the LAN first;
+    // 'advertise' overrides the local addresses, e.g. the host's when running in a bridged container
+    message::ptr Endpoint(const QStringList &advertise) const;
+    // the endpoint last returned by Endpoint(), for later register_kit updates; null if none
+    static message::ptr Announced();
+
+private Q_SLOTS:
+    void OnNewConnection();
+    void OnTextMessage(const QString &text);
+    void OnBinaryMessage(const QByteArray &data);
+    void OnDisconnected();
+    void OnPing();
+
+private:
+    typedef std::vector<std::shared_ptr<const std::string>> Buffers;
+
+    struct Client
+    {
+        QString sid;
+        bool authorized = false;
+        QElapsedTimer lastSeen;
+        // binary event waiting for its attachments
+        QString pendingPacket;
+        int pendingAttachments = 0;
+        Buffers pendingBuffers;
+    };
+
+    void HandlePacket(QWebSocket *socket, const QString &packet, const Buffers &buffers);
+    void Emit(QWebSocket *socket, const std::string &event, message::ptr const &data);
+    ReplySink MakeSink(QWebSocket *socket);
+    bool TokenMatches(const QString &token) const;
+
+    QWebSocketServer *m_server = nullptr;
+    QTimer *m_pingTimer;
+    QHash<QWebSocket *, Client> m_clients;
+    QString m_token;
+    RequestHandler m_handler;
+    quint16 m_port = 0;
+    bool m_secure = false;
+};
+
+#endif // LAN_SERVER_H
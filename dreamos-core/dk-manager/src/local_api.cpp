@@ -0,0 +1,361 @@
+#include "local_api.h"
+#include "dapr_utils.h"
+#include "fileutils.h"
+#include "resource_limits.h"
+#include <QDebug>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QRegularExpression>
+#include <QThread>
+#include <QtEndian>
+
+#define kLocalApiMaxFrame (4 * 1024 * 1024)
+// prototypes.json is written in several steps, send one event for all of them
+#define kPrototypesDebounceMs 50
+#define kDockerEventsRestartMs 1000
+
+LocalApi::LocalApi(const QString &socketPath, const QString &prototypesDir, const QString &logDir, QObject *parent)
+    : QObject(parent), m_socketPath(socketPath), m_prototypesFile(prototypesDir + "prototypes.json"),
+      m_prototypesDir(prototypesDir), m_logDir(logDir)
+{
+    m_server = new QLocalServer(this);
+    m_server->setSocketOptions(QLocalServer::UserAccessOption | QLocalServer::GroupAccessOption);
+    connect(m_server, &QLocalServer::newConnection, this, &LocalApi::OnNewConnection);
+
+    m_watcher = new QFileSystemWatcher(this);
+    connect(m_watcher, &QFileSystemWatcher::fileChanged, this, &LocalApi::OnPrototypesFileChanged);
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &LocalApi::OnPrototypesFileChanged);
+
+    m_prototypesDebounce = new QTimer(this);
+    m_prototypesDebounce->setSingleShot(true);
+    connect(m_prototypesDebounce, &QTimer::timeout, this, &LocalApi::BroadcastPrototypes);
+}
+
+LocalApi::~LocalApi()
+{
+    if (m_dockerEvents)
+    {
+        m_dockerEvents->disconnect(this);
+        m_dockerEvents->kill();
+        m_dockerEvents->waitForFinished(1000);
+    }
+    m_server->close();
+}
+
+bool LocalApi::Start()
+{
+    // a socket file left by a previous run would make listen() fail
+    QLocalServer::removeServer(m_socketPath);
+    if (!m_server->listen(m_socketPath))
+    {
+        qDebug() << __func__ << __LINE__ << " : cannot listen on " << m_socketPath << " : " << m_server->errorString();
+        return false;
+    }
+    qDebug() << __func__ << __LINE__ << " : listening on " << m_socketPath;
+
+    WatchPrototypesFile();
+    StartDockerEvents();
+    return true;
+}
+
+void LocalApi::WatchPrototypesFile()
+{
+    // the file may be replaced instead of written, the directory catches that
+    QFileInfo info(m_prototypesFile);
+    if (!m_watcher->directories().contains(info.absolutePath()))
+    {
+        m_watcher->addPath(info.absolutePath());
+    }
+    if (info.exists() && !m_watcher->files().contains(m_prototypesFile))
+    {
+        m_watcher->addPath(m_prototypesFile);
+    }
+}
+
+void LocalApi::StartDockerEvents()
+{
+    m_dockerEvents = new QProcess(this);
+    connect(m_dockerEvents, &QProcess::readyReadStandardOutput, this, &LocalApi::OnDockerEventsOutput);
+    connect(m_dockerEvents, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, &LocalApi::OnDockerEventsFinished);
+    m_dockerEvents->start("docker", QStringList() << "events"
+                                                  << "--filter" << "type=container"
+                                                  << "--filter" << "event=start"
+                                                  << "--filter" << "event=die"
+                                                  << "--filter" << "event=rename"
+                                                  << "--format" << "{{.Action}} {{.Actor.Attributes.name}}");
+
+    // events only tell about changes, take the current state once the stream is running
+    QProcess *ps = new QProcess(this);
+    connect(ps, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, [this, ps]() {
+        QSet<QString> running;
+        for (const QString &name : QString::fromUtf8(ps->readAllStandardOutput()).split('\n', Qt::SkipEmptyParts))
+        {
+            running.insert(name.trimmed());
+        }
+        ps->deleteLater();
+        if (running != m_running)
+        {
+            m_running = running;
+            BroadcastPrototypes();
+        }
+    });
+    ps->start("docker", QStringList() << "ps" << "--format" << "{{.Names}}");
+}
+
+void LocalApi::OnDockerEventsOutput()
+{
+    m_dockerEventsBuffer += m_dockerEvents->readAllStandardOutput();
+    int newline;
+    while ((newline = m_dockerEventsBuffer.indexOf('\n')) >= 0)
+    {
+        QString line = QString::fromUtf8(m_dockerEventsBuffer.left(newline)).trimmed();
+        m_dockerEventsBuffer.remove(0, newline + 1);
+
+        QString action = line.section(' ', 0, 0);
+        QString name = line.section(' ', 1);
+        if (name.isEmpty())
+        {
+            continue;
+        }
+        // a pre-started pool container is renamed to the app it runs (see PrototypePool)
+        bool running = (action == "start" || action == "rename");
+        if (running == m_running.contains(name))
+        {
+            continue;
+        }
+        if (running)
+        {
+            m_running.insert(name);
+        }
+        else
+        {
+            m_running.remove(name);
+        }
+
+        QJsonObject event;
+        event["event"] = "run_state";
+        event["app_id"] = name;
+        event["running"] = running;
+        Broadcast(event);
+    }
+}
+
+void LocalApi::OnDockerEventsFinished()
+{
+    qDebug() << __func__ << __LINE__ << " : docker events stopped, restart";
+    m_dockerEvents->deleteLater();
+    m_dockerEvents = nullptr;
+    m_dockerEventsBuffer.clear();
+    QTimer::singleShot(kDockerEventsRestartMs, this, &LocalApi::StartDockerEvents);
+}
+
+void LocalApi::OnPrototypesFileChanged()
+{
+    WatchPrototypesFile();
+    m_prototypesDebounce->start(kPrototypesDebounceMs);
+}
+
+QJsonArray LocalApi::Prototypes() const
+{
+    QJsonArray list = QJsonDocument::fromJson(FileUtils::ReadFile(m_prototypesFile).toUtf8()).array();
+    for (int i = 0; i < list.size(); i++)
+    {
+        QJsonObject obj = list[i].toObject();
+        obj["running"] = m_running.contains(obj.value("id").toString());
+        list[i] = obj;
+    }
+    return list;
+}
+
+void LocalApi::BroadcastPrototypes()
+{
+    QJsonObject event;
+    event["event"] = "prototypes";
+    event["prototypes"] = Prototypes();
+    Broadcast(event);
+}
+
+void LocalApi::OnNewConnection()
+{
+    while (m_server->hasPendingConnections())
+    {
+        QLocalSocket *socket = m_server->nextPendingConnection();
+        m_clients.insert(socket, QByteArray());
+        connect(socket, &QLocalSocket::readyRead, this, &LocalApi::OnReadyRead);
+        connect(socket, &QLocalSocket::disconnected, this, &LocalApi::OnDisconnected);
+    }
+}
+
+void LocalApi::OnDisconnected()
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket *>(sender());
+    if (socket)
+    {
+        m_clients.remove(socket);
+        socket->deleteLater();
+    }
+}
+
+void LocalApi::OnReadyRead()
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket *>(sender());
+    if (!socket || !m_clients.contains(socket))
+    {
+        return;
+    }
+    m_clients[socket] += socket->readAll();
+
+    while (m_clients.contains(socket) && m_clients[socket].size() >= 4)
+    {
+        QByteArray &buffer = m_clients[socket];
+        quint32 length = qFromBigEndian<quint32>(buffer.constData());
+        if (length > kLocalApiMaxFrame)
+        {
+            qDebug() << __func__ << __LINE__ << " : frame too large, close the connection";
+            socket->abort();
+            return;
+        }
+        if ((quint32)buffer.size() < 4 + length)
+        {
+            return;
+        }
+        QJsonDocument doc = QJsonDocument::fromJson(buffer.mid(4, length));
+        buffer.remove(0, 4 + length);
+        if (doc.isObject())
+        {
+            HandleRequest(socket, doc.object());
+        }
+    }
+}
+
+void LocalApi::HandleRequest(QLocalSocket *socket, const QJsonObject &request)
+{
+    QString cmd = request.value("cmd").toString();
+    QString appId = request.value("app_id").toString();
+    QJsonObject reply;
+    reply["id"] = request.value("id");
+    reply["cmd"] = cmd;
+
+    if (cmd == "list_prototypes")
+    {
+        reply["ok"] = true;
+        reply["prototypes"] = Prototypes();
+        if (request.value("stats").toBool())
+        {
+            QStringList appIds;
+            for (const auto item : reply["prototypes"].toArray())
+            {
+                appIds.append(item.toObject().value("id").toString());
+            }
+            reply["resource_stats"] = ResourceLimits::Stats(appIds);
+        }
+    }
+    else if (cmd == "run_state")
+    {
+        reply["ok"] = !appId.isEmpty();
+        reply["app_id"] = appId;
+        reply["running"] = m_running.contains(appId);
+    }
+    else if ((cmd == "start" || cmd == "stop") && !IsKnownApp(appId))
+    {
+        reply["ok"] = false;
+        reply["app_id"] = appId;
+        reply["error"] = "unknown app_id";
+    }
+    else if (cmd == "start" || cmd == "stop")
+    {
+        RunAppAction(socket, request.value("id"), cmd, appId);
+        return;
+    }
+    else
+    {
+        reply["ok"] = false;
+        reply["error"] = "unknown or incomplete request";
+    }
+    Send(socket, reply);
+}
+
+bool LocalApi::IsKnownApp(const QString &appId) const
+{
+    // the id ends up in docker command lines
+    static const QRegularExpression validId("^[A-Za-z0-9_-]+$");
+    if (!validId.match(appId).hasMatch())
+    {
+        return false;
+    }
+    for (const auto item : Prototypes())
+    {
+        if (item.toObject().value("id").toString() == appId)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void LocalApi::RunAppAction(QLocalSocket *socket, const QJsonValue &id, const QString &cmd, const QString &appId)
+{
+    AppAction action;
+    action.target = socket;
+    action.id = id;
+    action.cmd = cmd;
+    QList<AppAction> &queue = m_appActions[appId];
+    queue.append(action);
+    if (queue.size() == 1)
+    {
+        StartNextAppAction(appId);
+    }
+}
+
+void LocalApi::StartNextAppAction(const QString &appId)
+{
+    // docker run/stop take seconds, the reply follows when they are done;
+    // the run_state event usually arrives before it.
+    // Every worker has its own Dapr_Utils, it keeps per-call state (_last_start_mode).
+    QString cmd = m_appActions[appId].first().cmd;
+    Dapr_Utils *dapr_utils = new Dapr_Utils(QString(), m_prototypesDir, m_logDir);
+    QThread *worker = QThread::create([this, cmd, appId, dapr_utils]() {
+        int rc = (cmd == "start") ? dapr_utils->startApp(appId) : dapr_utils->stopApp(appId);
+        delete dapr_utils;
+        QMetaObject::invokeMethod(this, [this, appId, rc]() {
+            AppAction action = m_appActions[appId].takeFirst();
+            if (m_appActions[appId].isEmpty())
+            {
+                m_appActions.remove(appId);
+            }
+            else
+            {
+                StartNextAppAction(appId);
+            }
+            if (!action.target || !m_clients.contains(action.target.data()))
+            {
+                return;
+            }
+            QJsonObject reply;
+            reply["id"] = action.id;
+            reply["cmd"] = action.cmd;
+            reply["app_id"] = appId;
+            reply["ok"] = (rc == 0);
+            Send(action.target.data(), reply);
+        }, Qt::QueuedConnection);
+    });
+    connect(worker, &QThread::finished, worker, &QObject::deleteLater);
+    worker->start();
+}
+
+void LocalApi::Send(QLocalSocket *socket, const QJsonObject &obj)
+{
+    QByteArray json = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+    char header[4];
+    qToBigEndian<quint32>(json.size(), header);
+    socket->write(header, 4);
+    socket->write(json);
+}
+
+void LocalApi::Broadcast(const QJsonObject &obj)
+{
+    for (auto it = m_clients.begin(); it != m_clients.end(); ++it)
+    {
+        Send(it.key(), obj);
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef LOCAL_API_H
+#define LOCAL_API_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QTimer>
+#include <QProcess>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QFileSystemWatcher>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QPointer>
+
+// Unix domain socket API for consumers on the kit (dk_ivi, ...), so they do not have to
+// watch prototypes.json and poll 'docker ps'.
+// Framing: every message is a 4 byte big-endian length followed by that many bytes of JSON.
+// Requests:  { "id": 1, "cmd": "list_prototypes" | "run_state" | "start" | "stop", "app_id": "..." }
+// Replies:   { "id": 1, "ok": true, ... } (same id, in any order)
+// Events, pushed to every connection:
+//            { "event": "prototypes", "prototypes": [ { id, name, lastDeploy, running, ... } ] }
+//            { "event": "run_state", "app_id": "...", "running": true }
+// Lives in the main thread.
+class LocalApi : public QObject
+{
+    Q_OBJECT
+
+public:
+    LocalApi(const QString &socketPath, const QString &prototypesDir, const QString &logDir, QObject *parent = nullptr);
+    ~LocalApi();
+
+    bool Start();
+
+private Q_SLOTS:
+    void OnNewConnection();
+    void OnReadyRead();
+    void OnDisconnected();
+    void OnPrototypesFileChanged();
+    void OnDockerEventsOutput();
+    void OnDockerEventsFinished();
+    void BroadcastPrototypes();
+
+private:
+    void HandleRequest(QLocalSocket *socket, const QJsonObject &request);
+    void RunAppAction(QLocalSocket *socket, const QJsonValue &id, const QString &cmd, const QString &appId);
+    void StartNextAppAction(const QString &appId);
+    bool IsKnownApp(const QString &appId) const;
+    void Send(QLocalSocket *socket, const QJsonObject &obj);
+    void Broadcast(const QJsonObject &obj);
+    QJsonArray Prototypes() const;
+    void StartDockerEvents();
+    void WatchPrototypesFile();
+
+    QString m_socketPath;
+    QString m_prototypesFile;
+    QLocalServer *m_server;
+    QHash<QLocalSocket *, QByteArray> m_clients;   // with their unparsed input
+    QFileSystemWatcher *m_watcher;
+    QTimer *m_prototypesDebounce;
+    QProcess *m_dockerEvents = nullptr;
+    QByteArray m_dockerEventsBuffer;
+    QSet<QString> m_running;
+    QString m_prototypesDir;
+    QString m_logDir;
+
+    struct AppAction
+    {
+        QPointer<QLocalSocket> target;
+        QJsonValue id;
+        QString cmd;
+    };
+    // start/stop of one app run one after the other, the first entry is running
+    QHash<QString, QList<AppAction>> m_appActions;
+};
+
+#endif // LOCAL_API_H
@@ -0,0 +1,283 @@
+#include "log_uploader.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <zstd.h>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <stdio.h>
+#include <vector>
+
+#define kUploadChunkSize (32 * 1024)
+#define kUploadAckTimeoutMs 10000
+// give up if the server does not come back
+#define kUploadMaxPauseMs (30 * 60 * 1000)
+#define kUploadCompressionLevel 9
+
+LogUploader::LogUploader(client *io, const QString &uploadId, const QString &rootDir, const QStringList &paths,
+                         const QString &spoolDir, qint64 offset, int maxRateKbps)
+    : m_io(io), m_uploadId(uploadId), m_rootDir(rootDir), m_paths(paths),
+      m_spoolFile(QDir(spoolDir).filePath(uploadId + ".tar.zst")), m_maxRateKbps(maxRateKbps), m_offset(offset)
+{
+    QDir().mkpath(spoolDir);
+}
+
+LogUploader::~LogUploader()
+{
+    Cancel();
+    wait();
+}
+
+QString LogUploader::UploadId() const
+{
+    return m_uploadId;
+}
+
+void LogUploader::Resume(qint64 offset)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    if (offset >= 0)
+        m_offset = offset;
+    m_resume = true;
+    m_cv.notify_all();
+}
+
+void LogUploader::Cancel()
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_cancel = true;
+    m_cv.notify_all();
+}
+
+void LogUploader::Compress()
+{
+    // a finished spool from an earlier attempt (e.g. before a restart) is sent as it is,
+    // so the offsets the server already has stay valid
+    if (QFile::exists(m_spoolFile + ".done"))
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_spooled = QFileInfo(m_spoolFile).size();
+        m_spoolDone = true;
+        m_cv.notify_all();
+        return;
+    }
+
+    {
+        // a new archive does not match what the server received before
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_offset = 0;
+    }
+
+    // '--': a file matched by a wildcard may start with '-' as well
+    std::string cmd = "cd " + m_rootDir.toStdString() + " && tar -cf - -- " + m_paths.join(" ").toStdString() + " 2>/dev/null";
+    qDebug() << __func__ << __LINE__ << " cmd : " << QString::fromStdString(cmd);
+    FILE *tar = popen(cmd.c_str(), "r");
+    QFile spool(m_spoolFile);
+    if (!tar || !spool.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        if (tar)
+            pclose(tar);
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_spoolFailed = true;
+        m_cv.notify_all();
+        return;
+    }
+
+    ZSTD_CCtx *cctx = ZSTD_createCCtx();
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, kUploadCompressionLevel);
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 1);
+    std::vector<char> inBuf(ZSTD_CStreamInSize());
+    std::vector<char> outBuf(ZSTD_CStreamOutSize());
+
+    bool ok = true;
+    bool eof = false;
+    while (ok && !eof)
+    {
+        size_t n = fread(inBuf.data(), 1, inBuf.size(), tar);
+        eof = (n < inBuf.size());
+        ZSTD_EndDirective mode = eof ? ZSTD_e_end : ZSTD_e_continue;
+        ZSTD_inBuffer in = {inBuf.data(), n, 0};
+        size_t remaining = 0;
+        do
+        {
+            ZSTD_outBuffer out = {outBuf.data(), outBuf.size(), 0};
+            remaining = ZSTD_compressStream2(cctx, &out, &in, mode);
+            if (ZSTD_isError(remaining) || spool.write(outBuf.data(), out.pos) != (qint64)out.pos)
+            {
+                ok = false;
+                break;
+            }
+            if (out.pos > 0)
+            {
+                // publish what can already be sent
+                spool.flush();
+                std::lock_guard<std::mutex> lock(m_mtx);
+                m_spooled += out.pos;
+                m_cv.notify_all();
+            }
+        } while (eof ? (remaining != 0) : (in.pos < in.size));
+
+        std::lock_guard<std::mutex> lock(m_mtx);
+        if (m_cancel)
+            ok = false;
+    }
+    ZSTD_freeCCtx(cctx);
+    pclose(tar);
+    spool.close();
+
+    if (ok)
+    {
+        QFile marker(m_spoolFile + ".done");
+        marker.open(QIODevice::WriteOnly);
+    }
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_spoolDone = ok;
+    m_spoolFailed = !ok;
+    m_cv.notify_all();
+}
+
+namespace {
+struct ChunkAck
+{
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool done = false;
+    bool ok = false;
+    qint64 offset = -1;
+};
+}
+
+bool LogUploader::SendChunk(qint64 offset, const std::string &data, bool final, qint64 &nextOffset)
+{
+    message::ptr obj = object_message::create();
+    obj->get_map()["upload_id"] = string_message::create(m_uploadId.toStdString());
+    obj->get_map()["filename"] = string_message::create(QFileInfo(m_spoolFile).fileName().toStdString());
+    obj->get_map()["encoding"] = string_message::create("tar+zstd");
+    obj->get_map()["offset"] = int_message::create(offset);
+    obj->get_map()["final"] = bool_message::create(final);
+    obj->get_map()["data"] = binary_message::create(std::make_shared<const std::string>(data));
+
+    // the ack may arrive after this upload gave up on it
+    auto ack = std::make_shared<ChunkAck>();
+    m_io->socket()->emit("dk_uploadFile-chunk", obj, [ack](message::list const &resp) {
+        std::lock_guard<std::mutex> lock(ack->mtx);
+        ack->done = true;
+        ack->ok = true;
+        if (resp.size() > 0 && resp[0]->get_flag() == message::flag_object)
+        {
+            // the server may ask for a different offset, e.g. after it lost data
+            message::ptr next = resp[0]->get_map()["offset"];
+            if (next && next->get_flag() == message::flag_integer)
+                ack->offset = next->get_int();
+            message::ptr result = resp[0]->get_map()["ok"];
+            if (result && result->get_flag() == message::flag_boolean)
+                ack->ok = result->get_bool();
+        }
+        ack->cv.notify_all();
+    });
+
+    std::unique_lock<std::mutex> lock(ack->mtx);
+    if (!ack->cv.wait_for(lock, std::chrono::milliseconds(kUploadAckTimeoutMs), [ack]() { return ack->done; }))
+        return false;
+    nextOffset = (ack->offset >= 0) ? ack->offset : ((ack->ok) ? offset + (qint64)data.size() : offset);
+    return ack->ok;
+}
+
+void LogUploader::SendResult(bool ok, const QString &log)
+{
+    message::ptr obj = object_message::create();
+    obj->get_map()["upload_id"] = string_message::create(m_uploadId.toStdString());
+    obj->get_map()["result"] = bool_message::create(ok);
+    obj->get_map()["size"] = int_message::create(m_spooled);
+    obj->get_map()["log"] = string_message::create(log.toStdString());
+    m_io->socket()->emit("dk_uploadFile-result", obj);
+}
+
+void LogUploader::run()
+{
+    qDebug() << __func__ << __LINE__ << " : upload " << m_uploadId << " from offset " << m_offset;
+
+    std::thread compressor(&LogUploader::Compress, this);
+
+    QFile spool(m_spoolFile);
+    qint64 bytesPerSec = (qint64)m_maxRateKbps * 1024;
+    qint64 sentSinceStart = 0;
+    auto start = std::chrono::steady_clock::now();
+    bool ok = false;
+    QString log;
+
+    std::unique_lock<std::mutex> lock(m_mtx);
+    while (true)
+    {
+        m_cv.wait(lock, [this]() { return m_cancel || m_spoolFailed || m_spoolDone || (m_spooled - m_offset >= kUploadChunkSize); });
+        if (m_cancel || m_spoolFailed)
+        {
+            log = m_cancel ? "cancelled" : "cannot create the log archive";
+            break;
+        }
+        if (m_spoolDone && m_offset >= m_spooled)
+        {
+            ok = true;
+            log = "uploaded " + QString::number(m_spooled) + " bytes";
+            break;
+        }
+
+        qint64 offset = m_offset;
+        qint64 length = qMin<qint64>(kUploadChunkSize, m_spooled - offset);
+        bool final = m_spoolDone && (offset + length == m_spooled);
+        m_resume = false;
+        lock.unlock();
+
+        std::string data;
+        if (spool.isOpen() || spool.open(QIODevice::ReadOnly))
+        {
+            spool.seek(offset);
+            QByteArray bytes = spool.read(length);
+            data.assign(bytes.constData(), bytes.size());
+        }
+
+        // pace the chunks to the configured rate
+        if (bytesPerSec > 0)
+        {
+            auto due = start + std::chrono::milliseconds(sentSinceStart * 1000 / bytesPerSec);
+            std::this_thread::sleep_until(due);
+        }
+
+        qint64 nextOffset = offset;
+        bool acked = !data.empty() && SendChunk(offset, data, final, nextOffset);
+        sentSinceStart += data.size();
+
+        lock.lock();
+        if (acked)
+        {
+            m_offset = nextOffset;
+            continue;
+        }
+
+        // no ack: the connection is probably gone, wait for Resume()
+        qDebug() << __func__ << __LINE__ << " : upload " << m_uploadId << " paused at offset " << m_offset;
+        if (!m_cv.wait_for(lock, std::chrono::milliseconds(kUploadMaxPauseMs), [this]() { return m_resume || m_cancel; }))
+        {
+            log = "no connection, upload stopped at offset " + QString::number(m_offset);
+            break;
+        }
+        // restart pacing after the pause
+        start = std::chrono::steady_clock::now();
+        sentSinceStart = 0;
+    }
+    if (!ok)
+        m_cancel = true;
+    lock.unlock();
+
+    compressor.join();
+    spool.close();
+    if (ok)
+    {
+        QFile::remove(m_spoolFile);
+        QFile::remove(m_spoolFile + ".done");
+    }
+    qDebug() << __func__ << __LINE__ << " : upload " << m_uploadId << " : " << log;
+    SendResult(ok, log);
+}
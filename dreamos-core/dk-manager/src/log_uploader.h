@@ -0,0 +1,55 @@
+#ifndef LOG_UPLOADER_H
+#define LOG_UPLOADER_H
+
+#include <QObject>
+#include <QThread>
+#include <QStringList>
+#include <sio_client.h>
+#include <condition_variable>
+#include <mutex>
+
+using namespace sio;
+
+// Uploads kit logs as a zstd compressed tarball over the socket.io connection.
+// 'paths' (relative to rootDir) are tar'ed and compressed into '<spoolDir>/<uploadId>.tar.zst'
+// while the already compressed part is sent as 'dk_uploadFile-chunk' events. Every chunk
+// waits for the server's ack; without an ack the upload pauses and continues from the
+// last acknowledged offset after Resume(), e.g. when the socket is connected again.
+// The upload rate is capped so that chunks never crowd out other events on the socket.
+class LogUploader : public QThread
+{
+    Q_OBJECT
+    void run() override;
+
+public:
+    LogUploader(client *io, const QString &uploadId, const QString &rootDir, const QStringList &paths,
+                const QString &spoolDir, qint64 offset, int maxRateKbps);
+    ~LogUploader();
+
+    QString UploadId() const;
+    void Resume(qint64 offset = -1);
+    void Cancel();
+
+private:
+    void Compress();
+    bool SendChunk(qint64 offset, const std::string &data, bool final, qint64 &nextOffset);
+    void SendResult(bool ok, const QString &log);
+
+    client *m_io;
+    QString m_uploadId;
+    QString m_rootDir;
+    QStringList m_paths;
+    QString m_spoolFile;
+    int m_maxRateKbps;
+
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+    qint64 m_offset;        // acknowledged by the server
+    qint64 m_spooled = 0;   // compressed bytes written to the spool file
+    bool m_spoolDone = false;
+    bool m_spoolFailed = false;
+    bool m_resume = false;
+    bool m_cancel = false;
+};
+
+#endif // LOG_UPLOADER_H
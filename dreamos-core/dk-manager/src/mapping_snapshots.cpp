@@ -0,0 +1,308 @@
+#include "mapping_snapshots.h"
+#include "fileutils.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <algorithm>
+#include <stdio.h>
+#include <unistd.h>
+
+#define kMaxMappingSnapshots 10
+#define kFactoryVersion "factory"
+
+static QMutex snapshotsMutex;
+static QString snapshotsRoot;
+static QList<QPair<QString, QString>> snapshotFiles;
+static QStringList copiedFiles;
+// version of a Begin without Commit/Rollback yet
+static QString pendingVersion;
+
+static int VersionNumber(const QString &version)
+{
+    return version.startsWith('v') ? version.mid(1).toInt() : -1;
+}
+
+static void CopyVersion(const QString &from, const QString &to)
+{
+    QDir().mkpath(snapshotsRoot + to);
+    for (const auto &file : snapshotFiles)
+    {
+        QString source = snapshotsRoot + from + "/" + file.first;
+        if (QFile::exists(source))
+        {
+            QFile::copy(source, snapshotsRoot + to + "/" + file.first);
+        }
+    }
+}
+
+// in place: a container which mounts the file keeps seeing it
+static bool CopyInPlace(const QString &from, const QString &to)
+{
+    QFile source(from);
+    QFile target(to);
+    if (!source.open(QIODevice::ReadOnly) || !target.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qDebug() << __func__ << __LINE__ << " : cannot copy " << from << " to " << to;
+        return false;
+    }
+    return target.write(source.readAll()) == source.size();
+}
+
+static bool SameContent(const QString &a, const QString &b)
+{
+    QFile fileA(a);
+    QFile fileB(b);
+    return fileA.open(QIODevice::ReadOnly) && fileB.open(QIODevice::ReadOnly) && fileA.readAll() == fileB.readAll();
+}
+
+static QString LinkTarget(const QString &link)
+{
+    return QFileInfo(snapshotsRoot + link).symLinkTarget().section('/', -1);
+}
+
+bool MappingSnapshots::SwapLink(const QString &link, const QString &target)
+{
+    // a new link next to the old one, renamed over it: readers see either the old or the new target
+    QString tmp = link + ".tmp";
+    ::unlink(tmp.toUtf8().constData());
+    if (::symlink(target.toUtf8().constData(), tmp.toUtf8().constData()) != 0 ||
+        ::rename(tmp.toUtf8().constData(), link.toUtf8().constData()) != 0)
+    {
+        qDebug() << __func__ << __LINE__ << " : cannot link " << link << " -> " << target;
+        return false;
+    }
+    return true;
+}
+
+void MappingSnapshots::RestoreCopies(const QString &version)
+{
+    for (const auto &file : snapshotFiles)
+    {
+        QString source = snapshotsRoot + version + "/" + file.first;
+        if (copiedFiles.contains(file.first) && QFile::exists(source))
+        {
+            CopyInPlace(source, file.second);
+        }
+    }
+}
+
+void MappingSnapshots::StoreCopies(const QString &version)
+{
+    for (const auto &file : snapshotFiles)
+    {
+        if (copiedFiles.contains(file.first) && QFile::exists(file.second))
+        {
+            QString target = snapshotsRoot + version + "/" + file.first;
+            QFile::remove(target);
+            QFile::copy(file.second, target);
+        }
+    }
+}
+
+void MappingSnapshots::Init(const QString &root, const QList<QPair<QString, QString>> &files, const QStringList &copied,
+                            const QHash<QString, QString> &factoryContent)
+{
+    QMutexLocker locker(&snapshotsMutex);
+    snapshotsRoot = root;
+    snapshotFiles = files;
+    copiedFiles = copied;
+    QDir().mkpath(root);
+
+    if (!QFileInfo::exists(root + kFactoryVersion))
+    {
+        QDir().mkpath(root + kFactoryVersion);
+        for (auto it = factoryContent.begin(); it != factoryContent.end(); ++it)
+        {
+            FileUtils::WriteFile(root + kFactoryVersion + "/" + it.key(), it.value());
+        }
+    }
+
+    // files which are not links yet (first start, or replaced by someone) and copies which
+    // differ from the current version go into a new version
+    bool adopt = !QFileInfo(root + "current").isSymLink();
+    for (const auto &file : files)
+    {
+        QFileInfo live(file.second);
+        if (copied.contains(file.first))
+        {
+            adopt = adopt || (live.exists() && !live.isSymLink() && !SameContent(file.second, root + "current/" + file.first));
+        }
+        else
+        {
+            adopt = adopt || !live.isSymLink();
+        }
+    }
+    if (adopt)
+    {
+        QString version = NextVersion();
+        QString current = LinkTarget("current");
+        CopyVersion(current.isEmpty() ? QString(kFactoryVersion) : current, version);
+        for (const auto &file : files)
+        {
+            QFileInfo live(file.second);
+            if (live.exists() && !live.isSymLink())
+            {
+                QString target = root + version + "/" + file.first;
+                QFile::remove(target);
+                QFile::copy(file.second, target);
+            }
+        }
+        SwapLink(root + "current", version);
+        SwapLink(root + "last_good", version);
+        qDebug() << __func__ << __LINE__ << " : adopted the mapping state as " << version;
+    }
+
+    for (const auto &file : files)
+    {
+        QFileInfo live(file.second);
+        if (copied.contains(file.first))
+        {
+            // a link of an earlier version of this class becomes a real file again
+            if (live.isSymLink())
+            {
+                QFile::remove(file.second);
+            }
+        }
+        else if (!live.isSymLink())
+        {
+            QString target = QDir(live.absolutePath()).relativeFilePath(root + "current/" + file.first);
+            SwapLink(file.second, target);
+        }
+    }
+    RestoreCopies(LinkTarget("current"));
+}
+
+QString MappingSnapshots::NextVersion()
+{
+    int next = 1;
+    for (const QString &version : QDir(snapshotsRoot).entryList(QStringList() << "v*", QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+        next = qMax(next, VersionNumber(version) + 1);
+    }
+    return "v" + QString::number(next);
+}
+
+QString MappingSnapshots::Begin(const QString &from)
+{
+    QMutexLocker locker(&snapshotsMutex);
+    QString source = from.isEmpty() ? LinkTarget("current") : from;
+    QString version = NextVersion();
+    CopyVersion(source, version);
+    SwapLink(snapshotsRoot + "current", version);
+    RestoreCopies(version);
+    pendingVersion = version;
+    qDebug() << __func__ << __LINE__ << " : " << version << " from " << source;
+    return version;
+}
+
+void MappingSnapshots::Commit()
+{
+    QMutexLocker locker(&snapshotsMutex);
+    if (pendingVersion.isEmpty())
+    {
+        return;
+    }
+    StoreCopies(pendingVersion);
+    SwapLink(snapshotsRoot + "last_good", pendingVersion);
+    qDebug() << __func__ << __LINE__ << " : " << pendingVersion;
+    pendingVersion.clear();
+    Prune();
+}
+
+void MappingSnapshots::Rollback()
+{
+    QMutexLocker locker(&snapshotsMutex);
+    if (pendingVersion.isEmpty())
+    {
+        return;
+    }
+    SwapLink(snapshotsRoot + "current", LinkTarget("last_good"));
+    RestoreCopies(LinkTarget("last_good"));
+    QDir(snapshotsRoot + pendingVersion).removeRecursively();
+    qDebug() << __func__ << __LINE__ << " : dropped " << pendingVersion << ", back to " << LinkTarget("last_good");
+    pendingVersion.clear();
+}
+
+bool MappingSnapshots::SwitchTo(const QString &version)
+{
+    QMutexLocker locker(&snapshotsMutex);
+    if (version.isEmpty() || version.contains('/') || !QFileInfo(snapshotsRoot + version).isDir() || !pendingVersion.isEmpty())
+    {
+        return false;
+    }
+    if (!SwapLink(snapshotsRoot + "current", version) || !SwapLink(snapshotsRoot + "last_good", version))
+    {
+        return false;
+    }
+    RestoreCopies(version);
+    return true;
+}
+
+QString MappingSnapshots::Current()
+{
+    QMutexLocker locker(&snapshotsMutex);
+    return LinkTarget("current");
+}
+
+QString MappingSnapshots::LastGood()
+{
+    QMutexLocker locker(&snapshotsMutex);
+    return LinkTarget("last_good");
+}
+
+QStringList MappingSnapshots::Versions()
+{
+    QStringList versions = QDir(snapshotsRoot).entryList(QStringList() << "v*", QDir::Dirs | QDir::NoDotAndDotDot);
+    std::sort(versions.begin(), versions.end(), [](const QString &a, const QString &b) { return VersionNumber(a) < VersionNumber(b); });
+    return versions;
+}
+
+QString MappingSnapshots::Previous()
+{
+    QMutexLocker locker(&snapshotsMutex);
+    int lastGood = VersionNumber(LinkTarget("last_good"));
+    QString previous;
+    for (const QString &version : Versions())
+    {
+        if (VersionNumber(version) < lastGood && version != pendingVersion)
+        {
+            previous = version;
+        }
+    }
+    return previous;
+}
+
+void MappingSnapshots::CompleteFactory()
+{
+    QMutexLocker locker(&snapshotsMutex);
+    QString current = LinkTarget("current");
+    for (const auto &file : snapshotFiles)
+    {
+        QString target = snapshotsRoot + kFactoryVersion + "/" + file.first;
+        if (!QFile::exists(target))
+        {
+            QFile::copy(snapshotsRoot + current + "/" + file.first, target);
+        }
+    }
+}
+
+bool MappingSnapshots::FactoryHas(const QString &name)
+{
+    return QFile::exists(snapshotsRoot + kFactoryVersion + "/" + name);
+}
+
+void MappingSnapshots::Prune()
+{
+    QStringList versions = Versions();
+    QString current = LinkTarget("current");
+    QString lastGood = LinkTarget("last_good");
+    for (int i = 0; i < versions.size() - kMaxMappingSnapshots; i++)
+    {
+        if (versions[i] != current && versions[i] != lastGood)
+        {
+            QDir(snapshotsRoot + versions[i]).removeRecursively();
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef MAPPING_SNAPSHOTS_H
+#define MAPPING_SNAPSHOTS_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QPair>
+#include <QHash>
+
+// Versioned vss mapping state (overlay, dbc list, default values, vss.json, feeder scripts,
+// supported api list, deploy config). Every version is a directory <root>/v<N>; the live
+// paths are relative symlinks to <root>/current/<name> and <root>/current is a symlink to
+// one version, switched with rename(2). A change runs on a fresh copy (Begin), which becomes
+// the last known good state on Commit or is dropped on Rollback; committed versions are not
+// written again. <root>/factory holds the initial state.
+// Files other containers mount without the snapshot tree (vss.json) stay real files instead:
+// they are written in place from the version on every switch, and Commit stores them into it.
+class MappingSnapshots
+{
+public:
+    // files: name in the snapshot -> live path; copied: names of files kept as real files;
+    // factoryContent: initial content per name
+    static void Init(const QString &root, const QList<QPair<QString, QString>> &files, const QStringList &copied,
+                     const QHash<QString, QString> &factoryContent);
+
+    // copy of the current (or the given) version, made current
+    static QString Begin(const QString &from = QString());
+    // the version of Begin becomes the last known good one
+    static void Commit();
+    // back to the last known good version, the one of Begin is removed
+    static void Rollback();
+    // current and last known good to a committed version, no copy
+    static bool SwitchTo(const QString &version);
+
+    static QString Current();
+    static QString LastGood();
+    // the committed version before the last known good one
+    static QString Previous();
+    static QStringList Versions();
+    // copies files the factory version does not have yet (vss.json is generated on the first reset)
+    static void CompleteFactory();
+    static bool FactoryHas(const QString &name);
+
+private:
+    static QString NextVersion();
+    static bool SwapLink(const QString &link, const QString &target);
+    // copied files: from the version to the live path, and back on Commit
+    static void RestoreCopies(const QString &version);
+    static void StoreCopies(const QString &version);
+    static void Prune();
+};
+
+#endif // MAPPING_SNAPSHOTS_H
@@ -1,4 +1,9 @@
 #include "message_to_kit_handler.h"
+#include "lan_server.h"
+#include "prototype_pool.h"
+#include "resource_limits.h"
+#include "vss_mapping_validator.h"
+#include "mapping_snapshots.h"
 #include "fileutils.h"
 #include "common_utils.h"
 #include <QFile>
@@ -7,6 +12,7 @@
 #include <QCryptographicHash>
 #include <QMutex>
 #include <QFileInfo>
+#include <QElapsedTimer>
 #include <QtNetwork>
 
 #include <QJsonDocument>
@@ -43,9 +49,55 @@ extern QMutex digitalAutoPrototypeMutex;
 extern QMutex vssMappingMutex;
 extern QMutex vssMappingFactoryResetMutex;
 
+// handlers with a request_id, for cancel_request; ids are only unique per client,
+// so the key is (request_from, request_id)
+typedef std::pair<std::string, std::string> RequestKey;
+static QMutex runningHandlersMutex;
+static QMap<RequestKey, MessageToKitHandler *> runningHandlers;
+
+static std::string RequestFromOf(message::ptr const &data)
+{
+    if (data && data->get_flag() == message::flag_object)
+    {
+        message::ptr from = data->get_map()["request_from"];
+        if (from && from->get_flag() == message::flag_string)
+            return from->get_string();
+    }
+    return std::string();
+}
+
+static std::string RequestIdOf(message::ptr const &data)
+{
+    if (data && data->get_flag() == message::flag_object)
+    {
+        message::ptr id = data->get_map()["request_id"];
+        if (id && id->get_flag() == message::flag_string)
+            return id->get_string();
+        if (id && id->get_flag() == message::flag_integer)
+            return std::to_string(id->get_int());
+    }
+    return std::string();
+}
+
 MessageToKitHandler::MessageToKitHandler(client *_io, message::ptr const &data, DkOrchestrator *orchestrator)
 {
     m_data = data;
+    m_requestFrom = RequestFromOf(data);
+    m_requestId = RequestIdOf(data);
+    if (!m_requestId.empty())
+    {
+        QMutexLocker locker(&runningHandlersMutex);
+        RequestKey key(m_requestFrom, m_requestId);
+        if (runningHandlers.contains(key))
+        {
+            // the first one keeps the id, this one is refused in run()
+            m_duplicateId = true;
+        }
+        else
+        {
+            runningHandlers.insert(key, this);
+        }
+    }
     m_io = _io;
     m_orchestrator = orchestrator;
     m_proto_utils = new Prototype_Utils(QString::fromStdString(DK_PROTOTYPES_FOLDER));
@@ -69,10 +121,127 @@ MessageToKitHandler::MessageToKitHandler(client *_io, message::ptr const &data,
 MessageToKitHandler::~MessageToKitHandler()
 {
     qDebug() << __func__ << __LINE__ << " : exit the thread !!!";
+    if (!m_requestId.empty())
+    {
+        QMutexLocker locker(&runningHandlersMutex);
+        RequestKey key(m_requestFrom, m_requestId);
+        if (runningHandlers.value(key) == this)
+        {
+            runningHandlers.remove(key);
+        }
+    }
     delete m_dapr_utils;
     delete m_proto_utils;
 }
 
+bool MessageToKitHandler::CancelRequest(const std::string &requestFrom, const std::string &requestId)
+{
+    QMutexLocker locker(&runningHandlersMutex);
+    MessageToKitHandler *handler = runningHandlers.value(RequestKey(requestFrom, requestId), nullptr);
+    if (!handler)
+    {
+        return false;
+    }
+    handler->m_cancelled = true;
+    return true;
+}
+
+void MessageToKitHandler::SetReplySink(const ReplySink &sink)
+{
+    m_replySink = sink;
+}
+
+ReplyCodec::Format MessageToKitHandler::ReplyFormat(message::ptr const &request) const
+{
+    // requests with a reply sink did not come through the server
+    return ReplyCodec::FromRequest(request, !m_replySink);
+}
+
+bool MessageToKitHandler::IsCancelled() const
+{
+    return m_cancelled;
+}
+
+bool MessageToKitHandler::LockUnlessCancelled(QMutex &mutex)
+{
+    // requests of the same kind are queued on the mutex; a queued one can still be cancelled
+    while (!mutex.tryLock(200))
+    {
+        if (IsCancelled())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void MessageToKitHandler::SendReply(message::ptr const &reply)
+{
+    message::ptr requestId = m_data->get_map()["request_id"];
+    if (requestId)
+    {
+        reply->get_map()["request_id"] = requestId;
+    }
+    if (IsCancelled())
+    {
+        reply->get_map()["cancelled"] = bool_message::create(true);
+    }
+    if (m_replySink)
+    {
+        m_replySink("messageToKit-kitReply", reply);
+        return;
+    }
+    m_io->socket()->emit("messageToKit-kitReply", reply);
+}
+
+void MessageToKitHandler::SendProgress(const std::string &stage, int percent)
+{
+    message::ptr Obj = object_message::create();
+    Obj->get_map()["request_from"] = string_message::create(m_data->get_map()["request_from"]->get_string());
+    Obj->get_map()["cmd"] = string_message::create(m_data->get_map()["cmd"]->get_string());
+    message::ptr requestId = m_data->get_map()["request_id"];
+    if (requestId)
+    {
+        Obj->get_map()["request_id"] = requestId;
+    }
+    Obj->get_map()["stage"] = string_message::create(stage);
+    Obj->get_map()["percent"] = int_message::create(percent);
+    if (m_replySink)
+    {
+        m_replySink("messageToKit-kitProgress", Obj);
+        return;
+    }
+    m_io->socket()->emit("messageToKit-kitProgress", Obj);
+}
+
+void MessageToKitHandler::HandleCancelRequest(message::ptr const &data)
+{
+    std::string request_from = data->get_map()["request_from"]->get_string();
+    std::string command = data->get_map()["cmd"]->get_string();
+    // { "cmd": "cancel_request", "cancel_id": <request_id of the request to cancel> }
+    std::string target;
+    message::ptr cancelId = data->get_map()["cancel_id"];
+    if (cancelId && cancelId->get_flag() == message::flag_string)
+    {
+        target = cancelId->get_string();
+    }
+    else if (cancelId && cancelId->get_flag() == message::flag_integer)
+    {
+        target = std::to_string(cancelId->get_int());
+    }
+
+    // only the client which sent a request can cancel it
+    bool found = !target.empty() && CancelRequest(request_from, target);
+    qDebug() << __func__ << __LINE__ << " : cancel " << QString::fromStdString(target) << " found = " << found;
+
+    message::ptr Obj = object_message::create();
+    Obj->get_map()["request_from"] = string_message::create(request_from);
+    Obj->get_map()["cmd"] = string_message::create(command);
+    Obj->get_map()["cancel_id"] = string_message::create(target);
+    Obj->get_map()["result"] = bool_message::create(found);
+    SendReply(Obj);
+}
+
 void MessageToKitHandler::AraDeploymentHandler(message::ptr const &data)
 {
     digitalAutoPrototypeMutex.lock();
@@ -145,7 +314,7 @@ void MessageToKitHandler::AraDeploymentHandler(message::ptr const &data)
         Obj->get_map()["result"] = string_message::create("failed");
     }
 
-    m_io->socket()->emit("messageToKit-kitReply", Obj);
+    SendReply(Obj);
 
     std::string cmd = "chmod 777 -R " + idFolder;
     system(cmd.c_str());
@@ -155,8 +324,16 @@ void MessageToKitHandler::AraDeploymentHandler(message::ptr const &data)
 
 void MessageToKitHandler::DeploymentHandler(message::ptr const &data)
 {
-    digitalAutoPrototypeMutex.lock();
     std::string request_cmd = data->get_map()["cmd"]->get_string();
+    if (!LockUnlessCancelled(digitalAutoPrototypeMutex))
+    {
+        message::ptr Obj = object_message::create();
+        Obj->get_map()["request_from"] = string_message::create(data->get_map()["request_from"]->get_string());
+        Obj->get_map()["cmd"] = string_message::create(request_cmd);
+        Obj->get_map()["result"] = string_message::create("fail");
+        SendReply(Obj);
+        return;
+    }
     std::string code = data->get_map()["code"]->get_string();
     message::ptr obj = data->get_map()["prototype"];
     std::string name = obj->get_map()["name"]->get_string();
@@ -194,7 +371,7 @@ void MessageToKitHandler::DeploymentHandler(message::ptr const &data)
         Obj->get_map()["request_from"] = string_message::create(request_from);
         Obj->get_map()["cmd"] = string_message::create(request_cmd);
         Obj->get_map()["result"] = string_message::create("fail");
-        m_io->socket()->emit("messageToKit-kitReply", Obj);
+        SendReply(Obj);
         digitalAutoPrototypeMutex.unlock();
         return;
     }
@@ -220,14 +397,19 @@ void MessageToKitHandler::DeploymentHandler(message::ptr const &data)
         Obj->get_map()["request_from"] = string_message::create(request_from);
         Obj->get_map()["cmd"] = string_message::create(request_cmd);
         Obj->get_map()["result"] = string_message::create("fail");
-        m_io->socket()->emit("messageToKit-kitReply", Obj);
+        SendReply(Obj);
         digitalAutoPrototypeMutex.unlock();
         return;
     }
 
-    if (is_run_after_deploy)
+    SendProgress("deployed", 50);
+    qint64 startLatencyMs = -1;
+    if (is_run_after_deploy && !IsCancelled())
     {
+        QElapsedTimer startTimer;
+        startTimer.start();
         this->m_dapr_utils->startApp(QString::fromStdString(id));
+        startLatencyMs = startTimer.elapsed();
     }
 
     std::string request_from = m_data->get_map()["request_from"]->get_string();
@@ -235,7 +417,12 @@ void MessageToKitHandler::DeploymentHandler(message::ptr const &data)
     Obj->get_map()["request_from"] = string_message::create(request_from);
     Obj->get_map()["cmd"] = string_message::create(request_cmd);
     Obj->get_map()["result"] = string_message::create("success");
-    m_io->socket()->emit("messageToKit-kitReply", Obj);
+    if (startLatencyMs >= 0)
+    {
+        Obj->get_map()["start_latency_ms"] = int_message::create(startLatencyMs);
+        Obj->get_map()["start_mode"] = string_message::create(this->m_dapr_utils->lastStartMode().toStdString());
+    }
+    SendReply(Obj);
 
     std::string cmd = "chmod 777 -R " + idFolder;
     system(cmd.c_str());
@@ -249,13 +436,35 @@ void MessageToKitHandler::HandleListPrototype(message::ptr const &data)
     std::string command = data->get_map()["cmd"]->get_string();
     message::ptr Obj = object_message::create();
 
-    QString rawDaprRunStatus = this->m_dapr_utils->daprCliList();
+    ReplyCodec::Format format = ReplyFormat(data);
 
     Obj->get_map()["request_from"] = string_message::create(request_from);
     Obj->get_map()["cmd"] = string_message::create(command);
-    Obj->get_map()["result"] = string_message::create(s_prototypes.toStdString());
-    Obj->get_map()["dapr_status"] = string_message::create(rawDaprRunStatus.toStdString());
-    m_io->socket()->emit("messageToKit-kitReply", Obj);
+    ReplyCodec::SetPayload(Obj, "result", s_prototypes.toUtf8(), format);
+    if (format.structured)
+    {
+        ReplyCodec::SetPayload(Obj, "dapr_status", this->m_dapr_utils->daprCliListJson(), format);
+    }
+    else
+    {
+        QString rawDaprRunStatus = this->m_dapr_utils->daprCliList();
+        Obj->get_map()["dapr_status"] = string_message::create(rawDaprRunStatus.toStdString());
+    }
+
+    // cgroup throttling / oom counters of the prototype containers, one docker exec per
+    // running app; only on request, the list is polled
+    message::ptr stats = data->get_map()["stats"];
+    if (stats && stats->get_flag() == message::flag_boolean && stats->get_bool())
+    {
+        QStringList appIds;
+        for (const auto item : QJsonDocument::fromJson(s_prototypes.toUtf8()).array())
+        {
+            appIds.append(item.toObject().value("id").toString());
+        }
+        appIds.removeAll(QString());
+        ReplyCodec::SetPayload(Obj, "resource_stats", QJsonDocument(ResourceLimits::Stats(appIds)).toJson(QJsonDocument::Compact), format);
+    }
+    SendReply(Obj);
 }
 
 void MessageToKitHandler::GetSupportAPIs(message::ptr const &data)
@@ -269,8 +478,38 @@ void MessageToKitHandler::GetSupportAPIs(message::ptr const &data)
 
     Obj->get_map()["request_from"] = string_message::create(request_from);
     Obj->get_map()["cmd"] = string_message::create(command);
-    Obj->get_map()["result"] = string_message::create(supportAPIs.toStdString());
-    m_io->socket()->emit("messageToKit-kitReply", Obj);
+    ReplyCodec::SetPayload(Obj, "result", supportAPIs.toUtf8(), ReplyFormat(data));
+    SendReply(Obj);
+}
+
+void MessageToKitHandler::GetOrchestratorStats(message::ptr const &data)
+{
+    std::string request_from = data->get_map()["request_from"]->get_string();
+    std::string command = data->get_map()["cmd"]->get_string();
+    message::ptr Obj = object_message::create();
+
+    // per-lane queueing delay of the orchestrator socket, in ms
+    QJsonObject lanes;
+    if (m_orchestrator)
+    {
+        const char *laneNames[LANE_COUNT] = {"control", "bulk"};
+        for (int lane = 0; lane < LANE_COUNT; lane++)
+        {
+            LaneStats stats = m_orchestrator->GetLaneStats((OrchestratorLane)lane);
+            QJsonObject laneObj;
+            laneObj["sent"] = (qint64)stats.sent;
+            laneObj["pending"] = (qint64)stats.pending;
+            laneObj["last_delay_ms"] = stats.lastDelayMs;
+            laneObj["avg_delay_ms"] = stats.avgDelayMs;
+            laneObj["max_delay_ms"] = stats.maxDelayMs;
+            lanes[laneNames[lane]] = laneObj;
+        }
+    }
+
+    Obj->get_map()["request_from"] = string_message::create(request_from);
+    Obj->get_map()["cmd"] = string_message::create(command);
+    ReplyCodec::SetPayload(Obj, "result", QJsonDocument(lanes).toJson(QJsonDocument::Compact), ReplyFormat(data));
+    SendReply(Obj);
 }
 
 void MessageToKitHandler::SetSupportAPIs(message::ptr const &data)
@@ -282,16 +521,25 @@ void MessageToKitHandler::SetSupportAPIs(message::ptr const &data)
     message::ptr Obj = object_message::create();
 
     QString s_result = "fail";
-    int n_write_result = FileUtils::WriteFile(QString::fromStdString(DK_PROTOTYPES_FOLDER + "supportedvssapi.json"), QString::fromStdString(apis));
+    // the supported api list is part of the mapping snapshot, committed versions stay unchanged
+    vssMappingMutex.lock();
+    MappingSnapshots::Begin();
+    int n_write_result = FileUtils::WriteFile(QString::fromStdString(DK_SUPPORTED_VSS_FILE), QString::fromStdString(apis));
     if (n_write_result >= 0)
     {
+        MappingSnapshots::Commit();
         s_result = "success";
     }
+    else
+    {
+        MappingSnapshots::Rollback();
+    }
+    vssMappingMutex.unlock();
 
     Obj->get_map()["request_from"] = string_message::create(request_from);
     Obj->get_map()["cmd"] = string_message::create(command);
     Obj->get_map()["result"] = string_message::create(s_result.toStdString());
-    m_io->socket()->emit("messageToKit-kitReply", Obj);
+    SendReply(Obj);
 
     // notify to all client that apis list is changed
     updateSupportedApiList2Server();
@@ -312,14 +560,45 @@ void MessageToKitHandler::HandleActionOnPrototype(message::ptr const &data)
 
     QString cmd;
     cmd.clear();
+    qint64 startLatencyMs = -1;
     if (action == "start")
     {
+        QElapsedTimer startTimer;
+        startTimer.start();
         this->m_dapr_utils->startApp(s_proto_id);
+        startLatencyMs = startTimer.elapsed();
     }
     else if (action == "stop")
     {
         this->m_dapr_utils->stopApp(s_proto_id);
     }
+    else if (action == "set-limits")
+    {
+        // "limits" is a json string like the supported api list, e.g. {"cpus":1,"memory":"256m"}
+        message::ptr limitsMsg = data->get_map()["limits"];
+        if (!limitsMsg || limitsMsg->get_flag() != message::flag_string)
+        {
+            s_result = "Error: limits must be a json string";
+        }
+        else
+        {
+            QJsonObject limitsObj = QJsonDocument::fromJson(QByteArray::fromStdString(limitsMsg->get_string())).object();
+            int write_ret = m_proto_utils->SetPrototypeLimits(s_proto_id, limitsObj);
+            if (write_ret >= 0)
+            {
+                s_result = "Success";
+                // a running container gets them right away, removed limits on its next recreate
+                if (this->m_dapr_utils->isAppRunning(s_proto_id))
+                {
+                    this->m_dapr_utils->applyLimits(s_proto_id);
+                }
+            }
+            else
+            {
+                s_result = QString::fromStdString("Write Error " + std::to_string(write_ret));
+            }
+        }
+    }
     else if (action == "get-log")
     {
         s_result = FileUtils::ReadFile(QString::fromStdString(DK_PROTOTYPES_FOLDER + proto_id + "/main.log"));
@@ -334,17 +613,28 @@ void MessageToKitHandler::HandleActionOnPrototype(message::ptr const &data)
     }
     else if (action == "set-python-code")
     {
-        // first try to stop app if it is running
-        cmd += "dapr stop --app-id " + s_proto_id + "  &";
-        system(cmd.toUtf8());
-        QThread::msleep(50);
+        // main.py is bind mounted into the app's container, a running app is restarted
+        // in place afterwards; only apps still started through the dapr cli are stopped
+        bool running = this->m_dapr_utils->isAppRunning(s_proto_id);
+        if (!running)
+        {
+            cmd += "dapr stop --app-id " + s_proto_id + "  &";
+            system(cmd.toUtf8());
+            QThread::msleep(50);
+        }
 
-        // then write file
         std::string code = data->get_map()["code"]->get_string();
         int write_ret = FileUtils::WriteFile(QString::fromStdString(DK_PROTOTYPES_FOLDER + proto_id + "/main.py"), QString::fromStdString(code));
         if (write_ret >= 0)
         {
             s_result = "Success";
+            if (running)
+            {
+                QElapsedTimer startTimer;
+                startTimer.start();
+                this->m_dapr_utils->startApp(s_proto_id);
+                startLatencyMs = startTimer.elapsed();
+            }
         }
         else
         {
@@ -356,7 +646,12 @@ void MessageToKitHandler::HandleActionOnPrototype(message::ptr const &data)
     Obj->get_map()["cmd"] = string_message::create(command);
     Obj->get_map()["action"] = string_message::create(action);
     Obj->get_map()["result"] = string_message::create(s_result.toStdString());
-    m_io->socket()->emit("messageToKit-kitReply", Obj);
+    if (startLatencyMs >= 0)
+    {
+        Obj->get_map()["start_latency_ms"] = int_message::create(startLatencyMs);
+        Obj->get_map()["start_mode"] = string_message::create(this->m_dapr_utils->lastStartMode().toStdString());
+    }
+    SendReply(Obj);
 }
 
 typedef struct
@@ -371,15 +666,41 @@ typedef struct
     bool isDeleted = false;
 } Vss_Mapping_Item;
 
-typedef struct
+static QList<Vssmapping_Dbc_CanChannels_Struct> ReadDbcCanList()
 {
-    QString dbcName;
-    QStringList canChannels;
-} Vssmapping_Dbc_CanChannels_Struct;
+    QList<Vssmapping_Dbc_CanChannels_Struct> dbcCanList;
+    QFile file(QString::fromStdString(DK_VSSMAPPING_DBC_CAN));
+    file.open(QIODevice::ReadOnly | QIODevice::Text);
+    if (file.isOpen())
+    {
+        QString data = QString(file.readAll());
+        file.close();
+        //        qDebug() << "raw file: " << data;
+        QJsonArray list = QJsonDocument::fromJson(data.toUtf8()).array();
+        qDebug() << "init dbcCanList: " << list;
+        for (const auto obj : list)
+        {
+            Vssmapping_Dbc_CanChannels_Struct dbcCanItem;
+            dbcCanItem.dbcName = obj.toObject().value("dbcName").toString();
+            QJsonArray mappingList = obj.toObject().value("canChannels").toArray();
+            for (int i = 0; i < mappingList.count(); i++)
+            {
+                dbcCanItem.canChannels.append(mappingList[i].toString());
+            }
+            dbcCanList.append(dbcCanItem);
+        }
+    }
+    return dbcCanList;
+}
 
 bool MessageToKitHandler::VssMappingHandler(message::ptr const &data, QString &vssMappingInfo2Client)
 {
-    vssMappingMutex.lock();
+    if (!LockUnlessCancelled(vssMappingMutex))
+    {
+        vssMappingInfo2Client += "Cancelled while waiting for another vss mapping.\n";
+        return false;
+    }
+    SendProgress("started", 0);
 
     qDebug() << __func__ << __LINE__;
     if (data->get_flag() == message::flag_object)
@@ -390,32 +711,29 @@ bool MessageToKitHandler::VssMappingHandler(message::ptr const &data, QString &v
         //        qDebug() << __func__ << __LINE__ << " config : " << QString::fromStdString(config);
         //        qDebug() << __func__ << __LINE__ << " payload : " << QString::fromStdString(payload);
 
-        QList<Vssmapping_Dbc_CanChannels_Struct> dbcCanList;
-        dbcCanList.clear();
+        // validate against the dbc and the VSS spec before anything is written;
+        // a dry run only reports the result and the diff
         {
-            // init dbcCanList
-            QFile file(QString::fromStdString(DK_VSSMAPPING_DBC_CAN));
-            file.open(QIODevice::ReadOnly | QIODevice::Text);
-            if (file.isOpen())
+            message::ptr dryRun = obj->get_map()["dry_run"];
+            bool isDryRun = dryRun && (dryRun->get_flag() == message::flag_boolean) && dryRun->get_bool();
+            VssMappingValidator validator(QString::fromStdString(payload), FileUtils::ReadFile(QString::fromStdString(DK_VSSOVERLAY_VSPECS)),
+                                          QString::fromStdString(DK_VSS_VSPECS_JSON));
+            m_vssMappingReport = validator.Validate(QJsonDocument::fromJson(QByteArray::fromStdString(config)).object());
+            m_vssMappingReport["dry_run"] = isDryRun;
+            vssMappingInfo2Client += VssMappingValidator::Summary(m_vssMappingReport);
+            bool isValid = m_vssMappingReport.value("ok").toBool();
+            if (isDryRun || !isValid)
             {
-                QString data = QString(file.readAll());
-                file.close();
-                //        qDebug() << "raw file: " << data;
-                QJsonArray list = QJsonDocument::fromJson(data.toUtf8()).array();
-                qDebug() << "init dbcCanList: " << list;
-                for (const auto obj : list)
-                {
-                    Vssmapping_Dbc_CanChannels_Struct dbcCanItem;
-                    dbcCanItem.dbcName = obj.toObject().value("dbcName").toString();
-                    QJsonArray mappingList = obj.toObject().value("canChannels").toArray();
-                    for (int i = 0; i < mappingList.count(); i++)
-                    {
-                        dbcCanItem.canChannels.append(mappingList[i].toString());
-                    }
-                    dbcCanList.append(dbcCanItem);
-                }
+                vssMappingMutex.unlock();
+                return isValid;
             }
         }
+        // from here on every change goes into a new snapshot of the mapping state,
+        // any failure below switches back to the last known good one
+        MappingSnapshots::Begin();
+        SendProgress("validated", 5);
+
+        QList<Vssmapping_Dbc_CanChannels_Struct> dbcCanList = ReadDbcCanList();
 
         {
             // save vss mapping configuration
@@ -424,6 +742,7 @@ bool MessageToKitHandler::VssMappingHandler(message::ptr const &data, QString &v
             {
                 qDebug() << __func__ << __LINE__ << file.errorString();
                 vssMappingInfo2Client += "Failed to open vss mapping configuration file.\n";
+                MappingSnapshots::Rollback();
                 vssMappingMutex.unlock();
                 return false;
             }
@@ -512,6 +831,7 @@ bool MessageToKitHandler::VssMappingHandler(message::ptr const &data, QString &v
             {
                 qDebug() << __func__ << __LINE__ << file.errorString();
                 vssMappingInfo2Client += "Failed to save dbc file.\n";
+                MappingSnapshots::Rollback();
                 vssMappingMutex.unlock();
                 return false;
             }
@@ -523,6 +843,16 @@ bool MessageToKitHandler::VssMappingHandler(message::ptr const &data, QString &v
             file.close();
         }
 
+        // last cancellation point: from here on the overlay and the runtime are changed
+        if (IsCancelled())
+        {
+            vssMappingInfo2Client += "Cancelled before the deployment of the new mapping.\n";
+            MappingSnapshots::Rollback();
+            vssMappingMutex.unlock();
+            return false;
+        }
+        SendProgress("update overlay", 10);
+
         //////////////////////////////////////////////////////////////////////////////////////////////////
         ////////////////////////////// the deployment of new mapping //////////////////////////////////////
         QStringList addedVssMappingList;
@@ -538,6 +868,7 @@ bool MessageToKitHandler::VssMappingHandler(message::ptr const &data, QString &v
             {
                 qDebug() << __func__ << __LINE__ << file.errorString();
                 vssMappingInfo2Client += "Failed to open vss overlay file.\n";
+                MappingSnapshots::Rollback();
                 vssMappingMutex.unlock();
                 return false;
             }
@@ -757,6 +1088,7 @@ bool MessageToKitHandler::VssMappingHandler(message::ptr const &data, QString &v
                     {
                         qDebug() << __func__ << __LINE__ << dbc.errorString();
                         vssMappingInfo2Client += "Failed to open dbc default values file.\n";
+                        MappingSnapshots::Rollback();
                         vssMappingMutex.unlock();
                         return false;
                     }
@@ -840,18 +1172,27 @@ bool MessageToKitHandler::VssMappingHandler(message::ptr const &data, QString &v
         }
 
         // Create vss.json based on the overlay
+        SendProgress("generate vss.json", 20);
         if (!GenerateVssJson(vssMappingInfo2Client))
         {
+            MappingSnapshots::Rollback();
             vssMappingMutex.unlock();
             return false;
         }
 
         // Create vehicle model
+        SendProgress("generate vehicle model", 40);
         if (!GenerateVehicleModel(vssMappingInfo2Client))
         {
+            MappingSnapshots::Rollback();
             vssMappingMutex.unlock();
             return false;
         }
+        // idle pool containers may have loaded the old model
+        if (PrototypePool::Instance())
+        {
+            PrototypePool::Instance()->Flush();
+        }
 
         // create content for DK_STOPKUKFEEDER_SCRIPT and DK_STARTKUKFEEDER_SCRIPT
         {
@@ -900,28 +1241,7 @@ bool MessageToKitHandler::VssMappingHandler(message::ptr const &data, QString &v
                 std::string ret = CommonUtils::runLinuxCommand(cmd.c_str());
                 cmd.clear();
 
-                std::string kuksaFeederPath = "/usr/bin/dreamkit/kuksa/kuksa.val.feeders/dbc2val";
-                std::string content = "cd " + kuksaFeederPath + "\n";
-                for (int i = 0; i < dbcCanList.count(); i++)
-                {
-                    for (int j = 0; j < dbcCanList[i].canChannels.count(); j++)
-                    {
-                        std::string dbcName_ = dbcCanList[i].dbcName.toStdString();
-                        std::string logpath = DK_VSSMAPPING_FOLDER + "dbcfeeder_" + dbcName_ + "_" + dbcCanList[i].canChannels[j].toStdString() + ".log";
-                        content += "> " + logpath + "\n"; // clear old log file
-                        content += "sudo -u " + DK_ZC_USERNAME;
-#ifdef DREAMKIT_MINI
-                        content += " PYTHONPATH=$PYTHONPATH:/usr/bin/dreamkit/kuksa/kuksa.val.feeders/py-kuksa-val-feeders-env/lib/python3.11/site-packages/ ";
-#endif
-                        content += " python3 dbcfeeder.py --val2dbc --dbc2val --use-socketcan ";
-                        content += " --canport " + dbcCanList[i].canChannels[j].toStdString();
-                        content += " --dbcfile " + DK_VSSMAPPING_FOLDER + dbcName_ + " ";
-                        content += " --dbc-default " + DK_DBCDEFAULT_VALUES + " ";
-                        content += " --mapping " + DK_VSS_VSPECS_JSON + " ";
-                        content += " > " + logpath;
-                        content += " 2>&1 &\n";
-                    }
-                }
+                std::string content = CreateKuksaFeederStartScript(dbcCanList, nullptr);
 
                 // write content to a file
                 cmd += "echo '" + content + "' > " + DK_STARTKUKFEEDER_SCRIPT;
@@ -935,6 +1255,7 @@ bool MessageToKitHandler::VssMappingHandler(message::ptr const &data, QString &v
         // s1: stop all dapr digital.auto apps and the apps based on velocitas
         // s2: stop vehicledatabroker on vcu
         // s3: Send cmd to stop kuksa-feeder on zonecontroller
+        SendProgress("stop runtime", 60);
         StopRuntimeEnv();
 
         // s4: update EcuList.json
@@ -966,13 +1287,8 @@ bool MessageToKitHandler::VssMappingHandler(message::ptr const &data, QString &v
             if (m_orchestrator)
             {
                 qDebug() << "update artifacts for zone controller: m_orchestrator is available";
-                // send file to zonecontroller
-                m_orchestrator->SendFile("zonecontroller", DK_VSS_VSPECS_JSON);
-                m_orchestrator->SendFile("zonecontroller", dbcFile);
-                m_orchestrator->SendFile("zonecontroller", DK_DBCDEFAULT_VALUES);
-                m_orchestrator->SendFile("zonecontroller", DK_STOPKUKFEEDER_SCRIPT);
-                m_orchestrator->SendFile("zonecontroller", DK_STARTKUKFEEDER_SCRIPT);
-                QThread::sleep(2);
+                // send to every zone controller only the dbc files and feeder config of its own CAN channels
+                SendVssMappingArtifactsToZones(dbcCanList, vssMappingInfo2Client);
             }
             else
             {
@@ -985,6 +1301,7 @@ bool MessageToKitHandler::VssMappingHandler(message::ptr const &data, QString &v
         // start vehicle runtime
         // s5: start vehicledatabroker on vcu
         // s6: Send cmd to start kuksa-feeder startup script on zonecontroller
+        SendProgress("start runtime", 80);
         StartRunTimeEnv();
 
         // s7: update std::string DK_SUPPORTED_VSS_FILE = (DK_PROTOTYPES_FOLDER + "supportedvssapi.json");
@@ -1033,7 +1350,8 @@ bool MessageToKitHandler::VssMappingHandler(message::ptr const &data, QString &v
         // note: during the deployment of new mapping, if there is any error at any step, the system shall report to web client -> done
     }
 
-    vssMappingInfo2Client += "Vss Mapping is deployed successfully !!!\n";
+    MappingSnapshots::Commit();
+    vssMappingInfo2Client += "Vss Mapping is deployed successfully (" + MappingSnapshots::Current() + ") !!!\n";
 
     qDebug() << "Vss Mapping is deployed successfully !!!";
 
@@ -1041,10 +1359,90 @@ bool MessageToKitHandler::VssMappingHandler(message::ptr const &data, QString &v
     system("sync");
     QThread::msleep(50);
 
+    SendProgress("done", 100);
     vssMappingMutex.unlock();
     return true;
 }
 
+std::string MessageToKitHandler::CreateKuksaFeederStartScript(const QList<Vssmapping_Dbc_CanChannels_Struct> &dbcCanList, const ZoneController *zone)
+{
+    // one kuksa-feeder per dbc and CAN channel. If zone is given, only the channels owned by that zone controller.
+    std::string kuksaFeederPath = "/usr/bin/dreamkit/kuksa/kuksa.val.feeders/dbc2val";
+    std::string content = "cd " + kuksaFeederPath + "\n";
+    for (int i = 0; i < dbcCanList.count(); i++)
+    {
+        for (int j = 0; j < dbcCanList[i].canChannels.count(); j++)
+        {
+            if (zone && !zone->OwnsCanChannel(dbcCanList[i].canChannels[j].toStdString()))
+            {
+                continue;
+            }
+            std::string dbcName_ = dbcCanList[i].dbcName.toStdString();
+            std::string logpath = DK_VSSMAPPING_FOLDER + "dbcfeeder_" + dbcName_ + "_" + dbcCanList[i].canChannels[j].toStdString() + ".log";
+            content += "> " + logpath + "\n"; // clear old log file
+            content += "sudo -u " + DK_ZC_USERNAME;
+#ifdef DREAMKIT_MINI
+            content += " PYTHONPATH=$PYTHONPATH:/usr/bin/dreamkit/kuksa/kuksa.val.feeders/py-kuksa-val-feeders-env/lib/python3.11/site-packages/ ";
+#endif
+            content += " python3 dbcfeeder.py --val2dbc --dbc2val --use-socketcan ";
+            content += " --canport " + dbcCanList[i].canChannels[j].toStdString();
+            content += " --dbcfile " + DK_VSSMAPPING_FOLDER + dbcName_ + " ";
+            content += " --dbc-default " + DK_DBCDEFAULT_VALUES + " ";
+            content += " --mapping " + DK_VSS_VSPECS_JSON + " ";
+            content += " > " + logpath;
+            content += " 2>&1 &\n";
+        }
+    }
+    return content;
+}
+
+void MessageToKitHandler::SendVssMappingArtifactsToZones(const QList<Vssmapping_Dbc_CanChannels_Struct> &dbcCanList, QString &vssMappingInfo2Client)
+{
+    std::map<std::string, std::vector<std::string>> filesPerZone;
+    for (const ZoneController &zone : m_orchestrator->GetZoneControllers("kuksa_feeder"))
+    {
+        // the start script keeps its file name, so every zone controller gets its own folder
+        std::string zoneFolder = DK_ZONECTL_FOLDER + "zones/" + zone.name + "/";
+        std::string startScript = zoneFolder + "start_kuksa_feeder_script.sh";
+        FileUtils::CreateDirIfNotExist(QString::fromStdString(DK_ZONECTL_FOLDER + "zones/"));
+        FileUtils::CreateDirIfNotExist(QString::fromStdString(zoneFolder));
+        FileUtils::WriteFile(QString::fromStdString(startScript), QString::fromStdString(CreateKuksaFeederStartScript(dbcCanList, &zone)));
+
+        std::vector<std::string> files;
+        files.push_back(DK_VSS_VSPECS_JSON);
+        files.push_back(DK_DBCDEFAULT_VALUES);
+        files.push_back(DK_STOPKUKFEEDER_SCRIPT);
+        files.push_back(startScript);
+        for (int i = 0; i < dbcCanList.count(); i++)
+        {
+            for (int j = 0; j < dbcCanList[i].canChannels.count(); j++)
+            {
+                if (zone.OwnsCanChannel(dbcCanList[i].canChannels[j].toStdString()))
+                {
+                    files.push_back(DK_VSSMAPPING_FOLDER + dbcCanList[i].dbcName.toStdString());
+                    break;
+                }
+            }
+        }
+        filesPerZone[zone.name] = files;
+    }
+
+    LogZoneResults("vss mapping artifacts", m_orchestrator->SendFilesToZones(filesPerZone), &vssMappingInfo2Client);
+}
+
+void MessageToKitHandler::LogZoneResults(const std::string &what, const std::vector<ZoneResult> &results, QString *vssMappingInfo2Client)
+{
+    for (const ZoneResult &r : results)
+    {
+        QString line = QString::fromStdString(what + " -> " + r.dest + ": " + (!r.success ? "not confirmed" : r.unconfirmed > 0 ? "delivered, unconfirmed" : "ok") + " (" + r.detail + ")");
+        qDebug() << __func__ << __LINE__ << line;
+        if (vssMappingInfo2Client)
+        {
+            *vssMappingInfo2Client += line + "\n";
+        }
+    }
+}
+
 bool MessageToKitHandler::GenerateVehicleModel(QString &vssMappingInfo2Client)
 {
     std::string cmd = "> " + DK_VMODEL_GEN_LOG + ";";
@@ -1169,8 +1567,8 @@ void MessageToKitHandler::StartKuksaFeeder()
         qDebug() << "------ vehicledatabroker status : " << databrokerStatus;
         if (databrokerStatus == "true")
         {
-            qDebug() << "------ Send cmd to start kuksa-feeder startup script on zonecontroller";
-            m_orchestrator->SendCmd("zonecontroller", "start_kuksa_feeder_script");
+            qDebug() << "------ Send cmd to start kuksa-feeder startup script on zonecontrollers";
+            LogZoneResults("start_kuksa_feeder_script", m_orchestrator->SendCmdToZones("start_kuksa_feeder_script", "kuksa_feeder"));
         }
     }
 #ifdef DREAMKIT_MINI
@@ -1197,24 +1595,54 @@ void MessageToKitHandler::StopRuntimeEnv()
 
 void MessageToKitHandler::StopAllDigialAutoApps()
 {
-    // TODO
     qDebug() << "stop all dapr digital.auto apps and the apps based on velocitas";
-    QFile file(QString::fromStdString(DK_PROTOTYPES_LIST));
-    file.open(QIODevice::ReadOnly | QIODevice::Text);
-    if (file.isOpen())
+    QList<App_Stop_Result> results;
+    int ret = m_dapr_utils->stopAllApp(results);
+    int stopped = 0;
+    for (const auto &r : results)
     {
-        QString data = QString(file.readAll());
-        file.close();
-        //        qDebug() << "raw file: " << data;
-        QJsonArray jsonAppList = QJsonDocument::fromJson(data.toUtf8()).array();
-        for (const auto obj : jsonAppList)
+        if (r.stopped)
         {
-            QString appId = obj.toObject().value("id").toString();
-            std::string cmd = "dapr stop " + appId.toStdString();
-            qDebug() << "dapr cmd : " << QString::fromStdString(cmd);
-            std::string ret = CommonUtils::runLinuxCommand(cmd.c_str());
+            stopped++;
         }
     }
+    qDebug() << __func__ << __LINE__ << " : stopped " << stopped << "/" << results.size() << " running prototypes, ret = " << ret;
+}
+
+void MessageToKitHandler::HandleStopAllPrototypes(message::ptr const &data)
+{
+    std::string request_from = data->get_map()["request_from"]->get_string();
+    std::string command = data->get_map()["cmd"]->get_string();
+    int maxParallel = 4;
+    int deadlineMs = 20000;
+    if (data->get_map()["max_parallel"] && data->get_map()["max_parallel"]->get_flag() == message::flag_integer)
+    {
+        maxParallel = data->get_map()["max_parallel"]->get_int();
+    }
+    if (data->get_map()["deadline_ms"] && data->get_map()["deadline_ms"]->get_flag() == message::flag_integer)
+    {
+        deadlineMs = data->get_map()["deadline_ms"]->get_int();
+    }
+
+    QList<App_Stop_Result> results;
+    int ret = m_dapr_utils->stopAllApp(results, maxParallel, deadlineMs);
+
+    QJsonArray resultList;
+    for (const auto &r : results)
+    {
+        QJsonObject obj;
+        obj["id"] = r.appId;
+        obj["stopped"] = r.stopped;
+        obj["detail"] = r.detail;
+        resultList.append(obj);
+    }
+
+    message::ptr Obj = object_message::create();
+    Obj->get_map()["request_from"] = string_message::create(request_from);
+    Obj->get_map()["cmd"] = string_message::create(command);
+    Obj->get_map()["result"] = bool_message::create(ret == 0);
+    ReplyCodec::SetPayload(Obj, "apps", QJsonDocument(resultList).toJson(QJsonDocument::Compact), ReplyFormat(data));
+    SendReply(Obj);
 }
 
 void MessageToKitHandler::StopVehicleDatabroker()
@@ -1231,9 +1659,9 @@ void MessageToKitHandler::StopKuksaFeeder()
 #if 1
     if (m_orchestrator)
     {
-        qDebug() << "Send cmd to stop kuksa-feeder on zonecontroller";
-        // send command to zonecontroller
-        m_orchestrator->SendCmd("zonecontroller", "stop_kuksa_feeder_script");
+        qDebug() << "Send cmd to stop kuksa-feeder on zonecontrollers";
+        // send command to all zonecontrollers running a kuksa-feeder
+        LogZoneResults("stop_kuksa_feeder_script", m_orchestrator->SendCmdToZones("stop_kuksa_feeder_script", "kuksa_feeder"));
     }
 #ifdef DREAMKIT_MINI
     else {
@@ -1293,7 +1721,7 @@ void MessageToKitHandler::ExecuteCmd(message::ptr const &data)
         Obj->get_map()["request_from"] = string_message::create(request_from);
         Obj->get_map()["cmd"] = string_message::create(command);
         Obj->get_map()["result"] = string_message::create(output.toStdString());
-        m_io->socket()->emit("messageToKit-kitReply", Obj);
+        SendReply(Obj);
     }
 }
 
@@ -1304,6 +1732,8 @@ void MessageToKitHandler::FactoryResetHandler(message::ptr const &data)
 
 bool MessageToKitHandler::VssMappingFactoryResetHandler(message::ptr const &data, QString &vssMappingInfo2Client)
 {
+    // the snapshots are shared with vss_mapping
+    vssMappingMutex.lock();
     vssMappingFactoryResetMutex.lock();
     qDebug() << __func__ << __LINE__;
     // stop runtime env on vcu and zone controller
@@ -1311,72 +1741,39 @@ bool MessageToKitHandler::VssMappingFactoryResetHandler(message::ptr const &data
         StopRuntimeEnv();
     }
 
-    // reset DK_VSSMAPPING_DBC_CAN
-    {
-        std::string cmd = "> " + DK_VSSMAPPING_DBC_CAN + ";";
-        cmd += "echo \"[]\" > " + DK_VSSMAPPING_DBC_CAN + ";";
-        std::string ret = CommonUtils::runLinuxCommand(cmd.c_str());
-    }
-
-    // reset supportedvssapi.json and update to server to notify the web client
-    {
-        std::string cmd = "> " + DK_SUPPORTED_VSS_FILE + ";";
-        cmd += "echo \"[]\" > " + DK_SUPPORTED_VSS_FILE + ";";
-        std::string ret = CommonUtils::runLinuxCommand(cmd.c_str());
-    }
-
-    // reset overlay file
-    {
-        std::string cmd = "> " + DK_VSSOVERLAY_VSPECS + ";";
-        cmd += "echo 'Vehicle:\n  type: branch\n\n' > " + DK_VSSOVERLAY_VSPECS + ";";
-        std::string ret = CommonUtils::runLinuxCommand(cmd.c_str());
-    }
-
-    // remove dbc files
-    {
-        // TODO: T.B.D
-    }
-
-    // reset dbc default value
-    {
-        std::string cmd = "> " + DK_DBCDEFAULT_VALUES + ";";
-        cmd += "echo \"{}\" > " + DK_DBCDEFAULT_VALUES + ";";
-        std::string ret = CommonUtils::runLinuxCommand(cmd.c_str());
-    }
-
-    // reset EcuList.json
-    {
-        // TODO: T.B.D
-    }
-
-    // clear start kuksa feeder scripts
-    {
-        std::string cmd = "> " + DK_STARTKUKFEEDER_SCRIPT + ";";
-        std::string ret = CommonUtils::runLinuxCommand(cmd.c_str());
-    }
+    // overlay, dbc list, default values, scripts and supported api list from the factory snapshot
+    MappingSnapshots::Begin("factory");
 
-    // update all reset artifacts to zonecontroller
+    // update all reset artifacts to zonecontrollers
     if (m_orchestrator)
     {
-        // send file to zonecontroller
-        m_orchestrator->SendFile("zonecontroller", DK_VSS_VSPECS_JSON);
-        m_orchestrator->SendFile("zonecontroller", DK_DBCDEFAULT_VALUES);
-        m_orchestrator->SendFile("zonecontroller", DK_STOPKUKFEEDER_SCRIPT);
-        m_orchestrator->SendFile("zonecontroller", DK_STARTKUKFEEDER_SCRIPT);
-        QThread::sleep(2);
+        QList<Vssmapping_Dbc_CanChannels_Struct> emptyDbcCanList;
+        SendVssMappingArtifactsToZones(emptyDbcCanList, vssMappingInfo2Client);
     }
 
-    // regenerate vss_specs and vehicle_model
-    if (!GenerateVssJson(vssMappingInfo2Client))
+    // vss.json of the factory state is generated once and kept in the factory snapshot
+    if (!MappingSnapshots::FactoryHas("vss.json") && !GenerateVssJson(vssMappingInfo2Client))
     {
+        MappingSnapshots::Rollback();
+        StartRunTimeEnv();
         vssMappingFactoryResetMutex.unlock();
+        vssMappingMutex.unlock();
         return false;
     }
     if (!GenerateVehicleModel(vssMappingInfo2Client))
     {
+        MappingSnapshots::Rollback();
+        StartRunTimeEnv();
         vssMappingFactoryResetMutex.unlock();
+        vssMappingMutex.unlock();
         return false;
     }
+    MappingSnapshots::Commit();
+    MappingSnapshots::CompleteFactory();
+    if (PrototypePool::Instance())
+    {
+        PrototypePool::Instance()->Flush();
+    }
 
     // restart the runtime env on vcu and zone controller
     {
@@ -1387,9 +1784,45 @@ bool MessageToKitHandler::VssMappingFactoryResetHandler(message::ptr const &data
     qDebug() << "Vss Mapping Factory Reset is executed successfully !!!";
 
     vssMappingFactoryResetMutex.unlock();
+    vssMappingMutex.unlock();
     return true;
 }
 
+bool MessageToKitHandler::VssMappingRollbackHandler(message::ptr const &data, QString &vssMappingInfo2Client)
+{
+    vssMappingMutex.lock();
+    std::string version;
+    message::ptr versionMsg = data->get_map()["version"];
+    if (versionMsg && versionMsg->get_flag() == message::flag_string)
+    {
+        version = versionMsg->get_string();
+    }
+    QString target = version.empty() ? MappingSnapshots::Previous() : QString::fromStdString(version);
+    if (!MappingSnapshots::SwitchTo(target))
+    {
+        vssMappingInfo2Client += "No mapping snapshot '" + target + "' to roll back to.\n";
+        vssMappingMutex.unlock();
+        return false;
+    }
+    vssMappingInfo2Client += "Switched the vss mapping to " + target + ".\n";
+
+    // the files are in place already, the runtime and the vehicle model have to follow
+    StopRuntimeEnv();
+    if (m_orchestrator)
+    {
+        SendVssMappingArtifactsToZones(ReadDbcCanList(), vssMappingInfo2Client);
+    }
+    bool ret = GenerateVehicleModel(vssMappingInfo2Client);
+    if (PrototypePool::Instance())
+    {
+        PrototypePool::Instance()->Flush();
+    }
+    StartRunTimeEnv();
+
+    vssMappingMutex.unlock();
+    return ret;
+}
+
 void MessageToKitHandler::updateSupportedApiList2Server()
 {
     // notify to all client that apis list is changed
@@ -1400,7 +1833,13 @@ void MessageToKitHandler::updateSupportedApiList2Server()
     message::ptr obj = object_message::create();
     obj->get_map()["kit_id"] = string_message::create(serialNo.toStdString());
     obj->get_map()["name"] = string_message::create(serialNo.toStdString());
-    obj->get_map()["support_apis"] = string_message::create(supportAPIs.toStdString());
+    ReplyCodec::SetPayload(obj, "support_apis", supportAPIs.toUtf8(), ReplyCodec::FromRequest(nullptr, true));
+    obj->get_map()["capabilities"] = ReplyCodec::Capabilities();
+    message::ptr lanEndpoint = LanServer::Announced();
+    if (lanEndpoint)
+    {
+        obj->get_map()["lan_endpoint"] = lanEndpoint;
+    }
     m_io->socket()->emit("register_kit", obj);
 }
 
@@ -1412,7 +1851,17 @@ void MessageToKitHandler::run()
         std::string cmd = m_data->get_map()["cmd"]->get_string();
         qDebug() << __func__ << __LINE__ << " cmd : " << QString::fromStdString(cmd);
 
-        if (cmd == "deploy_request")
+        if (m_duplicateId)
+        {
+            qDebug() << __func__ << __LINE__ << " : request_id " << QString::fromStdString(m_requestId) << " is already in flight";
+            message::ptr Obj = object_message::create();
+            Obj->get_map()["request_from"] = string_message::create(m_requestFrom);
+            Obj->get_map()["cmd"] = string_message::create(cmd);
+            Obj->get_map()["result"] = bool_message::create(false);
+            Obj->get_map()["log"] = string_message::create("request_id is already in flight");
+            SendReply(Obj);
+        }
+        else if (cmd == "deploy_request")
         {
             DeploymentHandler(m_data);
         }
@@ -1428,6 +1877,14 @@ void MessageToKitHandler::run()
         {
             SetSupportAPIs(m_data);
         }
+        else if (cmd == "cancel_request")
+        {
+            HandleCancelRequest(m_data);
+        }
+        else if (cmd == "get_orchestrator_stats")
+        {
+            GetOrchestratorStats(m_data);
+        }
         else if (cmd == "list_prototypes")
         {
             HandleListPrototype(m_data);
@@ -1436,6 +1893,10 @@ void MessageToKitHandler::run()
         {
             HandleActionOnPrototype(m_data);
         }
+        else if (cmd == "stop_all_prototypes")
+        {
+            HandleStopAllPrototypes(m_data);
+        }
         else if (cmd == "factory_reset")
         {
             FactoryResetHandler(m_data);
@@ -1458,7 +1919,30 @@ void MessageToKitHandler::run()
             Obj->get_map()["cmd"] = string_message::create("vss_mapping_factory_reset_result");
             Obj->get_map()["result"] = bool_message::create(ret);
             Obj->get_map()["log"] = string_message::create(vssMappingInfo2Client.toStdString());
-            m_io->socket()->emit("messageToKit-kitReply", Obj);
+            SendReply(Obj);
+
+            updateSupportedApiList2Server();
+        }
+        else if (cmd == "vss_mapping_rollback")
+        {
+            QString vssMappingInfo2Client;
+            bool ret = VssMappingRollbackHandler(m_data, vssMappingInfo2Client);
+            qDebug() << __func__ << __LINE__ << " : vssMappingInfo2Client : " << vssMappingInfo2Client;
+
+            std::string request_from = m_data->get_map()["request_from"]->get_string();
+            message::ptr Obj = object_message::create();
+            Obj->get_map()["request_from"] = string_message::create(request_from);
+            Obj->get_map()["cmd"] = string_message::create("vss_mapping_rollback_result");
+            Obj->get_map()["result"] = bool_message::create(ret);
+            Obj->get_map()["log"] = string_message::create(vssMappingInfo2Client.toStdString());
+            Obj->get_map()["version"] = string_message::create(MappingSnapshots::Current().toStdString());
+            message::ptr versions = array_message::create();
+            for (const QString &v : MappingSnapshots::Versions())
+            {
+                versions->get_vector().push_back(string_message::create(v.toStdString()));
+            }
+            Obj->get_map()["versions"] = versions;
+            SendReply(Obj);
 
             updateSupportedApiList2Server();
         }
@@ -1476,9 +1960,16 @@ void MessageToKitHandler::run()
             Obj->get_map()["cmd"] = string_message::create("vss_mapping_result");
             Obj->get_map()["result"] = bool_message::create(ret);
             Obj->get_map()["log"] = string_message::create(vssMappingInfo2Client.toStdString());
-            m_io->socket()->emit("messageToKit-kitReply", Obj);
+            if (!m_vssMappingReport.isEmpty())
+            {
+                ReplyCodec::SetPayload(Obj, "validation", QJsonDocument(m_vssMappingReport).toJson(QJsonDocument::Compact), ReplyFormat(m_data));
+            }
+            SendReply(Obj);
 
-            updateSupportedApiList2Server();
+            if (!m_vssMappingReport.value("dry_run").toBool())
+            {
+                updateSupportedApiList2Server();
+            }
         }
         else
         {
@@ -4,13 +4,23 @@
 #include <QObject>
 #include <QThread>
 #include <QTimer>
+#include <QMutex>
+#include <QJsonObject>
 #include <sio_client.h>
+#include <atomic>
 #include "vcuorchestrator.hpp"
 #include "prototype_utils.h"
 #include "dapr_utils.h"
+#include "reply_codec.h"
 
 #define kURL "https://kit.digitalauto.tech"
 
+typedef struct
+{
+    QString dbcName;
+    QStringList canChannels;
+} Vssmapping_Dbc_CanChannels_Struct;
+
 class MessageToKitHandler : public QThread
 {
     Q_OBJECT
@@ -20,6 +30,12 @@ public:
     MessageToKitHandler(client *_io, message::ptr const &data, DkOrchestrator *orchestrator);
     ~MessageToKitHandler();
 
+    // cooperative: the handler stops at its next cancellation point
+    static bool CancelRequest(const std::string &requestFrom, const std::string &requestId);
+
+    // replies and progress events go to 'sink' instead of the cloud socket
+    void SetReplySink(const ReplySink &sink);
+
 Q_SIGNALS:
     void messageToKitHandlerFinished(MessageToKitHandler *thread);
 
@@ -34,6 +50,8 @@ private:
     void HandleActionOnPrototype(message::ptr const &data);
     bool VssMappingHandler(message::ptr const &data, QString &vssMappingInfo2Client);
     bool VssMappingFactoryResetHandler(message::ptr const &data, QString &vssMappingInfo2Client);
+    // switches to a committed mapping snapshot ("version", default: the one before the last good)
+    bool VssMappingRollbackHandler(message::ptr const &data, QString &vssMappingInfo2Client);
 
     void StopRuntimeEnv();
     void StopAllDigialAutoApps();
@@ -44,13 +62,37 @@ private:
     void StartVehicleDatabroker();
     void StartKuksaFeeder();
 
+    std::string CreateKuksaFeederStartScript(const QList<Vssmapping_Dbc_CanChannels_Struct> &dbcCanList, const ZoneController *zone);
+    void SendVssMappingArtifactsToZones(const QList<Vssmapping_Dbc_CanChannels_Struct> &dbcCanList, QString &vssMappingInfo2Client);
+    void LogZoneResults(const std::string &what, const std::vector<ZoneResult> &results, QString *vssMappingInfo2Client = nullptr);
+
     bool GenerateVssJson(QString &vssMappingInfo2Client);
     bool GenerateVehicleModel(QString &vssMappingInfo2Client);
     void GetSupportAPIs(message::ptr const &data);
     void SetSupportAPIs(message::ptr const &data);
+    void GetOrchestratorStats(message::ptr const &data);
+    void HandleStopAllPrototypes(message::ptr const &data);
 
     void updateSupportedApiList2Server();
 
+    // every reply/progress event echoes "request_id" of the request, so several requests
+    // with the same cmd can be in flight and complete in any order
+    void SendReply(message::ptr const &reply);
+    void SendProgress(const std::string &stage, int percent);
+    ReplyCodec::Format ReplyFormat(message::ptr const &request) const;
+    bool IsCancelled() const;
+    bool LockUnlessCancelled(QMutex &mutex);
+    void HandleCancelRequest(message::ptr const &data);
+
+    // validation result and diff of the last vss_mapping, see VssMappingValidator
+    QJsonObject m_vssMappingReport;
+
+    ReplySink m_replySink;
+    std::string m_requestFrom;
+    std::string m_requestId;
+    // another request from the same client with this request_id is still running
+    bool m_duplicateId = false;
+    std::atomic<bool> m_cancelled{false};
     message::ptr m_data;
     client *m_io;
     DkOrchestrator *m_orchestrator;
@@ -0,0 +1,267 @@
+#include "prototype_pool.h"
+#include "dapr_utils.h"
+#include "resource_limits.h"
+#include "fileutils.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QProcess>
+#include <QDateTime>
+#include <QSet>
+#include <chrono>
+
+// an idle container has to be ready (signal blocked, modules loaded) within this time
+#define kPoolReadyTimeoutMs 30000
+#define kPoolRetryDelayMs 5000
+
+static PrototypePool *poolInstance = nullptr;
+
+// runs as the container's main process, see PrototypePool
+static const char *kBootstrapPy = R"(import os, runpy, signal, sys
+
+# an adopted container restarted by Dapr_Utils::reloadApp runs its app right away
+if not os.path.exists("/app/slot/app_id"):
+    signal.pthread_sigmask(signal.SIG_BLOCK, {signal.SIGUSR1})
+    for name in sys.argv[1:]:
+        try:
+            __import__(name)
+        except Exception as e:
+            print("preload " + name + ": " + str(e), flush=True)
+    open("/app/slot/ready", "w").close()
+    signal.sigwait({signal.SIGUSR1})
+    signal.pthread_sigmask(signal.SIG_UNBLOCK, {signal.SIGUSR1})
+
+app_id = open("/app/slot/app_id").read().strip()
+if os.path.lexists("/app/exec"):
+    if os.path.islink("/app/exec"):
+        os.unlink("/app/exec")
+    else:
+        os.rename("/app/exec", "/app/exec.image")
+os.symlink("/app/prototypes/" + app_id, "/app/exec")
+os.chdir("/app/exec")
+# /app/prototypes is read-only, the prototype's main.log links here
+log = os.open("/app/slot/main.log", os.O_WRONLY | os.O_CREAT | os.O_TRUNC, 0o666)
+os.dup2(log, 1)
+os.dup2(log, 2)
+sys.argv = ["main.py"]
+sys.path.insert(0, "/app/exec")
+runpy.run_path("main.py", run_name="__main__")
+)";
+
+static int RunDocker(const QStringList &args, QString *out = nullptr)
+{
+    QProcess docker;
+    docker.start("docker", args);
+    if (!docker.waitForFinished(30000))
+    {
+        docker.kill();
+        return -1;
+    }
+    if (out)
+    {
+        *out = QString::fromUtf8(docker.readAllStandardOutput());
+    }
+    return (docker.exitStatus() == QProcess::NormalExit) ? docker.exitCode() : -1;
+}
+
+PrototypePool::PrototypePool(const QString &localRoot, const QString &hostRoot, const QString &localPrototypesDir,
+                             const QString &hostPrototypesDir, int size, const QString &python, const QStringList &preload)
+    : m_localRoot(localRoot), m_hostRoot(hostRoot), m_localPrototypesDir(localPrototypesDir), m_hostPrototypesDir(hostPrototypesDir),
+      m_size(size), m_python(python), m_preload(preload)
+{
+    poolInstance = this;
+}
+
+PrototypePool::~PrototypePool()
+{
+    poolInstance = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_stop = true;
+        m_cv.notify_all();
+    }
+    if (m_refillThread.joinable())
+    {
+        m_refillThread.join();
+    }
+}
+
+PrototypePool *PrototypePool::Instance()
+{
+    return poolInstance;
+}
+
+QString PrototypePool::ContainerName(const QString &slot) const
+{
+    return "dk_pool_" + slot;
+}
+
+void PrototypePool::Start()
+{
+    QDir().mkpath(m_localRoot);
+    FileUtils::WriteFile(m_localRoot + "bootstrap.py", QString::fromUtf8(kBootstrapPy));
+
+    // idle containers of the previous run do not know about changes since then
+    QString leftovers;
+    RunDocker(QStringList() << "ps" << "-a" << "-q" << "--filter" << "name=^dk_pool_", &leftovers);
+    QStringList ids = leftovers.split('\n', Qt::SkipEmptyParts);
+    if (!ids.isEmpty())
+    {
+        RunDocker(QStringList() << "rm" << "-f" << ids);
+    }
+
+    m_refillThread = std::thread(&PrototypePool::RefillLoop, this);
+}
+
+bool PrototypePool::Adopt(const QString &appId)
+{
+    while (true)
+    {
+        QString slot;
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            if (m_idle.isEmpty())
+            {
+                qDebug() << __func__ << __LINE__ << " : pool is empty";
+                return false;
+            }
+            slot = m_idle.takeFirst();
+            m_cv.notify_all();
+        }
+
+        FileUtils::WriteFile(m_localRoot + slot + "/app_id", appId);
+        // relative, so that it resolves for dk_manager and on the host
+        QString appDir = m_localPrototypesDir + appId;
+        QFile::remove(appDir + "/main.log");
+        QFile::link(QDir(appDir).relativeFilePath(m_localRoot + slot + "/main.log"), appDir + "/main.log");
+        if (RunDocker(QStringList() << "rename" << ContainerName(slot) << appId) != 0)
+        {
+            // the idle container is gone, try the next one
+            RunDocker(QStringList() << "rm" << "-f" << ContainerName(slot));
+            continue;
+        }
+        if (RunDocker(QStringList() << "kill" << "-s" << "USR1" << appId) != 0)
+        {
+            RunDocker(QStringList() << "rm" << "-f" << appId);
+            return false;
+        }
+        qDebug() << __func__ << __LINE__ << " : " << appId << " adopted slot " << slot;
+        return true;
+    }
+}
+
+void PrototypePool::Flush()
+{
+    QStringList idle;
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_generation++;
+        idle.swap(m_idle);
+        m_cv.notify_all();
+    }
+    for (const QString &slot : idle)
+    {
+        RunDocker(QStringList() << "rm" << "-f" << ContainerName(slot));
+    }
+}
+
+bool PrototypePool::StartSlot(const QString &slot)
+{
+    QString dir = m_localRoot + slot + "/";
+    QDir(dir).removeRecursively();
+    QDir().mkpath(dir);
+
+    QString cmd = "docker run -d --init --name " + ContainerName(slot) + " --label dk.pool.slot=" + slot +
+                  " --label dk.spec=" + Dapr_Utils::appSpec() +
+                  Dapr_Utils::appContainerOptions() + ResourceLimits::DockerOptions(ResourceLimits::Defaults()) +
+                  "-v " + m_hostRoot + slot + ":/app/slot -v " + m_hostRoot + "bootstrap.py:/app/pool/bootstrap.py:ro" +
+                  " -v " + m_hostPrototypesDir + ":/app/prototypes:ro" +
+                  " --entrypoint " + m_python + " " + Dapr_Utils::appImage() + " /app/pool/bootstrap.py " + m_preload.join(" ");
+    qDebug() << cmd;
+    if (system(cmd.toUtf8()) != 0)
+    {
+        return false;
+    }
+
+    // usable once the bootstrap blocks SIGUSR1, an earlier signal would kill it
+    for (int waited = 0; waited < kPoolReadyTimeoutMs; waited += 100)
+    {
+        if (QFile::exists(dir + "ready"))
+        {
+            return true;
+        }
+        {
+            std::unique_lock<std::mutex> lock(m_mtx);
+            if (m_cv.wait_for(lock, std::chrono::milliseconds(100), [this]() { return m_stop; }))
+            {
+                break;
+            }
+        }
+    }
+    RunDocker(QStringList() << "rm" << "-f" << ContainerName(slot));
+    return false;
+}
+
+void PrototypePool::RemoveStaleSlots()
+{
+    // slot directories stay while their (renamed) container exists
+    QString labels;
+    if (RunDocker(QStringList() << "ps" << "-a" << "--filter" << "label=dk.pool.slot" << "--format" << "{{.Label \"dk.pool.slot\"}}", &labels) != 0)
+    {
+        return;
+    }
+    QSet<QString> live;
+    for (const QString &slot : labels.split('\n', Qt::SkipEmptyParts))
+    {
+        live.insert(slot.trimmed());
+    }
+    for (const QString &slot : QDir(m_localRoot).entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+        if (!live.contains(slot))
+        {
+            QDir(m_localRoot + slot).removeRecursively();
+        }
+    }
+}
+
+void PrototypePool::RefillLoop()
+{
+    // slot names stay unique across restarts
+    QString prefix = QString::number(QDateTime::currentMSecsSinceEpoch(), 36);
+    while (true)
+    {
+        int generation;
+        QString slot;
+        {
+            std::unique_lock<std::mutex> lock(m_mtx);
+            m_cv.wait(lock, [this]() { return m_stop || m_idle.size() < m_size; });
+            if (m_stop)
+            {
+                return;
+            }
+            generation = m_generation;
+            slot = prefix + "_" + QString::number(m_nextSlot++);
+        }
+
+        RemoveStaleSlots();
+        bool ok = StartSlot(slot);
+
+        std::unique_lock<std::mutex> lock(m_mtx);
+        if (ok && generation == m_generation && !m_stop)
+        {
+            m_idle.append(slot);
+            qDebug() << __func__ << __LINE__ << " : slot " << slot << " ready, idle = " << m_idle.size();
+            continue;
+        }
+        lock.unlock();
+        if (ok)
+        {
+            // flushed while it was starting
+            RunDocker(QStringList() << "rm" << "-f" << ContainerName(slot));
+            continue;
+        }
+        // e.g. the image is not there yet
+        std::unique_lock<std::mutex> retryLock(m_mtx);
+        m_cv.wait_for(retryLock, std::chrono::milliseconds(kPoolRetryDelayMs), [this]() { return m_stop; });
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef PROTOTYPE_POOL_H
+#define PROTOTYPE_POOL_H
+
+#include <QString>
+#include <QStringList>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Pool of pre-started dk_app_python_template containers ('dk_pool_<slot>').
+// An idle container already has its volumes and network and a Python interpreter waiting in
+// bootstrap.py. Adopt() writes the app id into the container's slot directory, renames the
+// container to the app id and sends SIGUSR1; the bootstrap then links /app/exec to the
+// prototype and runs its main.py. From then on it is a normal app container (docker stop/rm).
+// The prototypes are mounted read-only, as the container does not know yet which one it will
+// run; main.log goes to the slot directory and Adopt() links it from the prototype.
+// The pool refills itself in the background and removes slot directories of containers which
+// are gone. Flush() replaces the idle containers, e.g. after the vehicle model was regenerated.
+class PrototypePool
+{
+public:
+    // localRoot/hostRoot, localPrototypesDir/hostPrototypesDir: as seen by dk_manager and by the docker host
+    PrototypePool(const QString &localRoot, const QString &hostRoot, const QString &localPrototypesDir, const QString &hostPrototypesDir,
+                  int size, const QString &python, const QStringList &preload);
+    ~PrototypePool();
+
+    // null when no pool is configured
+    static PrototypePool *Instance();
+
+    void Start();
+    // true if an idle container took over the app; false: start it the usual way
+    bool Adopt(const QString &appId);
+    void Flush();
+
+private:
+    void RefillLoop();
+    bool StartSlot(const QString &slot);
+    void RemoveStaleSlots();
+    QString ContainerName(const QString &slot) const;
+
+    QString m_localRoot;
+    QString m_hostRoot;
+    QString m_localPrototypesDir;
+    QString m_hostPrototypesDir;
+    int m_size;
+    QString m_python;
+    QStringList m_preload;
+
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+    std::thread m_refillThread;
+    QStringList m_idle;      // ready slots
+    int m_generation = 0;
+    int m_nextSlot = 0;
+    bool m_stop = false;
+};
+
+#endif // PROTOTYPE_POOL_H
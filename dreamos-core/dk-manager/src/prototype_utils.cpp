@@ -59,6 +59,33 @@ int Prototype_Utils::AppendPrototypeToList(QString proto_id, QString proto_name,
     return n_write_result;
 }
 
+int Prototype_Utils::SetPrototypeLimits(QString proto_id, QJsonObject limits)
+{
+    QJsonArray jsonAppList = this->ReadPrototypeList();
+
+    for (int i = 0; i < jsonAppList.count(); i++)
+    {
+        QJsonObject obj = jsonAppList[i].toObject();
+        if (proto_id == obj.value("id").toString())
+        {
+            if (limits.isEmpty())
+            {
+                obj.remove("limits");
+            }
+            else
+            {
+                obj["limits"] = limits;
+            }
+            jsonAppList[i] = obj;
+
+            QJsonDocument newDoc(jsonAppList);
+            return FileUtils::WriteFile(this->_prototype_dir + "prototypes.json", newDoc.toJson());
+        }
+    }
+    qDebug() << __func__ << __LINE__ << " unknown app id : " << proto_id;
+    return -1;
+}
+
 int Prototype_Utils::SavePrototypeCode(QString proto_id, QString proto_code)
 {
     return 0;
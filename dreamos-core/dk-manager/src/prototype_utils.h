@@ -18,6 +18,8 @@ public:
     QJsonArray ReadPrototypeList();
     int AppendPrototypeToList(QString proto_id, QString proto_name, QString execType="", QString deployFrom="");
     int SavePrototypeCode(QString proto_id, QString proto_code);
+    // own cgroup limits of a prototype, see ResourceLimits; empty limits remove them
+    int SetPrototypeLimits(QString proto_id, QJsonObject limits);
 };
 
 #endif // PROTOTYPE_UTILS_H
@@ -0,0 +1,145 @@
+#include "reply_codec.h"
+#include <QDebug>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <zstd.h>
+#include <atomic>
+#include <cmath>
+#include <memory>
+
+#define kReplyCompressThreshold (4 * 1024)
+#define kReplyCompressionLevel 3
+
+#define kCapabilityStructured "structured_reply"
+#define kCapabilityZstd "zstd_reply"
+
+static std::atomic<bool> serverStructured(false);
+static std::atomic<bool> serverZstd(false);
+
+message::ptr ReplyCodec::Capabilities()
+{
+    message::ptr caps = array_message::create();
+    caps->get_vector().push_back(string_message::create(kCapabilityStructured));
+    caps->get_vector().push_back(string_message::create(kCapabilityZstd));
+    return caps;
+}
+
+static void ReadCapabilities(message::ptr const &list, ReplyCodec::Format &format)
+{
+    if (!list || list->get_flag() != message::flag_array)
+        return;
+    for (const auto &cap : list->get_vector())
+    {
+        if (cap->get_flag() != message::flag_string)
+            continue;
+        if (cap->get_string() == kCapabilityStructured)
+            format.structured = true;
+        else if (cap->get_string() == kCapabilityZstd)
+            format.zstd = true;
+    }
+}
+
+void ReplyCodec::SetServerCapabilities(message::list const &registerAck)
+{
+    Format format;
+    if (registerAck.size() > 0 && registerAck[0]->get_flag() == message::flag_object)
+    {
+        ReadCapabilities(registerAck[0]->get_map()["capabilities"], format);
+    }
+    serverStructured = format.structured;
+    serverZstd = format.structured && format.zstd;
+    qDebug() << __func__ << __LINE__ << " : structured = " << format.structured << ", zstd = " << format.zstd;
+}
+
+void ReplyCodec::ResetServerCapabilities()
+{
+    serverStructured = false;
+    serverZstd = false;
+}
+
+ReplyCodec::Format ReplyCodec::FromRequest(message::ptr const &request, bool viaServer)
+{
+    Format format;
+    if (viaServer)
+    {
+        format.structured = serverStructured;
+        format.zstd = serverZstd;
+    }
+    if (request && request->get_flag() == message::flag_object)
+    {
+        ReadCapabilities(request->get_map()["accept"], format);
+    }
+    // zstd is only used for structured payloads
+    format.zstd = format.zstd && format.structured;
+    return format;
+}
+
+void ReplyCodec::SetPayload(message::ptr const &obj, const std::string &key, const QByteArray &json, const Format &format)
+{
+    if (!format.structured)
+    {
+        obj->get_map()[key] = string_message::create(json.toStdString());
+        return;
+    }
+
+    if (format.zstd && json.size() > kReplyCompressThreshold)
+    {
+        std::string compressed;
+        compressed.resize(ZSTD_compressBound(json.size()));
+        size_t n = ZSTD_compress(&compressed[0], compressed.size(), json.constData(), json.size(), kReplyCompressionLevel);
+        if (!ZSTD_isError(n))
+        {
+            compressed.resize(n);
+            obj->get_map()[key] = binary_message::create(std::make_shared<const std::string>(compressed));
+            obj->get_map()[key + "_encoding"] = string_message::create("json+zstd");
+            return;
+        }
+    }
+
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(json, &error);
+    if (error.error != QJsonParseError::NoError)
+    {
+        // not JSON (e.g. an empty file): keep the text
+        obj->get_map()[key] = string_message::create(json.toStdString());
+        return;
+    }
+    obj->get_map()[key] = doc.isArray() ? JsonToMessage(doc.array()) : JsonToMessage(doc.object());
+}
+
+message::ptr ReplyCodec::JsonToMessage(const QJsonValue &value)
+{
+    switch (value.type())
+    {
+    case QJsonValue::Bool:
+        return bool_message::create(value.toBool());
+    case QJsonValue::Double:
+    {
+        double d = value.toDouble();
+        // the cast is only defined for values qint64 can hold; 2^63 itself is out of range
+        if (std::isfinite(d) && d >= -9223372036854775808.0 && d < 9223372036854775808.0 && d == std::trunc(d))
+            return int_message::create((qint64)d);
+        return double_message::create(d);
+    }
+    case QJsonValue::String:
+        return string_message::create(value.toString().toStdString());
+    case QJsonValue::Array:
+    {
+        message::ptr arr = array_message::create();
+        for (const auto item : value.toArray())
+            arr->get_vector().push_back(JsonToMessage(item));
+        return arr;
+    }
+    case QJsonValue::Object:
+    {
+        message::ptr obj = object_message::create();
+        QJsonObject jsonObj = value.toObject();
+        for (auto it = jsonObj.begin(); it != jsonObj.end(); ++it)
+            obj->get_map()[it.key().toStdString()] = JsonToMessage(it.value());
+        return obj;
+    }
+    default:
+        return null_message::create();
+    }
+}
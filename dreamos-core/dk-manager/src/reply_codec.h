@@ -0,0 +1,42 @@
+#ifndef REPLY_CODEC_H
+#define REPLY_CODEC_H
+
+#include <QByteArray>
+#include <QJsonValue>
+#include <sio_client.h>
+#include <functional>
+
+using namespace sio;
+
+// where a reply goes when it is not for the cloud server, e.g. a LAN client (see LanServer)
+typedef std::function<void(const std::string &event, message::ptr const &data)> ReplySink;
+
+// Encoding of JSON payloads in replies to the server.
+// - legacy:     the JSON text as a string (what older servers and web clients expect)
+// - structured: sio objects/arrays, no JSON inside a string
+// - zstd:       structured payloads above kReplyCompressThreshold are sent as a binary
+//               zstd frame of the JSON text, with '<key>_encoding' = "json+zstd"
+// The kit advertises Capabilities() in register_kit. The other side enables them either
+// for all replies through the register_kit ack ({ "capabilities": [...] }) or per request
+// with "accept": [...]. The ack only speaks for the server: requests which do not come
+// through it (e.g. from a LAN client) get what they ask for in "accept" and nothing more.
+class ReplyCodec
+{
+public:
+    struct Format
+    {
+        bool structured = false;
+        bool zstd = false;
+    };
+
+    static message::ptr Capabilities();
+    static void SetServerCapabilities(message::list const &registerAck);
+    // each connection negotiates again, a server which does not ack gets legacy replies
+    static void ResetServerCapabilities();
+    static Format FromRequest(message::ptr const &request, bool viaServer);
+
+    static void SetPayload(message::ptr const &obj, const std::string &key, const QByteArray &json, const Format &format);
+    static message::ptr JsonToMessage(const QJsonValue &value);
+};
+
+#endif // REPLY_CODEC_H
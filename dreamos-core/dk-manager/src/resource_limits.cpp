@@ -0,0 +1,277 @@
+#include "resource_limits.h"
+#include "fileutils.h"
+#include <QDebug>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QMutex>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QRunnable>
+#include <QSet>
+#include <QThreadPool>
+#include <algorithm>
+
+#define kStatsExecTimeoutMs 3000
+// the values come from prototypes.json and end up in a shell command, anything else is dropped
+#define kMaxCpuIndex 1023
+#define kMaxCpus 1024.0
+#define kMinCpuShares 2
+#define kMaxCpuShares 262144
+#define kMaxPids 4194304
+
+static QJsonObject limitDefaults;
+
+static bool IsCpuList(const QString &list)
+{
+    static const QRegularExpression cpuList("^[0-9,-]+$");
+    return cpuList.match(list).hasMatch();
+}
+
+// "0-3,6" -> {0,1,2,3,6}
+static QSet<int> ParseCpuList(const QString &list)
+{
+    QSet<int> cpus;
+    if (!IsCpuList(list))
+    {
+        return cpus;
+    }
+    for (const QString &part : list.split(',', Qt::SkipEmptyParts))
+    {
+        QStringList range = part.trimmed().split('-');
+        bool okFirst = false;
+        bool okLast = false;
+        int first = range.value(0).toInt(&okFirst);
+        int last = (range.size() > 1) ? range.value(1).toInt(&okLast) : first;
+        if (!okFirst || (range.size() > 1 && !okLast) || range.size() > 2 || first < 0 || last > kMaxCpuIndex)
+        {
+            continue;
+        }
+        for (int cpu = first; cpu <= last; cpu++)
+        {
+            cpus.insert(cpu);
+        }
+    }
+    return cpus;
+}
+
+// memory values may be given as "512m" or as a number of bytes; empty if not valid
+static QString SizeValue(const QJsonValue &value, const char *name)
+{
+    static const QRegularExpression size("^\\d+[kmgKMG]?$");
+    QString text;
+    if (value.isDouble())
+    {
+        double bytes = value.toDouble();
+        if (bytes >= 0 && bytes < 9.0e18)
+        {
+            text = QString::number((qint64)bytes);
+        }
+    }
+    else
+    {
+        text = value.toString().trimmed();
+    }
+    if (!text.isEmpty() && !size.match(text).hasMatch())
+    {
+        qDebug() << __func__ << __LINE__ << " : ignore " << name << " = " << text;
+        return QString();
+    }
+    return text;
+}
+
+// a whole number in [min, max] or 0 if not given/valid
+static qint64 IntValue(const QJsonValue &value, const char *name, qint64 min, qint64 max)
+{
+    if (value.isUndefined() || value.isNull())
+    {
+        return 0;
+    }
+    double number = value.toDouble(-1);
+    if (!(number >= min && number <= max) || number != (double)(qint64)number)
+    {
+        qDebug() << __func__ << __LINE__ << " : ignore " << name << " = " << value;
+        return 0;
+    }
+    return (qint64)number;
+}
+
+void ResourceLimits::LoadDefaults(const QString &systemCfgFile)
+{
+    QJsonObject cfg = QJsonDocument::fromJson(FileUtils::ReadFile(systemCfgFile).toUtf8()).object();
+    limitDefaults = cfg.value("prototype_limits").toObject();
+    qDebug() << __func__ << __LINE__ << " : " << limitDefaults;
+}
+
+QJsonObject ResourceLimits::Defaults()
+{
+    return limitDefaults;
+}
+
+QJsonObject ResourceLimits::ForApp(const QString &protoDir, const QString &appId)
+{
+    QJsonObject limits = limitDefaults;
+    QJsonArray list = QJsonDocument::fromJson(FileUtils::ReadFile(protoDir + "prototypes.json").toUtf8()).array();
+    for (const auto item : list)
+    {
+        QJsonObject entry = item.toObject();
+        if (entry.value("id").toString() != appId)
+        {
+            continue;
+        }
+        QJsonObject own = entry.value("limits").toObject();
+        for (auto it = own.begin(); it != own.end(); ++it)
+        {
+            limits[it.key()] = it.value();
+        }
+        break;
+    }
+    return limits;
+}
+
+QString ResourceLimits::Cpuset(const QJsonObject &limits)
+{
+    QString cpuset = limits.value("cpuset").toString().trimmed();
+    if (!cpuset.isEmpty())
+    {
+        if (IsCpuList(cpuset))
+        {
+            return cpuset;
+        }
+        qDebug() << __func__ << __LINE__ << " : ignore cpuset = " << cpuset;
+    }
+    QSet<int> reserved = ParseCpuList(limits.value("reserved_cpus").toString());
+    if (reserved.isEmpty())
+    {
+        return QString();
+    }
+
+    QSet<int> online = ParseCpuList(FileUtils::ReadFile("/sys/devices/system/cpu/online").trimmed());
+    QList<int> allowed = (online - reserved).values();
+    if (allowed.isEmpty())
+    {
+        qDebug() << __func__ << __LINE__ << " : every core is reserved, ignore reserved_cpus";
+        return QString();
+    }
+    std::sort(allowed.begin(), allowed.end());
+    QStringList cpus;
+    for (int cpu : allowed)
+    {
+        cpus.append(QString::number(cpu));
+    }
+    return cpus.join(',');
+}
+
+QString ResourceLimits::DockerOptions(const QJsonObject &limits)
+{
+    QString options;
+    double cpus = limits.value("cpus").toDouble(0);
+    if (cpus > 0 && cpus <= kMaxCpus)
+    {
+        options += " --cpus=" + QString::number(cpus);
+    }
+    else if (cpus != 0)
+    {
+        qDebug() << __func__ << __LINE__ << " : ignore cpus = " << limits.value("cpus");
+    }
+    qint64 shares = IntValue(limits.value("cpu_shares"), "cpu_shares", kMinCpuShares, kMaxCpuShares);
+    if (shares > 0)
+    {
+        options += " --cpu-shares=" + QString::number(shares);
+    }
+    QString cpuset = Cpuset(limits);
+    if (!cpuset.isEmpty())
+    {
+        options += " --cpuset-cpus=" + cpuset;
+    }
+    QString memory = SizeValue(limits.value("memory"), "memory");
+    if (!memory.isEmpty())
+    {
+        options += " --memory=" + memory;
+        // no swap unless configured, a leaking prototype should hit its limit
+        QString memorySwap = SizeValue(limits.value("memory_swap"), "memory_swap");
+        options += " --memory-swap=" + (memorySwap.isEmpty() ? memory : memorySwap);
+    }
+    qint64 pids = IntValue(limits.value("pids"), "pids", 1, kMaxPids);
+    if (pids > 0)
+    {
+        options += " --pids-limit=" + QString::number(pids);
+    }
+    return options.isEmpty() ? options : options + " ";
+}
+
+QJsonObject ResourceLimits::Stats(const QStringList &appIds)
+{
+    QJsonObject stats;
+    if (appIds.isEmpty())
+    {
+        return stats;
+    }
+
+    // one inspect for all; unknown ids only make it print an error for them
+    QProcess inspect;
+    inspect.start("docker", QStringList() << "inspect" << "-f"
+                                          << "{{.Name}} {{.State.Running}} {{.State.OOMKilled}} {{.RestartCount}}" << appIds);
+    if (!inspect.waitForFinished(5000))
+    {
+        inspect.kill();
+        return stats;
+    }
+    QStringList running;
+    for (const QString &line : QString::fromUtf8(inspect.readAllStandardOutput()).split('\n', Qt::SkipEmptyParts))
+    {
+        QStringList fields = line.trimmed().split(' ');
+        if (fields.size() < 4)
+        {
+            continue;
+        }
+        QString appId = fields[0].mid(1);
+        QJsonObject entry;
+        entry["running"] = (fields[1] == "true");
+        entry["oom_killed"] = (fields[2] == "true");
+        entry["restarts"] = fields[3].toInt();
+        stats[appId] = entry;
+        if (fields[1] == "true")
+        {
+            running.append(appId);
+        }
+    }
+
+    // throttling and oom counters from the container's own cgroup (v2, else v1)
+    QMutex statsMutex;
+    QThreadPool pool;
+    pool.setMaxThreadCount(4);
+    for (const QString &appId : running)
+    {
+        pool.start(QRunnable::create([appId, &stats, &statsMutex]() {
+            QProcess exec;
+            exec.start("docker", QStringList() << "exec" << appId << "sh" << "-c"
+                                               << "cat /sys/fs/cgroup/cpu.stat /sys/fs/cgroup/memory.events 2>/dev/null || "
+                                                  "cat /sys/fs/cgroup/cpu/cpu.stat /sys/fs/cgroup/memory/memory.oom_control 2>/dev/null");
+            if (!exec.waitForFinished(kStatsExecTimeoutMs))
+            {
+                exec.kill();
+                exec.waitForFinished(1000);
+                return;
+            }
+            QHash<QString, qint64> values;
+            for (const QString &line : QString::fromUtf8(exec.readAllStandardOutput()).split('\n', Qt::SkipEmptyParts))
+            {
+                QStringList kv = line.trimmed().split(' ');
+                if (kv.size() == 2)
+                {
+                    values[kv[0]] = kv[1].toLongLong();
+                }
+            }
+
+            QMutexLocker locker(&statsMutex);
+            QJsonObject entry = stats.value(appId).toObject();
+            entry["nr_throttled"] = (double)values.value("nr_throttled");
+            entry["throttled_usec"] = (double)(values.contains("throttled_usec") ? values.value("throttled_usec") : values.value("throttled_time") / 1000);
+            entry["oom_kill"] = (double)values.value("oom_kill");
+            entry["memory_max_events"] = (double)values.value("max");
+            stats[appId] = entry;
+        }));
+    }
+    pool.waitForDone();
+    return stats;
+}
@@ -0,0 +1,30 @@
+#ifndef RESOURCE_LIMITS_H
+#define RESOURCE_LIMITS_H
+
+#include <QString>
+#include <QStringList>
+#include <QJsonObject>
+
+// cgroup limits of the prototype containers, so a runaway prototype cannot starve the
+// databroker and the CAN feeders. Defaults come from "prototype_limits" in dk_system_cfg.json,
+// a prototype's entry in prototypes.json may override them with its own "limits":
+//   { "cpus": 1.5, "cpu_shares": 512, "cpuset": "2-5", "reserved_cpus": "0-1",
+//     "memory": "512m", "memory_swap": "512m", "pids": 256 }
+// Without "cpuset" the container gets all online cores except "reserved_cpus".
+class ResourceLimits
+{
+public:
+    static void LoadDefaults(const QString &systemCfgFile);
+    static QJsonObject Defaults();
+    // defaults merged with the prototype's own limits
+    static QJsonObject ForApp(const QString &protoDir, const QString &appId);
+    // options for docker run and docker update, empty without limits
+    static QString DockerOptions(const QJsonObject &limits);
+    // per app: oom_killed, restarts, nr_throttled, throttled_usec, oom_kill, memory_max_events
+    static QJsonObject Stats(const QStringList &appIds);
+
+private:
+    static QString Cpuset(const QJsonObject &limits);
+};
+
+#endif // RESOURCE_LIMITS_H
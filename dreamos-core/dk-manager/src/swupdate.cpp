@@ -0,0 +1,431 @@
+#include "swupdate.h"
+#include "fileutils.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QThread>
+#include <QCryptographicHash>
+#include <QRegularExpression>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <zstd.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <vector>
+
+extern QMutex dreamOsPatchUpdateMutex;
+
+// zstd --patch-from uses --long, a window up to 2 GB must be accepted
+#define kMaxWindowLog 31
+#define kMaxPendingBoots 3
+
+static bool IsValidTarget(const QString &target)
+{
+    // the target is used as a directory name
+    return QRegularExpression("^[A-Za-z0-9_-]+$").match(target).hasMatch();
+}
+
+// targets whose update can be confirmed: dk_manager commits its own update once the
+// new version reaches the server (DkManger::OnConnected). Nothing confirms others yet.
+static bool IsConfirmableTarget(const QString &target)
+{
+    return target == "dk_manager";
+}
+
+static bool IsValidVersion(const QString &version)
+{
+    // the version is used in the download file name and on the activate.sh command line
+    return QRegularExpression("^[A-Za-z0-9._-]+$").match(version).hasMatch();
+}
+
+SwUpdate::SwUpdate(const QString &rootDir, const QString &patchDir, QObject *parent)
+    : QObject(parent), m_rootDir(rootDir), m_patchDir(patchDir),
+      m_downloader(new DkDownloader(patchDir, 1, 4, this))
+{
+    connect(m_downloader, &DkDownloader::finished, this, &SwUpdate::OnDownloadFinished);
+    connect(m_downloader, &DkDownloader::progress, this, &SwUpdate::OnDownloadProgress);
+}
+
+QString SwUpdate::TargetDir(const QString &target) const
+{
+    return QDir(m_rootDir).filePath(target) + "/";
+}
+
+QString SwUpdate::CurrentSlot(const QString &target) const
+{
+    QFileInfo current(TargetDir(target) + "current");
+    if (!current.isSymLink())
+        return QString();
+    return QFileInfo(current.symLinkTarget()).fileName();
+}
+
+QString SwUpdate::SlotVersion(const QString &target, const QString &slot) const
+{
+    if (slot.isEmpty())
+        return QString();
+    return FileUtils::ReadFile(TargetDir(target) + slot + "/version").trimmed();
+}
+
+QString SwUpdate::OtherSlot(const QString &slot)
+{
+    return (slot == "slot_a") ? "slot_b" : "slot_a";
+}
+
+bool SwUpdate::SwitchSlot(const QString &target, const QString &slot, QString &error)
+{
+    // rename() over the old link is atomic, 'current' always points to a complete slot
+    QString current = TargetDir(target) + "current";
+    QString tmp = current + ".tmp";
+    QFile::remove(tmp);
+    if (symlink(slot.toStdString().c_str(), tmp.toStdString().c_str()) != 0 ||
+        rename(tmp.toStdString().c_str(), current.toStdString().c_str()) != 0)
+    {
+        error = "cannot switch to " + slot;
+        return false;
+    }
+    sync();
+    return true;
+}
+
+bool SwUpdate::Activate(const QString &target, const QString &slot, QString &error)
+{
+    QString artifact = TargetDir(target) + slot + "/artifact";
+    QString version = SlotVersion(target, slot);
+    QString hook = TargetDir(target) + "activate.sh";
+    if (!IsValidVersion(version))
+    {
+        error = "invalid version in " + slot;
+        return false;
+    }
+
+    if (!QFile::exists(hook))
+    {
+        error = "no activation hook " + hook;
+        return false;
+    }
+    std::string cmd = "sh " + hook.toStdString() + " " + artifact.toStdString() + " " + version.toStdString();
+    qDebug() << __func__ << __LINE__ << " cmd : " << QString::fromStdString(cmd);
+    if (system(cmd.c_str()) != 0)
+    {
+        error = "activation of " + target + " " + version + " failed";
+        return false;
+    }
+    return true;
+}
+
+bool SwUpdate::ApplyDelta(const QString &basePath, const QString &patchPath, const QString &outPath,
+                          const QString &sha256, QString &error)
+{
+    QFile base(basePath);
+    QFile patch(patchPath);
+    QFile out(outPath);
+    if (!base.open(QIODevice::ReadOnly) || !patch.open(QIODevice::ReadOnly) ||
+        !out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        error = "cannot open base, patch or output file";
+        return false;
+    }
+    // the base artifact is the dictionary of the patch; map it instead of reading it
+    uchar *baseData = base.size() > 0 ? base.map(0, base.size()) : nullptr;
+    if (base.size() > 0 && !baseData)
+    {
+        error = "cannot map " + basePath;
+        return false;
+    }
+
+    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+    ZSTD_DCtx_setParameter(dctx, ZSTD_d_windowLogMax, kMaxWindowLog);
+    ZSTD_DCtx_refPrefix(dctx, baseData, base.size());
+
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    std::vector<char> inBuf(ZSTD_DStreamInSize());
+    std::vector<char> outBuf(ZSTD_DStreamOutSize());
+    size_t ret = 1;
+    bool ok = true;
+    while (ok)
+    {
+        qint64 n = patch.read(inBuf.data(), inBuf.size());
+        if (n <= 0)
+        {
+            if (n < 0)
+            {
+                error = patch.errorString();
+                ok = false;
+            }
+            break;
+        }
+        ZSTD_inBuffer in = {inBuf.data(), (size_t)n, 0};
+        while (ok && in.pos < in.size)
+        {
+            ZSTD_outBuffer o = {outBuf.data(), outBuf.size(), 0};
+            ret = ZSTD_decompressStream(dctx, &o, &in);
+            if (ZSTD_isError(ret))
+            {
+                error = QString("zstd: ") + ZSTD_getErrorName(ret);
+                ok = false;
+                break;
+            }
+            hash.addData(QByteArray::fromRawData(outBuf.data(), o.pos));
+            if (out.write(outBuf.data(), o.pos) != (qint64)o.pos)
+            {
+                error = out.errorString();
+                ok = false;
+            }
+        }
+    }
+    ZSTD_freeDCtx(dctx);
+    base.unmap(baseData);
+
+    if (ok && ret != 0)
+    {
+        error = "patch is truncated";
+        ok = false;
+    }
+    if (ok && QString::fromLatin1(hash.result().toHex()) != sha256.toLower())
+    {
+        error = "sha256 mismatch after applying the patch";
+        ok = false;
+    }
+    out.flush();
+    fsync(out.handle());
+    out.close();
+    if (!ok)
+        QFile::remove(outPath);
+    return ok;
+}
+
+void SwUpdate::RequestUpdate(const QString &target, const QString &type, const QString &version, const QString &baseVersion,
+                             const QString &url, const QString &patchSha256, const QString &sha256)
+{
+    Request req;
+    req.target = target;
+    req.type = type;
+    req.version = version;
+    req.baseVersion = baseVersion;
+    req.sha256 = sha256;
+
+    if (!IsValidTarget(target) || !IsValidVersion(version) || url.isEmpty() || sha256.isEmpty())
+    {
+        Q_EMIT finished(target, version, false, "invalid update request");
+        return;
+    }
+    if (!IsConfirmableTarget(target))
+    {
+        // it would never be committed nor rolled back
+        Q_EMIT finished(target, version, false, "updates of " + target + " cannot be confirmed, not supported");
+        return;
+    }
+    if (!QFile::exists(TargetDir(target) + "activate.sh"))
+    {
+        // restarting a container keeps its image, only the hook can run the new one
+        Q_EMIT finished(target, version, false, "no activation hook for " + target + ", not supported");
+        return;
+    }
+    if (m_busy || !dreamOsPatchUpdateMutex.tryLock())
+    {
+        Q_EMIT finished(target, version, false, "another update is in progress");
+        return;
+    }
+    m_busy = true;
+    m_req = req;
+
+    QString currentVersion = SlotVersion(target, CurrentSlot(target));
+    if (type == "delta" && currentVersion != baseVersion)
+    {
+        FinishUpdate(req, false, "base version mismatch (current: '" + currentVersion + "'), a full update is required");
+        return;
+    }
+    if (currentVersion == version)
+    {
+        FinishUpdate(req, true, version + " is already installed");
+        return;
+    }
+
+    // a delta is verified after it was applied; a full artifact by the downloader
+    QString fileName = target + "_" + version + ((type == "delta") ? ".patch.zst" : ".artifact");
+    QDir().mkpath(m_patchDir);
+    m_downloader->enqueue(target, url, fileName, (type == "delta") ? patchSha256 : sha256);
+}
+
+void SwUpdate::OnDownloadProgress(const QString &id, const QString &fileName, qint64 received, qint64 total)
+{
+    Q_EMIT progress(id, received, total);
+}
+
+void SwUpdate::OnDownloadFinished(const QString &id, const QString &fileName, bool ok, const QString &filePath, const QString &error)
+{
+    if (!m_busy || id != m_req.target)
+        return;
+    if (!ok)
+    {
+        FinishUpdate(m_req, false, "download failed: " + error);
+        return;
+    }
+    ApplyAndSwitch(m_req, filePath);
+}
+
+void SwUpdate::ApplyAndSwitch(const Request &req, const QString &downloaded)
+{
+    QThread *worker = QThread::create([this, req, downloaded]() {
+        QString error;
+        QString currentSlot = CurrentSlot(req.target);
+        QString newSlot = OtherSlot(currentSlot);
+        QString slotDir = TargetDir(req.target) + newSlot + "/";
+        QDir(slotDir).removeRecursively();
+        QDir().mkpath(slotDir);
+
+        bool ok = true;
+        if (req.type == "delta")
+        {
+            ok = ApplyDelta(TargetDir(req.target) + currentSlot + "/artifact", downloaded, slotDir + "artifact", req.sha256, error);
+            QFile::remove(downloaded);
+        }
+        else if (!QFile::rename(downloaded, slotDir + "artifact"))
+        {
+            error = "cannot move the artifact into " + newSlot;
+            ok = false;
+        }
+        ok = ok && (FileUtils::WriteFile(slotDir + "version", req.version) >= 0);
+
+        if (ok)
+        {
+            // remember where to go back to before anything is switched
+            QJsonObject pending;
+            pending["version"] = req.version;
+            pending["previous"] = currentSlot;
+            pending["boots"] = 0;
+            FileUtils::WriteFile(TargetDir(req.target) + "pending", QString(QJsonDocument(pending).toJson()));
+
+            ok = SwitchSlot(req.target, newSlot, error) && Activate(req.target, newSlot, error);
+            if (!ok && !currentSlot.isEmpty())
+            {
+                QString rollbackError;
+                SwitchSlot(req.target, currentSlot, rollbackError);
+                QFile::remove(TargetDir(req.target) + "pending");
+                Activate(req.target, currentSlot, rollbackError);
+            }
+        }
+
+        QString log = ok ? (req.target + " " + req.version + " activated in " + newSlot) : error;
+        QMetaObject::invokeMethod(this, [this, req, ok, log]() {
+            FinishUpdate(req, ok, log);
+        }, Qt::QueuedConnection);
+    });
+    connect(worker, &QThread::finished, worker, &QObject::deleteLater);
+    worker->start();
+}
+
+void SwUpdate::FinishUpdate(const Request &req, bool ok, const QString &log)
+{
+    qDebug() << __func__ << __LINE__ << " : " << req.target << " " << req.version << " : " << log;
+    m_busy = false;
+    dreamOsPatchUpdateMutex.unlock();
+    Q_EMIT finished(req.target, req.version, ok, log);
+}
+
+void SwUpdate::Rollback(const QString &target)
+{
+    if (!IsValidTarget(target))
+    {
+        Q_EMIT finished(target, QString(), false, "invalid rollback request");
+        return;
+    }
+    QString currentSlot = CurrentSlot(target);
+    QString previousSlot = OtherSlot(currentSlot);
+    Request req;
+    req.target = target;
+    req.type = "rollback";
+    req.version = SlotVersion(target, previousSlot);
+    if (currentSlot.isEmpty() || req.version.isEmpty())
+    {
+        Q_EMIT finished(target, req.version, false, "no previous version to roll back to");
+        return;
+    }
+    if (m_busy || !dreamOsPatchUpdateMutex.tryLock())
+    {
+        Q_EMIT finished(target, req.version, false, "another update is in progress");
+        return;
+    }
+    m_busy = true;
+
+    QThread *worker = QThread::create([this, req, previousSlot]() {
+        QString error;
+        // activating dk_manager restarts this process, nothing after it may be needed
+        bool ok = SwitchSlot(req.target, previousSlot, error);
+        QFile::remove(TargetDir(req.target) + "pending");
+        ok = ok && Activate(req.target, previousSlot, error);
+        QString log = ok ? ("rolled back to " + req.version) : error;
+        QMetaObject::invokeMethod(this, [this, req, ok, log]() {
+            FinishUpdate(req, ok, log);
+        }, Qt::QueuedConnection);
+    });
+    connect(worker, &QThread::finished, worker, &QObject::deleteLater);
+    worker->start();
+}
+
+void SwUpdate::Commit(const QString &target, const QString &runningVersion)
+{
+    QString pendingFile = TargetDir(target) + "pending";
+    if (!IsValidTarget(target) || !QFile::exists(pendingFile))
+        return;
+
+    QJsonObject pending = QJsonDocument::fromJson(FileUtils::ReadFile(pendingFile).toUtf8()).object();
+    QString version = pending.value("version").toString();
+    if (version != runningVersion)
+    {
+        qDebug() << __func__ << __LINE__ << " : " << target << " " << version << " is pending, running " << runningVersion;
+        return;
+    }
+    if (QFile::remove(pendingFile))
+    {
+        qDebug() << __func__ << __LINE__ << " : " << target << " " << version << " committed";
+        Q_EMIT finished(target, version, true, target + " " + version + " committed");
+    }
+}
+
+void SwUpdate::CheckPendingUpdates()
+{
+    const QStringList targets = QDir(m_rootDir).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &target : targets)
+    {
+        if (IsValidTarget(target) && QFile::exists(TargetDir(target) + "pending"))
+            CheckPendingUpdate(target);
+    }
+}
+
+void SwUpdate::CheckPendingUpdate(const QString &target)
+{
+    QString pendingFile = TargetDir(target) + "pending";
+    if (!QFile::exists(pendingFile))
+        return;
+
+    QJsonObject pending = QJsonDocument::fromJson(FileUtils::ReadFile(pendingFile).toUtf8()).object();
+    int boots = pending.value("boots").toInt() + 1;
+    qDebug() << __func__ << __LINE__ << " : " << target << " " << pending.value("version").toString() << " boot " << boots;
+    if (boots < kMaxPendingBoots && IsConfirmableTarget(target))
+    {
+        pending["boots"] = boots;
+        FileUtils::WriteFile(pendingFile, QString(QJsonDocument(pending).toJson()));
+        return;
+    }
+
+    // the new version never reached the server, or nothing can tell whether it works;
+    // go back to the previous slot. Activating dk_manager restarts this process, so the
+    // marker goes before that; switching again after a restart in between is harmless.
+    QString previousSlot = pending.value("previous").toString();
+    QString error;
+    if (previousSlot.isEmpty() || !SwitchSlot(target, previousSlot, error))
+    {
+        qDebug() << __func__ << __LINE__ << " : " << target << " rollback failed " << error;
+        QFile::remove(pendingFile);
+        return;
+    }
+    QFile::remove(pendingFile);
+    sync();
+    if (Activate(target, previousSlot, error))
+        qDebug() << __func__ << __LINE__ << " : " << target << " rolled back to " << SlotVersion(target, previousSlot);
+    else
+        qDebug() << __func__ << __LINE__ << " : " << target << " rollback failed " << error;
+}
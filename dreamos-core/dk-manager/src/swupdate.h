@@ -0,0 +1,77 @@
+#ifndef SWUPDATE_H
+#define SWUPDATE_H
+
+#include <QObject>
+#include <QString>
+#include "dk_downloader.h"
+
+// A/B software update of a target (e.g. "dk_manager") from a full artifact or
+// from a binary delta created with 'zstd --patch-from=<base> <new>'.
+//
+// <DK_SWUPDATE_DIR>/<target>/
+//     slot_a/, slot_b/     artifact (e.g. a 'docker save' tarball) and its version
+//     current -> slot_x    switched atomically once the new artifact is verified
+//     pending              written when a new slot is activated, removed by Commit()
+//     activate.sh          hook which runs the artifact, called as
+//                          'activate.sh <artifact> <version>'; without it an update is
+//                          refused (installed for dk_manager by dk_install.sh)
+class SwUpdate : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SwUpdate(const QString &rootDir, const QString &patchDir, QObject *parent = nullptr);
+
+    // called once at start-up, for every target with a pending update: an update that
+    // did not reach Commit() within kMaxPendingBoots starts is rolled back, one of a
+    // target which cannot confirm it right away.
+    void CheckPendingUpdates();
+
+    static bool ApplyDelta(const QString &basePath, const QString &patchPath, const QString &outPath,
+                           const QString &sha256, QString &error);
+
+public Q_SLOTS:
+    // type: "delta" (baseVersion must be the version in the current slot) or "full"
+    void RequestUpdate(const QString &target, const QString &type, const QString &version, const QString &baseVersion,
+                       const QString &url, const QString &patchSha256, const QString &sha256);
+    void Rollback(const QString &target);
+    // keeps the pending version, if 'runningVersion' is that version: the process which
+    // installed the update is still running the previous one until it is restarted
+    void Commit(const QString &target, const QString &runningVersion);
+
+Q_SIGNALS:
+    void progress(const QString &target, qint64 received, qint64 total);
+    void finished(const QString &target, const QString &version, bool ok, const QString &log);
+
+private Q_SLOTS:
+    void OnDownloadFinished(const QString &id, const QString &fileName, bool ok, const QString &filePath, const QString &error);
+    void OnDownloadProgress(const QString &id, const QString &fileName, qint64 received, qint64 total);
+
+private:
+    struct Request
+    {
+        QString target;
+        QString type;
+        QString version;
+        QString baseVersion;
+        QString sha256;
+    };
+
+    void CheckPendingUpdate(const QString &target);
+    QString TargetDir(const QString &target) const;
+    QString CurrentSlot(const QString &target) const;
+    QString SlotVersion(const QString &target, const QString &slot) const;
+    static QString OtherSlot(const QString &slot);
+    bool SwitchSlot(const QString &target, const QString &slot, QString &error);
+    bool Activate(const QString &target, const QString &slot, QString &error);
+    void ApplyAndSwitch(const Request &req, const QString &downloaded);
+    void FinishUpdate(const Request &req, bool ok, const QString &log);
+
+    QString m_rootDir;
+    QString m_patchDir;
+    DkDownloader *m_downloader;
+    Request m_req;
+    bool m_busy = false;
+};
+
+#endif // SWUPDATE_H
@@ -7,12 +7,23 @@
 #include "vcuorchestrator.hpp"
 #include <fstream>
 #include <sstream>
+#include <future>
+#include <chrono>
+#include <algorithm>
+#include <memory>
 
 #define BIND_EVENT(IO, EV, FN) \
     IO->on(EV, FN)
 
 #define kURL "https://127.0.0.1:39562"
 
+// Files above this size are sent as "file_chunk_to_zonecontroller" chunks on the bulk lane,
+// to zone controllers that support them.
+#define kBulkChunkSize (64 * 1024)
+// The relay acks intermediate chunks right away and the last chunk after the zone
+// controllers answered (or its own 5 s timeout); do not stall the bulk lane forever.
+#define kBulkAckTimeoutMs 8000
+
 DkOrchestrator::DkOrchestrator() : _io(new client())
 {
     std::cout << __func__ << __LINE__ << " : setup socket.io\n";
@@ -28,6 +39,8 @@ DkOrchestrator::DkOrchestrator() : _io(new client())
     _io->set_socket_open_listener(std::bind(&DkOrchestrator::OnConnected, this, std::placeholders::_1));
     _io->set_close_listener(std::bind(&DkOrchestrator::OnClosed, this, _1));
     _io->set_fail_listener(std::bind(&DkOrchestrator::OnFailed, this));
+
+    m_senderThread = std::thread(&DkOrchestrator::SenderLoop, this);
 }
 
 void DkOrchestrator::UpdateServerConnectionStatus(bool status)
@@ -41,49 +54,445 @@ void DkOrchestrator::UpdateServerConnectionStatus(bool status)
     message::ptr dataObj = obj->get_map()["data"];
     dataObj->get_map()["cmd"] = string_message::create("server_connection_status");
     dataObj->get_map()["status"] = bool_message::create(status);
-    _io->socket()->emit("send_cmd", obj);
+    Enqueue(LANE_CONTROL, obj);
 }
 
-void DkOrchestrator::SendCmd(std::string dest, std::string data)
+message::ptr DkOrchestrator::CreateCmdMessage(const std::string &dest, const std::string &data)
 {
-    // send command to zonecontroller
     message::ptr obj = object_message::create();
     obj->get_map()["source"] = string_message::create("vcu");
     obj->get_map()["dest"] = string_message::create(dest);
+    obj->get_map()["confirm"] = bool_message::create(ZoneHasCapability(dest, kZoneCapAck));
     obj->get_map()["data"] = object_message::create();
     message::ptr dataObj = obj->get_map()["data"];
     dataObj->get_map()["cmd"] = string_message::create(data);
-    _io->socket()->emit("send_cmd", obj);
+    return obj;
 }
 
-void DkOrchestrator::SendFile(std::string dest, std::string filePath)
+std::vector<message::ptr> DkOrchestrator::CreateFileMessages(const std::string &dest, const std::string &filePath)
 {
-    // send file to zonecontroller
     std::string fileName = filePath.substr(filePath.find_last_of("/\\") + 1);
 
-    std::ifstream t(filePath);
+    std::ifstream t(filePath, std::ios::binary);
     std::stringstream buffer;
     buffer << t.rdbuf();
     std::string content = buffer.str();
 
-    message::ptr obj = object_message::create();
-    obj->get_map()["source"] = string_message::create("vcu");
-    obj->get_map()["dest"] = string_message::create(dest);
-    obj->get_map()["data"] = object_message::create();
-    message::ptr dataObj = obj->get_map()["data"];
-    dataObj->get_map()["cmd"] = string_message::create("file_to_zonecontroller");
-    dataObj->get_map()["fileName"] = string_message::create(fileName);
-    dataObj->get_map()["content"] = string_message::create(content);
-    _io->socket()->emit("send_cmd", obj);
+    std::vector<message::ptr> msgs;
+    if (content.size() <= kBulkChunkSize || !ZoneHasCapability(dest, kZoneCapFileChunk))
+    {
+        // small artifacts, and every artifact for a zone controller which cannot
+        // reassemble chunks, keep the single message format
+        message::ptr obj = object_message::create();
+        obj->get_map()["source"] = string_message::create("vcu");
+        obj->get_map()["dest"] = string_message::create(dest);
+        obj->get_map()["confirm"] = bool_message::create(ZoneHasCapability(dest, kZoneCapAck));
+        obj->get_map()["data"] = object_message::create();
+        message::ptr dataObj = obj->get_map()["data"];
+        dataObj->get_map()["cmd"] = string_message::create("file_to_zonecontroller");
+        dataObj->get_map()["fileName"] = string_message::create(fileName);
+        dataObj->get_map()["content"] = string_message::create(content);
+        msgs.push_back(obj);
+        return msgs;
+    }
+
+    uint64_t transferId = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_lanesMtx);
+        transferId = ++m_transferId;
+    }
+    int count = (content.size() + kBulkChunkSize - 1) / kBulkChunkSize;
+    for (int index = 0; index < count; index++)
+    {
+        size_t offset = (size_t)index * kBulkChunkSize;
+        message::ptr obj = object_message::create();
+        obj->get_map()["source"] = string_message::create("vcu");
+        obj->get_map()["dest"] = string_message::create(dest);
+        obj->get_map()["confirm"] = bool_message::create(ZoneHasCapability(dest, kZoneCapAck));
+        obj->get_map()["data"] = object_message::create();
+        message::ptr dataObj = obj->get_map()["data"];
+        dataObj->get_map()["cmd"] = string_message::create("file_chunk_to_zonecontroller");
+        dataObj->get_map()["fileName"] = string_message::create(fileName);
+        dataObj->get_map()["transferId"] = int_message::create(transferId);
+        dataObj->get_map()["offset"] = int_message::create(offset);
+        dataObj->get_map()["totalSize"] = int_message::create(content.size());
+        dataObj->get_map()["index"] = int_message::create(index);
+        dataObj->get_map()["count"] = int_message::create(count);
+        dataObj->get_map()["content"] = binary_message::create(std::make_shared<const std::string>(content.substr(offset, kBulkChunkSize)));
+        msgs.push_back(obj);
+    }
+    return msgs;
+}
+
+static std::string MessageDest(const message::ptr &msg)
+{
+    message::ptr dest = msg->get_map()["dest"];
+    return (dest && dest->get_flag() == message::flag_string) ? dest->get_string() : std::string();
+}
+
+void DkOrchestrator::Enqueue(OrchestratorLane lane, const message::ptr &msg, const AckCallback &ack)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lanesMtx);
+        OutboundMessage out;
+        out.msg = msg;
+        out.dest = MessageDest(msg);
+        out.ack = ack;
+        out.enqueued = std::chrono::steady_clock::now();
+        if (lane == LANE_BULK)
+            m_bulkPending[out.dest]++;
+        m_lanes[lane].push_back(out);
+    }
+    m_lanesCv.notify_all();
+}
+
+void DkOrchestrator::EnqueueFile(const std::string &dest, const std::string &filePath, const AckCallback &ack)
+{
+    std::vector<message::ptr> msgs = CreateFileMessages(dest, filePath);
+    {
+        // enqueue all chunks at once so that files do not interleave with each other
+        std::lock_guard<std::mutex> lock(m_lanesMtx);
+        auto now = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < msgs.size(); i++)
+        {
+            OutboundMessage out;
+            out.msg = msgs[i];
+            out.dest = dest;
+            if (i + 1 == msgs.size())
+                out.ack = ack;
+            out.enqueued = now;
+            m_bulkPending[dest]++;
+            m_lanes[LANE_BULK].push_back(out);
+        }
+    }
+    m_lanesCv.notify_all();
+}
+
+void DkOrchestrator::SenderLoop()
+{
+    std::unique_lock<std::mutex> lock(m_lanesMtx);
+    while (!m_stopSender)
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (m_bulkInFlight && (now - m_bulkSentAt) > std::chrono::milliseconds(kBulkAckTimeoutMs))
+        {
+            std::cout << __func__ << __LINE__ << " : bulk chunk not acknowledged, continue\n";
+            BulkDone(m_bulkSeq);
+        }
+
+        // control first; at most one bulk chunk on the wire at a time, so a command
+        // never queues behind more than one chunk in the socket. A command to a
+        // destination whose files are not through yet waits for them, e.g.
+        // start_kuksa_feeder_script for the artifacts it runs.
+        auto &control = m_lanes[LANE_CONTROL];
+        auto next = std::find_if(control.begin(), control.end(), [this](const OutboundMessage &m) {
+            return m_bulkPending.find(m.dest) == m_bulkPending.end();
+        });
+        int lane = LANE_COUNT;
+        if (next != control.end())
+            lane = LANE_CONTROL;
+        else if (!m_lanes[LANE_BULK].empty() && !m_bulkInFlight)
+            lane = LANE_BULK;
+
+        if (lane == LANE_COUNT)
+        {
+            m_lanesCv.wait_for(lock, std::chrono::milliseconds(100));
+            continue;
+        }
+
+        OutboundMessage out;
+        if (lane == LANE_CONTROL)
+        {
+            out = *next;
+            control.erase(next);
+        }
+        else
+        {
+            out = m_lanes[lane].front();
+            m_lanes[lane].pop_front();
+        }
+
+        LaneStats &stats = m_laneStats[lane];
+        double delayMs = std::chrono::duration<double, std::milli>(now - out.enqueued).count();
+        stats.sent++;
+        stats.lastDelayMs = delayMs;
+        stats.avgDelayMs += (delayMs - stats.avgDelayMs) / stats.sent;
+        stats.maxDelayMs = std::max(stats.maxDelayMs, delayMs);
+
+        AckCallback ack = out.ack;
+        if (lane == LANE_BULK)
+        {
+            m_bulkInFlight = true;
+            m_bulkSentAt = now;
+            m_bulkInFlightDest = out.dest;
+            uint64_t seq = ++m_bulkSeq;
+            AckCallback userAck = out.ack;
+            ack = [this, userAck, seq](message::list const &resp) {
+                {
+                    std::lock_guard<std::mutex> guard(m_lanesMtx);
+                    BulkDone(seq);
+                }
+                m_lanesCv.notify_all();
+                if (userAck)
+                    userAck(resp);
+            };
+        }
+
+        lock.unlock();
+        if (ack)
+            _io->socket()->emit("send_cmd", out.msg, ack);
+        else
+            _io->socket()->emit("send_cmd", out.msg);
+        lock.lock();
+    }
+}
+
+void DkOrchestrator::BulkDone(uint64_t seq)
+{
+    // a late ack of a message that already timed out was counted then
+    if (!m_bulkInFlight || seq != m_bulkSeq)
+        return;
+    m_bulkInFlight = false;
+    auto it = m_bulkPending.find(m_bulkInFlightDest);
+    if (it != m_bulkPending.end() && --it->second <= 0)
+        m_bulkPending.erase(it);
+}
+
+LaneStats DkOrchestrator::GetLaneStats(OrchestratorLane lane) const
+{
+    std::lock_guard<std::mutex> lock(m_lanesMtx);
+    LaneStats stats = m_laneStats[lane];
+    stats.pending = m_lanes[lane].size();
+    return stats;
+}
+
+bool ZoneController::OwnsCanChannel(const std::string &channel) const
+{
+    if (canChannels.empty())
+        return true;
+    return std::find(canChannels.begin(), canChannels.end(), channel) != canChannels.end();
+}
+
+bool ZoneController::HasCapability(const std::string &capability) const
+{
+    return std::find(capabilities.begin(), capabilities.end(), capability) != capabilities.end() ||
+           std::find(advertised.begin(), advertised.end(), capability) != advertised.end();
+}
+
+void DkOrchestrator::RegisterZoneController(const ZoneController &zone)
+{
+    std::lock_guard<std::mutex> lock(m_zonesMtx);
+    for (auto &z : m_zones)
+    {
+        if (z.name == zone.name)
+        {
+            // the configuration changed, what the zone controller advertised did not
+            std::vector<std::string> advertised = z.advertised;
+            z = zone;
+            z.advertised = advertised;
+            return;
+        }
+    }
+    m_zones.push_back(zone);
+    std::cout << __func__ << " : " << zone.name << " (" << zone.canChannels.size() << " CAN channels)\n";
+}
+
+void DkOrchestrator::SetZoneAdvertised(const std::string &name, const std::vector<std::string> &advertised)
+{
+    std::lock_guard<std::mutex> lock(m_zonesMtx);
+    for (auto &z : m_zones)
+    {
+        if (z.name == name)
+        {
+            z.advertised = advertised;
+            std::cout << __func__ << " : " << name << " advertises " << advertised.size() << " capabilities\n";
+            return;
+        }
+    }
+    std::cout << __func__ << " : " << name << " is not a configured zone controller, ignored\n";
+}
+
+bool DkOrchestrator::ZoneHasCapability(const std::string &dest, const std::string &capability) const
+{
+    std::lock_guard<std::mutex> lock(m_zonesMtx);
+    for (const auto &z : m_zones)
+    {
+        if (z.name == dest)
+            return z.HasCapability(capability);
+    }
+    return false;
+}
+
+void DkOrchestrator::ClearZoneControllers()
+{
+    std::lock_guard<std::mutex> lock(m_zonesMtx);
+    m_zones.clear();
+}
+
+std::vector<ZoneController> DkOrchestrator::GetZoneControllers(const std::string &capability) const
+{
+    std::lock_guard<std::mutex> lock(m_zonesMtx);
+    std::vector<ZoneController> zones;
+    for (const auto &z : m_zones)
+    {
+        if (capability.empty() || z.HasCapability(capability))
+            zones.push_back(z);
+    }
+    return zones;
+}
+
+std::vector<ZoneResult> DkOrchestrator::SendCmdToZones(const std::string &data, const std::string &capability, int timeoutMs)
+{
+    std::vector<std::string> dests;
+    for (const auto &z : GetZoneControllers(capability))
+        dests.push_back(z.name);
+
+    return FanOut(dests, [this, data](const std::string &dest, const AckCallback &ack) {
+        Enqueue(LANE_CONTROL, CreateCmdMessage(dest, data), ack);
+        return 1;
+    }, timeoutMs);
+}
+
+std::vector<ZoneResult> DkOrchestrator::SendFilesToZones(const std::map<std::string, std::vector<std::string>> &filesPerZone, int timeoutMs)
+{
+    std::vector<std::string> dests;
+    for (const auto &kv : filesPerZone)
+        dests.push_back(kv.first);
+
+    return FanOut(dests, [this, &filesPerZone](const std::string &dest, const AckCallback &ack) {
+        int count = 0;
+        for (const auto &filePath : filesPerZone.at(dest))
+        {
+            EnqueueFile(dest, filePath, ack);
+            count++;
+        }
+        return count;
+    }, timeoutMs);
+}
+
+namespace {
+// Shared between FanOut() and the ack callbacks, which may fire after the deadline.
+struct FanOutState
+{
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::map<std::string, ZoneResult> results;
+    int outstanding = 0;
+};
+}
+
+std::vector<ZoneResult> DkOrchestrator::FanOut(const std::vector<std::string> &dests,
+                                               const std::function<int(const std::string &, const AckCallback &)> &enqueue,
+                                               int timeoutMs)
+{
+    auto state = std::make_shared<FanOutState>();
+    for (const auto &dest : dests)
+    {
+        state->results[dest].dest = dest;
+    }
+
+    // build (e.g. read the artifacts) and enqueue for every zone controller in parallel;
+    // the sender thread interleaves them according to their lane.
+    std::vector<std::future<void>> workers;
+    for (const auto &dest : dests)
+    {
+        workers.push_back(std::async(std::launch::async, [state, dest, &enqueue]() {
+            {
+                // the ack may fire before enqueue() returns, count it as outstanding first
+                std::lock_guard<std::mutex> lock(state->mtx);
+                state->outstanding += 1;
+            }
+            int sent = enqueue(dest, [state, dest](message::list const &ack) {
+                std::lock_guard<std::mutex> lock(state->mtx);
+                ZoneResult &r = state->results[dest];
+                int delivered = 0;
+                bool relayed = false;
+                if (ack.size() > 0 && ack[0]->get_flag() == message::flag_object)
+                {
+                    message::ptr delivery = ack[0]->get_map()["delivered"];
+                    if (delivery && delivery->get_flag() == message::flag_integer)
+                        delivered = delivery->get_int();
+                    message::ptr relayedMsg = ack[0]->get_map()["relayed"];
+                    if (relayedMsg && relayedMsg->get_flag() == message::flag_boolean)
+                        relayed = relayedMsg->get_bool();
+                }
+                if (delivered > 0)
+                    r.acked++;
+                else if (relayed)
+                    r.unconfirmed++;  // the zone controller does not ack, the relay forwarded it
+                state->outstanding--;
+                state->cv.notify_all();
+            });
+            std::lock_guard<std::mutex> lock(state->mtx);
+            state->results[dest].sent = sent;
+            state->outstanding += sent - 1;
+            state->cv.notify_all();
+        }));
+    }
+    for (auto &w : workers)
+    {
+        w.wait();
+    }
+
+    // a single deadline for the whole fan-out
+    std::unique_lock<std::mutex> lock(state->mtx);
+    state->cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [state]() { return state->outstanding <= 0; });
+
+    std::vector<ZoneResult> results;
+    for (const auto &dest : dests)
+    {
+        ZoneResult r = state->results[dest];
+        r.success = (r.sent > 0) && (r.acked + r.unconfirmed == r.sent);
+        r.detail = std::to_string(r.acked) + "/" + std::to_string(r.sent) + " acknowledged";
+        if (r.unconfirmed > 0)
+            r.detail += ", " + std::to_string(r.unconfirmed) + " delivered unconfirmed";
+        results.push_back(r);
+    }
+    return results;
 }
 
 void DkOrchestrator::OnVcuRrchestratorHandler(std::string const &name, message::ptr const &data, bool hasAck, message::list &ack_resp)
 {
     std::cout << __func__ << __LINE__ << "\n";
+    if (!data || data->get_flag() != message::flag_object)
+        return;
+
+    message::ptr cmd = data->get_map()["cmd"];
+    message::ptr zoneName = data->get_map()["name"];
+    if (!cmd || cmd->get_flag() != message::flag_string || !zoneName || zoneName->get_flag() != message::flag_string)
+        return;
+
+    // the relay reports zone controllers registering and going away
+    if (cmd->get_string() == "register_zonecontroller")
+    {
+        std::vector<std::string> advertised;
+        message::ptr caps = data->get_map()["capabilities"];
+        if (caps && caps->get_flag() == message::flag_array)
+        {
+            for (const auto &cap : caps->get_vector())
+            {
+                if (cap && cap->get_flag() == message::flag_string)
+                    advertised.push_back(cap->get_string());
+            }
+        }
+        SetZoneAdvertised(zoneName->get_string(), advertised);
+    }
+    else if (cmd->get_string() == "unregister_zonecontroller")
+    {
+        SetZoneAdvertised(zoneName->get_string(), std::vector<std::string>());
+    }
 }
 
 DkOrchestrator::~DkOrchestrator()
 {
+    {
+        std::lock_guard<std::mutex> lock(m_lanesMtx);
+        m_stopSender = true;
+    }
+    m_lanesCv.notify_all();
+    if (m_senderThread.joinable())
+        m_senderThread.join();
+
     _io->socket()->off_all();
     _io->socket()->off_error();
 }
@@ -2,19 +2,94 @@
 #define DK_VCUORCHESTRATOR_H
 
 #include <sio_client.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 using namespace sio;
 
+// Protocol features a zone controller advertises when it registers with the relay
+// ("register_zonecontroller"). A zone controller that did not register is a legacy one:
+// it does not confirm messages and only understands whole files.
+#define kZoneCapAck "ack"
+#define kZoneCapFileChunk "file_chunk"
+
+// A zone ECU reachable through the orchestrator relay. 'name' is the socket.io
+// destination the zone controller listens on; an empty canChannels list means the
+// controller owns every CAN channel. 'capabilities' come from dk_system_cfg.json,
+// 'advertised' from the zone controller's registration.
+struct ZoneController
+{
+    std::string name;
+    std::vector<std::string> canChannels;
+    std::vector<std::string> capabilities;
+    std::vector<std::string> advertised;
+
+    bool OwnsCanChannel(const std::string &channel) const;
+    bool HasCapability(const std::string &capability) const;
+};
+
+// Outcome of a fan-out for one zone controller: how many of the messages sent to it
+// were confirmed by the zone controller before the deadline. Messages to a zone
+// controller that does not ack count as unconfirmed once the relay forwarded them.
+struct ZoneResult
+{
+    std::string dest;
+    bool success = false;
+    int sent = 0;
+    int acked = 0;
+    int unconfirmed = 0;
+    std::string detail;
+};
+
+// Outbound priority lanes on the orchestrator socket. Control messages are always
+// emitted before bulk data; files to zone controllers advertising kZoneCapFileChunk
+// are split into chunks so that a control message waits for at most one chunk.
+enum OrchestratorLane
+{
+    LANE_CONTROL = 0,
+    LANE_BULK,
+    LANE_COUNT
+};
+
+// Queueing delay = time from enqueue until the message is handed to the socket.
+struct LaneStats
+{
+    uint64_t sent = 0;
+    uint64_t pending = 0;
+    double lastDelayMs = 0;
+    double avgDelayMs = 0;
+    double maxDelayMs = 0;
+};
+
 class DkOrchestrator
 {
 public:
     explicit DkOrchestrator();
     ~DkOrchestrator();
     void Start();
-    void SendCmd(std::string dest, std::string data);
-    void SendFile(std::string dest, std::string filePath);
     void UpdateServerConnectionStatus(bool status);
 
+    // zone controller registry
+    void RegisterZoneController(const ZoneController &zone);
+    void ClearZoneControllers();
+    std::vector<ZoneController> GetZoneControllers(const std::string &capability = "") const;
+
+    // fan-out to all zone controllers (having 'capability' if not empty) concurrently,
+    // wait for their acknowledgements and return one result per zone controller.
+    std::vector<ZoneResult> SendCmdToZones(const std::string &data, const std::string &capability = "", int timeoutMs = 5000);
+    // filesPerZone: zone controller name -> files this zone controller shall receive.
+    std::vector<ZoneResult> SendFilesToZones(const std::map<std::string, std::vector<std::string>> &filesPerZone, int timeoutMs = 10000);
+
+    LaneStats GetLaneStats(OrchestratorLane lane) const;
+
 private:
     void OnVcuRrchestratorHandler(std::string const& name,message::ptr const& data,bool hasAck,message::list &ack_resp);
 
@@ -22,7 +97,55 @@ private:
     void OnClosed(client::close_reason const& reason);
     void OnFailed();
 
+    typedef std::function<void(message::list const &)> AckCallback;
+
+    struct OutboundMessage
+    {
+        message::ptr msg;
+        std::string dest;
+        AckCallback ack;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+
+    // e.g. kZoneCapAck: the zone controller confirms what it receives
+    bool ZoneHasCapability(const std::string &dest, const std::string &capability) const;
+    void SetZoneAdvertised(const std::string &name, const std::vector<std::string> &advertised);
+
+    message::ptr CreateCmdMessage(const std::string &dest, const std::string &data);
+    std::vector<message::ptr> CreateFileMessages(const std::string &dest, const std::string &filePath);
+
+    void Enqueue(OrchestratorLane lane, const message::ptr &msg, const AckCallback &ack = nullptr);
+    // only the last chunk of a file reports to 'ack'
+    void EnqueueFile(const std::string &dest, const std::string &filePath, const AckCallback &ack = nullptr);
+    void SenderLoop();
+    // the in-flight bulk message 'seq' was acked or timed out; m_lanesMtx held
+    void BulkDone(uint64_t seq);
+
+    // 'enqueue' puts the messages for one destination on the lanes, reports each
+    // of them to the given ack callback and returns how many it enqueued.
+    std::vector<ZoneResult> FanOut(const std::vector<std::string> &dests,
+                                   const std::function<int(const std::string &, const AckCallback &)> &enqueue,
+                                   int timeoutMs);
+
     client *_io;
+
+    std::deque<OutboundMessage> m_lanes[LANE_COUNT];
+    LaneStats m_laneStats[LANE_COUNT];
+    mutable std::mutex m_lanesMtx;
+    std::condition_variable m_lanesCv;
+    bool m_bulkInFlight = false;
+    std::chrono::steady_clock::time_point m_bulkSentAt;
+    uint64_t m_bulkSeq = 0;
+    std::string m_bulkInFlightDest;
+    // bulk messages per destination queued or waiting for their ack; control
+    // messages to a destination are held while it has any
+    std::map<std::string, int> m_bulkPending;
+    bool m_stopSender = false;
+    uint64_t m_transferId = 0;
+    std::thread m_senderThread;
+
+    std::vector<ZoneController> m_zones;
+    mutable std::mutex m_zonesMtx;
 };
 
 #endif // DK_VCUORCHESTRATOR_H
@@ -17,17 +17,63 @@ const httpsServer = createServer({
 
 const io = new Server(httpsServer);
 
+// how long the vcu waits for the zone controllers to confirm a command
+const ZONE_ACK_TIMEOUT_MS = 5000
+
+// zone controllers that registered, with the capabilities they advertised
+// (e.g. "ack"); replayed to the vcu whenever it (re)connects
+const zoneControllers = new Map()
+
 io.on("connection", (socket) => {
     console.log("new connection")
+    for (const [name, capabilities] of zoneControllers) {
+        socket.emit("vcu_orchestrator_handler", { cmd: "register_zonecontroller", name: name, capabilities: capabilities })
+    }
+
+    socket.on('register_zonecontroller', (payload, ack) => {
+        if (!payload || typeof payload.name !== "string") return;
+        const capabilities = Array.isArray(payload.capabilities) ? payload.capabilities : []
+        console.log("register_zonecontroller: ", payload.name, capabilities)
+        zoneControllers.set(payload.name, capabilities)
+        socket.zoneName = payload.name
+        socket.broadcast.emit("vcu_orchestrator_handler", { cmd: "register_zonecontroller", name: payload.name, capabilities: capabilities })
+        if (typeof ack === "function") ack({ registered: true })
+    })
+
+    socket.on('disconnect', () => {
+        if (!socket.zoneName) return;
+        zoneControllers.delete(socket.zoneName)
+        socket.broadcast.emit("vcu_orchestrator_handler", { cmd: "unregister_zonecontroller", name: socket.zoneName })
+    })
 
-    socket.on('send_cmd', (payload) => {
+    socket.on('send_cmd', (payload, ack) => {
         if(!payload) return;
         source = payload.source
         dest   = payload.dest
         data   = payload.data
         console.log("send_cmd: ", source, dest, data.cmd)
-        socket.broadcast.emit(dest, {
+        if (typeof ack !== "function") {
+            socket.broadcast.emit(dest, {
+                data: payload.data
+            });
+            return;
+        }
+        if (!payload.confirm || (data.cmd === "file_chunk_to_zonecontroller" && data.index + 1 < data.count)) {
+            // legacy zone controllers never ack, do not wait for them; intermediate
+            // chunks only need to leave the relay, the last chunk is confirmed by the
+            // zone controllers for the whole file
+            socket.broadcast.emit(dest, {
+                data: payload.data
+            });
+            ack({ dest: dest, delivered: -1, relayed: true })
+            return;
+        }
+        // report back to the vcu how many zone controllers confirmed the command
+        socket.broadcast.timeout(ZONE_ACK_TIMEOUT_MS).emit(dest, {
             data: payload.data
+        }, (err, responses) => {
+            responses = responses || []
+            ack({ dest: dest, delivered: responses.length, timeout: !!err, responses: responses })
         });
     })
 });
@@ -0,0 +1,294 @@
+#include "vss_mapping_validator.h"
+#include <QDebug>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMutex>
+#include <QRegularExpression>
+
+static const QSet<QString> kVssDataTypes = {"boolean", "string", "uint8", "int8", "uint16", "int16", "uint32", "int32",
+                                            "uint64", "int64", "float", "double"};
+
+// vss.json is several MB and only changes with a mapping, parse it once per version
+static QMutex vssSpecCacheMutex;
+static QString vssSpecCachePath;
+static QDateTime vssSpecCacheTime;
+static QJsonObject vssSpecCache;
+
+static QJsonObject LoadVssSpec(const QString &path)
+{
+    QMutexLocker locker(&vssSpecCacheMutex);
+    QFileInfo info(path);
+    if (path == vssSpecCachePath && info.lastModified() == vssSpecCacheTime)
+    {
+        return vssSpecCache;
+    }
+    QFile file(path);
+    QJsonObject spec;
+    if (file.open(QIODevice::ReadOnly))
+    {
+        spec = QJsonDocument::fromJson(file.readAll()).object();
+    }
+    vssSpecCachePath = path;
+    vssSpecCacheTime = info.lastModified();
+    vssSpecCache = spec;
+    return spec;
+}
+
+static int BitsOf(const QString &dataType)
+{
+    QRegularExpressionMatch m = QRegularExpression("^u?int(\\d+)$").match(dataType);
+    return m.hasMatch() ? m.captured(1).toInt() : 0;
+}
+
+static QJsonObject Issue(const QString &vss, const QString &message)
+{
+    QJsonObject issue;
+    issue["vss"] = vss;
+    issue["message"] = message;
+    return issue;
+}
+
+VssMappingValidator::VssMappingValidator(const QString &dbcContent, const QString &overlayContent, const QString &vssJsonFile)
+{
+    ParseDbc(dbcContent);
+    ParseOverlay(overlayContent);
+    m_vssSpec = LoadVssSpec(vssJsonFile);
+}
+
+void VssMappingValidator::ParseDbc(const QString &dbcContent)
+{
+    // BO_ 1024 HVAC_Status: 8 ECU
+    //  SG_ Fan_Speed : 8|8@1+ (1,0) [0|255] "" Vector__XXX
+    QRegularExpression messageRe("^BO_\\s+\\d+\\s+(\\w+)\\s*:");
+    QRegularExpression signalRe("^\\s+SG_\\s+(\\w+)\\s*[^:]*:\\s*(\\d+)\\|(\\d+)@[01]([+-])\\s*\\(([^,]+),([^)]+)\\)");
+    QString message;
+    for (const QString &line : dbcContent.split('\n'))
+    {
+        QRegularExpressionMatch m = messageRe.match(line);
+        if (m.hasMatch())
+        {
+            message = m.captured(1);
+            continue;
+        }
+        m = signalRe.match(line);
+        if (m.hasMatch())
+        {
+            Dbc_Signal_Info info;
+            info.message = message;
+            info.startBit = m.captured(2).toInt();
+            info.size = m.captured(3).toInt();
+            info.isSigned = (m.captured(4) == "-");
+            info.isScaled = (m.captured(5).trimmed().toDouble() != (qint64)m.captured(5).trimmed().toDouble()) ||
+                            (m.captured(6).trimmed().toDouble() != (qint64)m.captured(6).trimmed().toDouble());
+            m_dbcSignals.insert(m.captured(1), info);
+        }
+    }
+}
+
+void VssMappingValidator::ParseOverlay(const QString &overlayContent)
+{
+    // "Vehicle.Cabin.Fan:" followed by its attributes; branches have "type: branch"
+    QStringList lines = overlayContent.split('\n');
+    for (int i = 0; i < lines.size(); i++)
+    {
+        const QString &line = lines[i];
+        if (line.isEmpty() || line.at(0).isSpace() || !line.trimmed().endsWith(':'))
+        {
+            continue;
+        }
+        bool isBranch = false;
+        for (int j = i + 1; j < lines.size() && !lines[j].isEmpty() && lines[j].at(0).isSpace(); j++)
+        {
+            if (lines[j].trimmed() == "type: branch")
+            {
+                isBranch = true;
+                break;
+            }
+        }
+        if (!isBranch)
+        {
+            m_overlayLeaves.insert(line.trimmed().chopped(1));
+        }
+    }
+}
+
+QJsonObject VssMappingValidator::SpecLeaf(const QString &vss) const
+{
+    QStringList path = vss.split('.');
+    QJsonObject node = m_vssSpec.value(path.value(0)).toObject();
+    for (int i = 1; i < path.size() && !node.isEmpty(); i++)
+    {
+        node = node.value("children").toObject().value(path[i]).toObject();
+    }
+    return node;
+}
+
+QJsonObject VssMappingValidator::Validate(const QJsonObject &config)
+{
+    QJsonArray errors;
+    QJsonArray warnings;
+    QJsonArray added;
+    QJsonArray updated;
+    QJsonArray deleted;
+    QSet<QString> canChannels;
+    QSet<QString> seen;
+
+    QRegularExpression vssPathRe("^[A-Za-z][A-Za-z0-9_]*(\\.[A-Za-z0-9_]+)+$");
+    for (const auto value : config.value("mappingItems").toArray())
+    {
+        QJsonObject item = value.toObject();
+        QString vss = item.value("vss").toString();
+        QString mappingType = item.value("mappingType").toString();
+        QString dataType = item.value("dataType").toString();
+        QString canSignal = item.value("canSignal").toString();
+        QString canChannel = item.value("canChannel").toString();
+        bool isDeleted = item.value("isDeleted").toBool();
+        if (dataType.isEmpty())
+        {
+            dataType = "boolean"; // same default as VssMappingHandler
+        }
+
+        if (!vssPathRe.match(vss).hasMatch())
+        {
+            errors.append(Issue(vss, "invalid vss path"));
+            continue;
+        }
+        if (seen.contains(vss))
+        {
+            errors.append(Issue(vss, "mapped more than once"));
+            continue;
+        }
+        seen.insert(vss);
+
+        bool isMapped = m_overlayLeaves.contains(vss);
+        if (isDeleted)
+        {
+            if (!isMapped)
+            {
+                errors.append(Issue(vss, "cannot delete, it was never mapped"));
+                continue;
+            }
+            deleted.append(vss);
+            if (!canChannel.isEmpty())
+            {
+                canChannels.insert(canChannel);
+            }
+            continue;
+        }
+
+        if (mappingType != "dbc2vss" && mappingType != "vss2dbc")
+        {
+            warnings.append(Issue(vss, "mapping type '" + mappingType + "' is neither dbc2vss nor vss2dbc, the type becomes 'unknown'"));
+        }
+
+        QString baseType = dataType.endsWith("[]") ? dataType.chopped(2) : dataType;
+        if (!kVssDataTypes.contains(baseType))
+        {
+            errors.append(Issue(vss, "unknown datatype '" + dataType + "'"));
+            continue;
+        }
+
+        // a leaf of the standard spec keeps its datatype; the overlay's own leaves may change theirs
+        QJsonObject leaf = SpecLeaf(vss);
+        if (!leaf.isEmpty() && !isMapped)
+        {
+            QString specType = leaf.value("datatype").toString();
+            if (leaf.value("type").toString() == "branch")
+            {
+                errors.append(Issue(vss, "is a branch in the VSS spec"));
+                continue;
+            }
+            if (!specType.isEmpty() && specType != dataType)
+            {
+                errors.append(Issue(vss, "datatype '" + dataType + "' differs from '" + specType + "' in the VSS spec"));
+                continue;
+            }
+            QString expectedType = (mappingType == "vss2dbc") ? "actuator" : "sensor";
+            QString specKind = leaf.value("type").toString();
+            if (!specKind.isEmpty() && specKind != expectedType)
+            {
+                warnings.append(Issue(vss, "is a " + specKind + " in the VSS spec, the mapping makes it a " + expectedType));
+            }
+        }
+
+        if (!canSignal.isEmpty())
+        {
+            if (!m_dbcSignals.contains(canSignal))
+            {
+                errors.append(Issue(vss, "CAN signal '" + canSignal + "' is not in the dbc"));
+                continue;
+            }
+            if (canChannel.isEmpty())
+            {
+                errors.append(Issue(vss, "CAN signal '" + canSignal + "' has no CAN channel"));
+                continue;
+            }
+            canChannels.insert(canChannel);
+
+            const Dbc_Signal_Info &signal = m_dbcSignals[canSignal];
+            int bits = BitsOf(baseType);
+            if (baseType == "boolean" && signal.size != 1)
+            {
+                warnings.append(Issue(vss, QString("boolean from the %1 bit signal '%2'").arg(signal.size).arg(canSignal)));
+            }
+            else if (bits > 0 && signal.isScaled)
+            {
+                warnings.append(Issue(vss, "integer datatype for the scaled signal '" + canSignal + "', the fraction is lost"));
+            }
+            else if (bits > 0 && !signal.isScaled && signal.size > bits)
+            {
+                warnings.append(Issue(vss, QString("%1 bit signal '%2' does not fit into %3").arg(signal.size).arg(canSignal, dataType)));
+            }
+            else if (baseType.startsWith("uint") && signal.isSigned)
+            {
+                warnings.append(Issue(vss, "unsigned datatype for the signed signal '" + canSignal + "'"));
+            }
+        }
+
+        if (isMapped)
+        {
+            updated.append(vss);
+        }
+        else
+        {
+            added.append(vss);
+        }
+    }
+
+    QStringList channels = canChannels.values();
+    channels.sort();
+    QJsonObject diff;
+    diff["added"] = added;
+    diff["updated"] = updated;
+    diff["deleted"] = deleted;
+    diff["can_channels"] = QJsonArray::fromStringList(channels);
+
+    QJsonObject result;
+    result["ok"] = errors.isEmpty();
+    result["errors"] = errors;
+    result["warnings"] = warnings;
+    result["diff"] = diff;
+    return result;
+}
+
+QString VssMappingValidator::Summary(const QJsonObject &result)
+{
+    QString summary;
+    for (const auto issue : result.value("errors").toArray())
+    {
+        summary += "Error: " + issue.toObject().value("vss").toString() + ": " + issue.toObject().value("message").toString() + "\n";
+    }
+    for (const auto issue : result.value("warnings").toArray())
+    {
+        summary += "Warning: " + issue.toObject().value("vss").toString() + ": " + issue.toObject().value("message").toString() + "\n";
+    }
+    QJsonObject diff = result.value("diff").toObject();
+    summary += QString("Mapping: %1 added, %2 updated, %3 deleted\n")
+                   .arg(diff.value("added").toArray().size())
+                   .arg(diff.value("updated").toArray().size())
+                   .arg(diff.value("deleted").toArray().size());
+    return summary;
+}
@@ -0,0 +1,45 @@
+#ifndef VSS_MAPPING_VALIDATOR_H
+#define VSS_MAPPING_VALIDATOR_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QSet>
+#include <QJsonObject>
+
+typedef struct
+{
+    QString message;
+    int startBit;
+    int size;
+    bool isSigned;
+    bool isScaled; // factor or offset make it a non-integer value
+} Dbc_Signal_Info;
+
+// Checks a vss mapping configuration (ecuName, dbcFilename, mappingItems) against the dbc
+// payload, the VSS spec (vss.json) and the current overlay, before anything is written.
+// Result:
+//   { ok, errors: [{ vss, message }], warnings: [{ vss, message }],
+//     diff: { added: [], updated: [], deleted: [], can_channels: [] } }
+// 'ok' is false when there is at least one error; warnings do not block the deployment.
+class VssMappingValidator
+{
+public:
+    VssMappingValidator(const QString &dbcContent, const QString &overlayContent, const QString &vssJsonFile);
+
+    QJsonObject Validate(const QJsonObject &config);
+
+    static QString Summary(const QJsonObject &result);
+
+private:
+    void ParseDbc(const QString &dbcContent);
+    void ParseOverlay(const QString &overlayContent);
+    // the leaf in vss.json, empty if the spec does not have it
+    QJsonObject SpecLeaf(const QString &vss) const;
+
+    QHash<QString, Dbc_Signal_Info> m_dbcSignals;
+    QSet<QString> m_overlayLeaves;
+    QJsonObject m_vssSpec;
+};
+
+#endif // VSS_MAPPING_VALIDATOR_H
@@ -950,6 +950,11 @@ swupdate_value="${swupdate_value}"
 EOF
     chmod +x "${DK_ENV_FILE}"
     
+    # Activation hook of the dk_manager self-update (recreates its container from the new image)
+    mkdir -p $HOME_DIR/.dk/dk_swupdate/dk_manager
+    cp "$CURRENT_DIR/scripts/dk_manager_activate.sh" "$HOME_DIR/.dk/dk_swupdate/dk_manager/activate.sh"
+    chmod +x "$HOME_DIR/.dk/dk_swupdate/dk_manager/activate.sh"
+
     # Create additional services
     run_with_feedback "$CURRENT_DIR/scripts/create_dk_xiphost_service.sh" "Additional services configured" "Service configuration warning"
     
@@ -0,0 +1,58 @@
+#!/bin/sh
+# Copyright (c) 2025 Eclipse Foundation.
+#
+# This program and the accompanying materials are made available under the
+# terms of the MIT License which is available at
+# https://opensource.org/licenses/MIT.
+#
+# SPDX-License-Identifier: MIT
+
+# Activation hook of the dk_manager self-update, installed as
+# ~/.dk/dk_swupdate/dk_manager/activate.sh and called by dk_manager itself as
+#     activate.sh <artifact> <version>
+# <artifact> is a 'docker save' tarball of the dk_manager image. A restart keeps the
+# image a container was created from, so the dk_manager container is recreated from
+# the loaded image with the options of the installation. That stops the caller, so it
+# is done by a helper container and this script returns once the helper is started.
+
+ARTIFACT="$1"
+VERSION="$2"
+HELPER="dk_manager_activate"
+
+# source the installation env
+. "$(dirname "$0")/../dk_swupdate_env.sh" || exit 1
+
+if [ ! -f "$ARTIFACT" ] || [ -z "$VERSION" ]; then
+    echo "usage: $0 <artifact> <version>"
+    exit 1
+fi
+# dk_manager deployed by k3s runs from containerd's images, not docker's
+if ! docker container inspect dk_manager > /dev/null 2>&1; then
+    echo "no docker container named dk_manager, cannot activate $VERSION"
+    exit 1
+fi
+
+LOADED=$(docker load -q -i "$ARTIFACT" | sed -n 's/^Loaded image[^:]*: //p' | tail -n 1)
+IMAGE=$(docker image inspect --format '{{.Id}}' "$LOADED" 2> /dev/null)
+if [ -z "$IMAGE" ]; then
+    echo "cannot load $ARTIFACT"
+    exit 1
+fi
+# dk_run.sh and the xip update create dk_manager from the latest tag
+docker tag "$IMAGE" "$DOCKER_HUB_NAMESPACE/dk_manager:latest"
+docker tag "$IMAGE" "$DOCKER_HUB_NAMESPACE/dk_manager:$VERSION"
+
+# the helper runs the new image with the docker cli of the host; the delay lets
+# dk_manager report the result before it is stopped. If the new container cannot be
+# created, the previous image is run again.
+PREVIOUS=$(docker container inspect --format '{{.Image}}' dk_manager)
+RUN_OPTS="-d -it --name dk_manager $LOG_LIMIT_PARAM $DOCKER_SHARE_PARAM -v $HOME_DIR/.dk:/app/.dk --restart unless-stopped \
+    -e USER=$DK_USER -e DOCKER_HUB_NAMESPACE=$DOCKER_HUB_NAMESPACE -e ARCH=$ARCH"
+docker rm -f $HELPER > /dev/null 2>&1
+docker run -d --rm --name $HELPER $DOCKER_SHARE_PARAM --entrypoint sh "$IMAGE" -c "\
+    sleep 5; \
+    docker stop dk_manager; docker rm dk_manager; \
+    docker run $RUN_OPTS $IMAGE || docker run $RUN_OPTS $PREVIOUS" > /dev/null || exit 1
+
+echo "dk_manager $VERSION activated from $IMAGE"
+exit 0